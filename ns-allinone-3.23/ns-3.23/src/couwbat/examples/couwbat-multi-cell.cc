@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/couwbat-module.h"
+#include <limits>
+#include <ctime>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatMultiCellExample");
+
+/**
+ * \file
+ * \ingroup examples
+ * couwbat-multi-cell places several CR-BSs (\ref ns3::BsCouwbatMac), each with its own CR-STAs
+ * (\ref ns3::StaCouwbatMac), on one channel and lets them share the spectrum through the
+ * inter-cell coordination of the spectrum database (\ref ns3::SpectrumDb).
+ *
+ * The CR-BSs are placed on a line with distance "cellDist". Two CR-BSs closer than "intfRange"
+ * are declared as interfering. All cells run saturated UDP traffic in DL and UL, at the end the
+ * per-cell and aggregate throughput is printed together with the average number of subchannels
+ * used by more than one interfering CR-BS. With policy 0 the CR-BSs do not register with the
+ * database, so only the throughput is printed.
+ *
+ * Aggregate throughput versus cell count is obtained by sweeping "cells", e.g.
+ * for n in 1 2 3 4; do ./waf --run "couwbat-multi-cell --cells=$n --policy=3 --seed=1"; done
+ */
+
+static uint64_t g_conflictSamples = 0;
+static uint64_t g_conflictSum = 0;
+
+static void
+SampleConflicts (Ptr<SpectrumDb> specDb, std::vector<Mac48Address> bsAddrs)
+{
+  for (uint32_t i = 0; i < bsAddrs.size (); ++i)
+    {
+      g_conflictSum += specDb->GetCrBsConflicts (bsAddrs[i]);
+    }
+  ++g_conflictSamples;
+  Simulator::Schedule (MicroSeconds (Couwbat::GetSuperframeDuration ()), &SampleConflicts, specDb, bsAddrs);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t cellCount = 2;
+  uint32_t stasPerCell = 1;
+  bool unequalLoad = false;
+  double cellDist = 30.0;
+  double intfRange = 100.0;
+  uint32_t staMaxXY = 10;
+  uint32_t policy = SpectrumDb::CRBS_PARTITION_STATIC;
+  double durationSeconds = 5.0;
+  unsigned int seed = std::time (0);
+
+  CommandLine cmd;
+  cmd.AddValue ("cells", "Number of CR-BSs.", cellCount);
+  cmd.AddValue ("stas", "Number of CR-STAs per cell.", stasPerCell);
+  cmd.AddValue ("unequal", "Cell i gets (i+1) times the number of CR-STAs", unequalLoad);
+  cmd.AddValue ("cellDist", "Distance between neighbouring CR-BSs in m", cellDist);
+  cmd.AddValue ("intfRange", "CR-BSs closer than this distance in m are declared as interfering", intfRange);
+  cmd.AddValue ("dist", "CR-STAs are randomly positioned around their CR-BS with this as max distance", staMaxXY);
+  cmd.AddValue ("policy", "Partition policy: 0 (none), 1 (static), 2 (load-proportional), 3 (interference graph coloring)", policy);
+  cmd.AddValue ("d", "Simulation duration in seconds.", durationSeconds);
+  cmd.AddValue ("seed", "Specify a particular seed for std::srand and ns3::RngSeedManager [std::time]", seed);
+  cmd.Parse (argc, argv);
+
+  Time::SetResolution (Time::NS);
+
+  std::srand (seed);
+  ns3::RngSeedManager::SetSeed (seed);
+
+  LogComponentEnable ("CouwbatMultiCellExample", LOG_LEVEL_INFO);
+  LogComponentEnable ("CouwbatMultiCellExample", LOG_PREFIX_TIME);
+  LogComponentEnable ("CouwbatMultiCellExample", LOG_PREFIX_LEVEL);
+
+  /*
+   * SET UP COUWBAT
+   */
+
+  CouwbatHelper couwbat;
+
+  NodeContainer specDbNodes;
+  specDbNodes.Create (1);
+  Ptr<SpectrumDb> specDb = couwbat.InstallSpectrumDb (specDbNodes.Get (0));
+  specDb->SetAttribute ("CrBsPartitionPolicy", EnumValue (policy));
+
+  SimpleCouwbatChannelHelper channel = SimpleCouwbatChannelHelper::Default ();
+
+  SimpleCouwbatPhyHelper phy = SimpleCouwbatPhyHelper::Default ();
+  phy.SetChannel (channel.Create ());
+
+  SimpleCouwbatMacHelper mac = SimpleCouwbatMacHelper::Default ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  InternetStackHelper stack;
+
+  std::vector<Ptr<CouwbatNetDevice> > bsNetDevices;
+  std::vector<Mac48Address> bsAddrs;
+  std::vector<Ptr<Node> > bsNodes;
+  std::vector<NodeContainer> cellStaNodes;
+  std::vector<Ipv4Address> bsIpAddrs;
+  std::vector<std::vector<Ipv4Address> > cellStaIpAddrs;
+
+  for (uint32_t c = 0; c < cellCount; ++c)
+    {
+      const uint32_t staCount = unequalLoad ? (c + 1) * stasPerCell : stasPerCell;
+
+      NodeContainer nodes;
+      nodes.Create (1 + staCount);
+      Ptr<Node> bsNode = nodes.Get (0);
+      NodeContainer staNodes;
+      for (uint32_t i = 0; i < staCount; ++i)
+        {
+          staNodes.Add (nodes.Get (i + 1));
+        }
+
+      mac.SetType ("ns3::BsCouwbatMac");
+      Ptr<CouwbatNetDevice> bsNetDevice = couwbat.Install (phy, mac, bsNode);
+      Mac48Address bsAddr = bsNetDevice->GetMac ()->GetAddress ();
+
+      mac.SetType ("ns3::StaCouwbatMac");
+      NetDeviceContainer devices;
+      devices.Add (bsNetDevice);
+      std::vector<Ptr<CouwbatNetDevice> > staNetDevices;
+      for (uint32_t i = 0; i < staCount; ++i)
+        {
+          Ptr<CouwbatNetDevice> staNetDevice = couwbat.Install (phy, mac, staNodes.Get (i));
+          staNetDevice->GetMac ()->SetAttribute ("HomeBs", Mac48AddressValue (bsAddr));
+          devices.Add (staNetDevice);
+          staNetDevices.push_back (staNetDevice);
+        }
+
+      stack.Install (nodes);
+
+      std::ostringstream subnet;
+      subnet << "10.1." << c + 1 << ".0";
+      Ipv4AddressHelper address;
+      address.SetBase (subnet.str ().c_str (), "255.255.255.0");
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+      Ipv4Address bsIpAddr = interfaces.GetAddress (0);
+      std::vector<Ipv4Address> staIpAddrs;
+      for (uint32_t i = 0; i < staCount; ++i)
+        {
+          Ipv4Address staIpAddr = interfaces.GetAddress (i + 1);
+          staIpAddrs.push_back (staIpAddr);
+          bsNetDevice->AddTranslatonEntry (staIpAddr, staNetDevices[i]->GetMac ()->GetAddress ());
+          staNetDevices[i]->AddTranslatonEntry (bsIpAddr, bsAddr);
+        }
+
+      // Mobility: CR-BSs on a line, CR-STAs randomly around their CR-BS
+      Ptr<ListPositionAllocator> bsPosition = CreateObject<ListPositionAllocator> ();
+      bsPosition->Add (Vector (c * cellDist, 0, 26));
+      mobility.SetPositionAllocator (bsPosition);
+      mobility.Install (bsNode);
+
+      std::ostringstream staX;
+      std::ostringstream staY;
+      staX << "ns3::UniformRandomVariable[Min=" << c * cellDist - staMaxXY << "|Max=" << c * cellDist + staMaxXY
+          << "|Stream=" << std::rand () << "]";
+      staY << "ns3::UniformRandomVariable[Min=-" << staMaxXY << "|Max=" << staMaxXY << "|Stream=" << std::rand () << "]";
+      mobility.SetPositionAllocator ("ns3::RandomBoxPositionAllocator",
+                                     "X", StringValue (staX.str ()),
+                                     "Y", StringValue (staY.str ()),
+                                     "Z", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
+      mobility.Install (staNodes);
+
+      NS_LOG_INFO ("Cell " << c << ": CR-BS " << bsAddr << " at " << bsNode->GetObject<MobilityModel> ()->GetPosition ()
+                   << " with " << staCount << " CR-STA(s)");
+
+      bsNetDevices.push_back (bsNetDevice);
+      bsAddrs.push_back (bsAddr);
+      bsNodes.push_back (bsNode);
+      cellStaNodes.push_back (staNodes);
+      bsIpAddrs.push_back (bsIpAddr);
+      cellStaIpAddrs.push_back (staIpAddrs);
+    }
+
+  // Declare interfering CR-BSs
+  for (uint32_t a = 0; a < cellCount; ++a)
+    {
+      for (uint32_t b = a + 1; b < cellCount; ++b)
+        {
+          double d = bsNodes[a]->GetObject<MobilityModel> ()->GetDistanceFrom (bsNodes[b]->GetObject<MobilityModel> ());
+          if (d < intfRange)
+            {
+              specDb->SetCrBsInterference (bsAddrs[a], bsAddrs[b]);
+            }
+        }
+    }
+
+  /*
+   * SET UP APPLICATIONS
+   */
+
+  const uint32_t packetSize = 1452;
+  std::vector<ApplicationContainer> bsSinks;
+  std::vector<ApplicationContainer> staSinks;
+  for (uint32_t c = 0; c < cellCount; ++c)
+    {
+      UdpServerHelper server (9);
+      bsSinks.push_back (server.Install (bsNodes[c]));
+      staSinks.push_back (server.Install (cellStaNodes[c]));
+      bsSinks.back ().Start (Seconds (1.0));
+      staSinks.back ().Start (Seconds (1.0));
+
+      UdpClientHelper client (bsIpAddrs[c], 9);
+      client.SetAttribute ("Interval", TimeValue (MicroSeconds (50)));
+      client.SetAttribute ("PacketSize", UintegerValue (packetSize));
+      client.SetAttribute ("MaxPackets", UintegerValue (std::numeric_limits<uint32_t>::max ()));
+      ApplicationContainer sources = client.Install (cellStaNodes[c]);
+      for (uint32_t i = 0; i < cellStaIpAddrs[c].size (); ++i)
+        {
+          client.SetAttribute ("RemoteAddress", AddressValue (cellStaIpAddrs[c][i]));
+          sources.Add (client.Install (bsNodes[c]));
+        }
+      sources.Start (Seconds (1.0));
+      sources.Stop (Seconds (durationSeconds));
+    }
+
+  // Without coordination the CR-BSs do not register and report no allocations
+  if (policy != SpectrumDb::CRBS_PARTITION_NONE)
+    {
+      Simulator::Schedule (Seconds (1.0), &SampleConflicts, specDb, bsAddrs);
+    }
+
+  /*
+   * RUN SIMULATION
+   */
+
+  Simulator::Stop (Seconds (durationSeconds));
+  Simulator::Run ();
+
+  /*
+   * PRINT RESULTS
+   */
+
+  const double measuredSeconds = durationSeconds - 1.0;
+  double aggregateMbps = 0;
+  std::cout << "\n\nPRINT RESULTS FOR " << cellCount << " CELL(S), POLICY=" << policy << ":\n\n";
+  for (uint32_t c = 0; c < cellCount; ++c)
+    {
+      uint64_t ulPackets = DynamicCast<UdpServer> (bsSinks[c].Get (0))->GetReceived ();
+      uint64_t dlPackets = 0;
+      for (uint32_t i = 0; i < staSinks[c].GetN (); ++i)
+        {
+          dlPackets += DynamicCast<UdpServer> (staSinks[c].Get (i))->GetReceived ();
+        }
+      double dlMbps = dlPackets * packetSize * 8 / measuredSeconds / 1e6;
+      double ulMbps = ulPackets * packetSize * 8 / measuredSeconds / 1e6;
+      aggregateMbps += dlMbps + ulMbps;
+      std::cout << "Cell " << c << " (" << bsAddrs[c] << "): DL " << dlMbps << " Mbit/s, UL " << ulMbps << " Mbit/s";
+      if (policy != SpectrumDb::CRBS_PARTITION_NONE)
+        {
+          std::cout << ", subchannels in use at end: " << specDb->GetCrBsAllocation (bsAddrs[c]).count ();
+        }
+      std::cout << std::endl;
+    }
+  std::cout << "Aggregate throughput: " << aggregateMbps << " Mbit/s" << std::endl;
+  if (policy != SpectrumDb::CRBS_PARTITION_NONE)
+    {
+      std::cout << "Average conflicting subchannels per superframe: "
+          << (g_conflictSamples ? double (g_conflictSum) / g_conflictSamples : 0.0) << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return 0;
+}
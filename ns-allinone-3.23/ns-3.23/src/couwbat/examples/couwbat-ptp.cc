@@ -29,6 +29,25 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("CouwbatPtpExample");
 
+static uint64_t g_dlQueueDelayCount = 0; //!< Number of DL packets dequeued by the CR-BS
+static double g_dlQueueDelaySum = 0; //!< Sum of DL queueing delays in seconds
+static double g_dlQueueDelayMax = 0; //!< Maximum DL queueing delay in seconds
+static uint64_t g_dlQueueDrops = 0; //!< Number of DL packets dropped by CoDel
+
+static void
+DlQueueDelay (Mac48Address dest, Time sojourn)
+{
+  ++g_dlQueueDelayCount;
+  g_dlQueueDelaySum += sojourn.GetSeconds ();
+  g_dlQueueDelayMax = std::max (g_dlQueueDelayMax, sojourn.GetSeconds ());
+}
+
+static void
+DlQueueDrop (Ptr<const Packet> packet, Mac48Address dest, Time sojourn)
+{
+  ++g_dlQueueDrops;
+}
+
 /**
  * \file
  * \ingroup examples
@@ -55,6 +74,15 @@ main (int argc, char *argv[])
   int puCsvStartingLine = 1;
   uint16_t streams = 1;
   unsigned int macDlUlSlotLimit = Couwbat::mac_dlul_slot_limit_size;
+  bool macCompactMap = Couwbat::mac_compact_map_enabled;
+  bool macQueueLimitBytesEnabled = Couwbat::mac_queue_limit_bytes_enabled;
+  uint32_t macQueueLimitBytes = Couwbat::mac_queue_limit_bytes;
+  bool macCodel = Couwbat::mac_codel_enabled;
+  uint32_t macCodelTarget = Couwbat::mac_codel_target_us;
+  bool macQueueDscp = Couwbat::mac_queue_classifier == COUWBAT_QUEUE_CLASSIFY_DSCP;
+  uint32_t macQueueScheduler = Couwbat::mac_queue_scheduler;
+  bool macArq = Couwbat::mac_arq_enabled;
+  bool macClassDlOrder = Couwbat::mac_queue_class_dl_order;
 
   CommandLine cmd;
   cmd.AddValue ("stas", "Number of CR-STAs.", staCount);
@@ -70,6 +98,15 @@ main (int argc, char *argv[])
   cmd.AddValue ("csvln", "Line from which to start reading in trace file", puCsvStartingLine);
   cmd.AddValue ("streams", "Number of simultaneous TCP application streams", streams);
   cmd.AddValue ("dlUlSlotLim", "Limit number of MAC DL/UL slots to this number", macDlUlSlotLimit);
+  cmd.AddValue ("compactMap", "Use the compact MAP encoding with short STA IDs", macCompactMap);
+  cmd.AddValue ("queueLimBytes", "Limit MAC TxQueue size in bytes per destination", macQueueLimitBytesEnabled);
+  cmd.AddValue ("queueLimBytesSize", "If queueLimBytes is enabled, the maximum queue size in bytes per destination", macQueueLimitBytes);
+  cmd.AddValue ("codel", "Enable CoDel active queue management in the MAC TxQueue", macCodel);
+  cmd.AddValue ("codelTarget", "CoDel target queueing delay in microseconds", macCodelTarget);
+  cmd.AddValue ("queueDscp", "Assign MAC TxQueue traffic classes by DSCP instead of packet size", macQueueDscp);
+  cmd.AddValue ("queueSched", "MAC TxQueue traffic class scheduler: 0 (ratio), 1 (strict priority), 2 (deficit round robin)", macQueueScheduler);
+  cmd.AddValue ("classDlOrder", "Place DL slots of STAs with higher priority traffic queued first in the superframe", macClassDlOrder);
+  cmd.AddValue ("arq", "Enable selective-repeat ARQ, retransmission of unACKed MAC bursts", macArq);
 
   if (argc < 2)
     {
@@ -88,6 +125,15 @@ main (int argc, char *argv[])
   Couwbat::mac_queue_limit_enabled = macQueueLimitEnabled;
   Couwbat::mac_queue_limit_size = macQueueLimitSize;
   Couwbat::mac_dlul_slot_limit_size = macDlUlSlotLimit;
+  Couwbat::mac_compact_map_enabled = macCompactMap;
+  Couwbat::mac_queue_limit_bytes_enabled = macQueueLimitBytesEnabled;
+  Couwbat::mac_queue_limit_bytes = macQueueLimitBytes;
+  Couwbat::mac_codel_enabled = macCodel;
+  Couwbat::mac_codel_target_us = macCodelTarget;
+  Couwbat::mac_queue_classifier = macQueueDscp ? COUWBAT_QUEUE_CLASSIFY_DSCP : COUWBAT_QUEUE_CLASSIFY_SIZE;
+  Couwbat::mac_queue_scheduler = (enum CouwbatQueueScheduler) macQueueScheduler;
+  Couwbat::mac_queue_class_dl_order = macClassDlOrder;
+  Couwbat::mac_arq_enabled = macArq;
 
   /*
    * SET UP LOGGING
@@ -239,6 +285,8 @@ main (int argc, char *argv[])
     }
 
   Ptr<CouwbatNetDevice> bsNetDevice = couwbat.Install (phy, mac, bsNode);
+  bsNetDevice->GetMac ()->TraceConnectWithoutContext ("QueueDelay", MakeCallback (&DlQueueDelay));
+  bsNetDevice->GetMac ()->TraceConnectWithoutContext ("QueueDrop", MakeCallback (&DlQueueDrop));
 
   mac.SetType ("ns3::StaCouwbatMac");
   NetDeviceContainer staNetDevices;
@@ -531,6 +579,27 @@ main (int argc, char *argv[])
         }
     }
 
+  std::cout << "DL queueing delay: mean " << (g_dlQueueDelayCount ? 1000 * g_dlQueueDelaySum / g_dlQueueDelayCount : 0)
+      << " ms, max " << 1000 * g_dlQueueDelayMax << " ms, CoDel drops: " << g_dlQueueDrops << std::endl;
+
+  if (Couwbat::mac_arq_enabled)
+    {
+      Ptr<BsCouwbatMac> bsMac = DynamicCast<BsCouwbatMac> (bsNetDevice->GetMac ());
+      const CouwbatTxHistoryBuffer::Stats &dlArq = bsMac->GetArqStats ();
+      std::cout << "DL ARQ: ACKed payloads: " << dlArq.ackedPayloads << " (" << dlArq.ackedBytes << " B)"
+          << ", retransmitted payloads: " << dlArq.retransmittedPayloads << " (" << dlArq.retransmittedBytes << " B)"
+          << ", window overruns: " << dlArq.windowOverruns << std::endl;
+
+      for (uint32_t i = 0; i < staCount; ++i)
+        {
+          Ptr<StaCouwbatMac> staMac = DynamicCast<StaCouwbatMac> (staCouwbatNetDevices[i]->GetMac ());
+          const CouwbatTxHistoryBuffer::Stats &ulArq = staMac->GetArqStats ();
+          std::cout << "UL ARQ STA " << i + 1 << ": ACKed payloads: " << ulArq.ackedPayloads << " (" << ulArq.ackedBytes << " B)"
+              << ", retransmitted payloads: " << ulArq.retransmittedPayloads << " (" << ulArq.retransmittedBytes << " B)"
+              << ", window overruns: " << ulArq.windowOverruns << std::endl;
+        }
+    }
+
   Simulator::Destroy ();
 
   return 0;
@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/couwbat-module.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatPuPopulation");
+
+/**
+ * \file
+ * \ingroup examples
+ * couwbat-pu-population drives many synthetic primary users with random on/off
+ * times, either as one PrimaryUserNetDevice and RandomOnOffModel per primary user
+ * or as one PuPopulation (\ref ns3::PuPopulation), and reports the wall clock time
+ * and the mean number of free subchannels seen by the spectrum database.
+ *
+ * Example:
+ * ./waf --run "couwbat-pu-population --n=5000 --mode=population"
+ *
+ * Execute with "--help" parameter for info on all parameters.
+ */
+
+static double g_freeSum = 0;
+static uint32_t g_samples = 0;
+
+static void
+SampleFree (Ptr<SpectrumDb> db)
+{
+  g_freeSum += db->GetFreeSubchannels ().count ();
+  ++g_samples;
+  Simulator::Schedule (MilliSeconds (10), &SampleFree, db);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string mode = "population";
+  uint32_t n = 1000;
+  uint32_t width = 8; // subcarriers per primary user
+  double duration = 10; // in seconds
+  double maxOnOff = 0.5; // in seconds
+
+  CommandLine cmd;
+  cmd.AddValue ("mode", "population (one PuPopulation) or devices (one device and model per PU)", mode);
+  cmd.AddValue ("n", "number of primary users", n);
+  cmd.AddValue ("width", "number of subcarriers per primary user", width);
+  cmd.AddValue ("duration", "simulated time in seconds", duration);
+  cmd.AddValue ("maxonoff", "maximum on and off time in seconds, drawn uniformly", maxOnOff);
+  cmd.Parse (argc, argv);
+
+  RngSeedManager::SetSeed (1);
+  std::ostringstream randVarStream;
+  randVarStream << "ns3::UniformRandomVariable[Min=0.001|Max=" << maxOnOff << "]";
+  const std::string randVar = randVarStream.str ();
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  CouwbatHelper couwbat;
+  Ptr<SpectrumDb> db = couwbat.InstallSpectrumDb (nodes.Get (0));
+
+  SystemWallClockMs clock;
+  clock.Start ();
+
+  // Primary users spread evenly over the band, overlapping when they do not fit
+  const uint32_t subcarriers = Couwbat::GetNumberOfSubcarriers () - width;
+  Ptr<PuPopulation> population;
+  std::vector<Ptr<RandomOnOffModel> > models;
+  if (mode == "population")
+    {
+      population = CreateObject<PuPopulation> ();
+      population->SetAttribute ("Model", EnumValue (PuPopulation::MODEL_RANDOM));
+      population->SetAttribute ("RandomVariable", StringValue (randVar));
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          population->AddPrimaryUser ((uint64_t) i * subcarriers / n, width);
+        }
+      couwbat.InstallPuPopulation (nodes.Get (1), population);
+    }
+  else if (mode == "devices")
+    {
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Ptr<RandomOnOffModel> model = CreateObject<RandomOnOffModel> ();
+          model->SetAttribute ("RandomVariable", StringValue (randVar));
+          // A node per primary user is not needed, the devices are only aggregated
+          Ptr<Node> node = CreateObject<Node> ();
+          couwbat.InstallPrimaryUser (node, couwbat.CreateSpectrumMap ((uint64_t) i * subcarriers / n, width), model);
+          models.push_back (model);
+        }
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown mode " << mode);
+    }
+  const int64_t setupMs = clock.End ();
+
+  Simulator::Schedule (MilliSeconds (5), &SampleFree, db);
+  clock.Start ();
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  const int64_t runMs = clock.End ();
+
+  std::cout << "Mode " << mode << ", " << n << " primary users, " << duration << " s" << std::endl;
+  std::cout << "Setup: " << setupMs << " ms, run: " << runMs << " ms" << std::endl;
+  if (population)
+    {
+      std::cout << "Switches: " << population->GetNSwitches () << std::endl;
+    }
+  std::cout << "Mean free subchannels: " << (g_samples ? g_freeSum / g_samples : 0)
+            << " of " << Couwbat::GetNumberOfSubchannels () << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/core-module.h"
+#include "ns3/couwbat-module.h"
+#include <sys/stat.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatPuTraceConvert");
+
+/**
+ * \file
+ * \ingroup examples
+ * couwbat-pu-trace-convert converts a CSV spectrum trace of the trace based primary
+ * user (\ref ns3::TraceBasedPuNetDevice) into the compact binary format
+ * (\ref ns3::PuTraceWriter), which the TBPU reads as well.
+ *
+ * Example:
+ * ./waf --run "couwbat-pu-trace-convert --in=pu.csv --out=pu.cwpt --interval=2"
+ *
+ * Execute with "--help" parameter for info on all parameters.
+ */
+
+static uint64_t
+FileSize (std::string fileName)
+{
+  struct stat st;
+  return stat (fileName.c_str (), &st) == 0 ? st.st_size : 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string in;
+  std::string out;
+  uint32_t interval = 0; // in milliseconds
+  uint32_t keyInterval = 1024;
+  bool verify = true;
+
+  CommandLine cmd;
+  cmd.AddValue ("in", "CSV trace to convert", in);
+  cmd.AddValue ("out", "binary trace to create", out);
+  cmd.AddValue ("interval", "sampling interval of the trace in ms to record, 0 if unknown", interval);
+  cmd.AddValue ("keyinterval", "lines between two key frames", keyInterval);
+  cmd.AddValue ("verify", "read the binary trace back and compare it with the CSV trace", verify);
+  cmd.Parse (argc, argv);
+
+  if (in.empty () || out.empty () || keyInterval == 0)
+    {
+      std::cerr << "Usage: couwbat-pu-trace-convert --in=<csv> --out=<binary> [--interval=<ms>]" << std::endl;
+      return 1;
+    }
+
+  Ptr<PuTraceReader> csv = Create<PuTraceReader> ();
+  if (!csv->Open (in))
+    {
+      std::cerr << "Cannot open " << in << std::endl;
+      return 1;
+    }
+
+  // Lines are converted one at a time, only the map of the current line is held
+  Ptr<SpectrumMap> map = CreateObject<SpectrumMap> ();
+  std::vector<uint64_t> words (map->GetNWords ());
+  PuTraceWriter writer;
+  if (!writer.Open (out, map->GetSize (), MilliSeconds (interval), keyInterval))
+    {
+      std::cerr << "Cannot create " << out << std::endl;
+      return 1;
+    }
+  for (uint32_t line = 1; line <= csv->GetLineCount (); ++line)
+    {
+      csv->ReadLine (line, *map);
+      for (uint32_t w = 0; w < words.size (); ++w)
+        {
+          words[w] = map->GetWord (w);
+        }
+      if (!writer.WriteLine (&words[0]))
+        {
+          break;
+        }
+    }
+  if (!writer.Close ())
+    {
+      std::cerr << "Cannot write " << out << std::endl;
+      return 1;
+    }
+
+  std::cout << "Converted " << writer.GetLineCount () << " lines of " << map->GetSize ()
+            << " subcarriers: " << FileSize (in) << " B -> " << FileSize (out) << " B" << std::endl;
+
+  if (verify)
+    {
+      Ptr<PuTraceReader> binary = Create<PuTraceReader> ();
+      if (!binary->Open (out) || binary->GetLineCount () != csv->GetLineCount ())
+        {
+          std::cerr << "Cannot read back " << out << std::endl;
+          return 1;
+        }
+      Ptr<SpectrumMap> expected = CreateObject<SpectrumMap> ();
+      uint32_t mismatches = 0;
+      for (uint32_t line = 1; line <= csv->GetLineCount (); ++line)
+        {
+          csv->ReadLine (line, *expected);
+          if (!binary->ReadLine (line, *map) || !map->IsEqual (expected))
+            {
+              ++mismatches;
+            }
+        }
+      std::cout << "Verified " << csv->GetLineCount () << " lines, mismatches: " << mismatches << std::endl;
+      return mismatches == 0 ? 0 : 1;
+    }
+  return 0;
+}
@@ -0,0 +1,226 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/couwbat-module.h"
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatSpectrumDbIpcExample");
+
+/**
+ * \file
+ * \ingroup examples
+ * couwbat-spectrum-db-ipc demonstrates the spectrum database service (\ref ns3::SpectrumDbServer)
+ * and its clients (\ref ns3::SpectrumDbClient) in separate processes.
+ *
+ * Modes:
+ *  - server: run a spectrum database in real time and serve it on --socket
+ *  - pu: stand-in primary user emulator, occupies and leaves random spectrum through the server
+ *  - monitor: subscribe to the server and print every change of the free subchannels
+ *  - selftest (default): run a server and a subscribed SpectrumManager in this process and
+ *    a PU emulator in a child process, and check that the copy of the client always
+ *    matches the database
+ *
+ * Execute with "--help" parameter for info on all parameters.
+ */
+
+static std::string
+SubchannelsToString (const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels)
+{
+  std::string s;
+  for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+    {
+      s += subchannels.test (i) ? '1' : '0';
+    }
+  return s;
+}
+
+/**
+ * Primary user emulator: occupy random subchannel ranges for random times.
+ */
+static int
+RunPuEmulator (std::string socketPath, uint32_t count, uint32_t seed)
+{
+  Ptr<SpectrumDbClient> client = CreateObject<SpectrumDbClient> ();
+  client->SetAttribute ("SocketPath", StringValue (socketPath));
+  if (!client->Connect ())
+    {
+      std::cerr << "PU emulator: cannot connect to " << socketPath << std::endl;
+      return 1;
+    }
+
+  std::srand (seed);
+  const uint32_t scPerSubchannel = Couwbat::GetNumberOfSubcarriersPerSubchannel ();
+  std::vector<Ptr<SpectrumMap> > active;
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      if (active.empty () || std::rand () % 3)
+        {
+          // Sometimes only part of a subchannel, so that maps overlap on subcarriers
+          Ptr<SpectrumMap> map = CreateObject<SpectrumMap> ();
+          const uint32_t start = std::rand () % Couwbat::GetNumberOfSubcarriers ();
+          const uint32_t length = 1 + std::rand () % (4 * scPerSubchannel);
+          map->SetSpectrum (start, std::min (length, Couwbat::GetNumberOfSubcarriers () - start));
+          client->OccupySpectrum (map);
+          active.push_back (map);
+        }
+      else
+        {
+          const uint32_t j = std::rand () % active.size ();
+          client->LeaveSpectrum (active[j]);
+          active.erase (active.begin () + j);
+        }
+      usleep (1000 + std::rand () % 20000);
+    }
+
+  // The server leaves the remaining spectrum when the connection is closed
+  client->Disconnect ();
+  return 0;
+}
+
+static void
+PrintChange (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy, std::bitset<Couwbat::MAX_SUBCHANS> becameFree)
+{
+  NS_LOG_INFO (Simulator::Now ().GetSeconds () << "s busy " << SubchannelsToString (becameBusy)
+               << " free " << SubchannelsToString (becameFree));
+}
+
+static uint32_t g_checks = 0;
+static uint32_t g_mismatches = 0;
+static uint32_t g_changes = 0;
+
+static void
+CheckCopy (Ptr<SpectrumDb> db, Ptr<SpectrumDbClient> client, Ptr<SpectrumManager> manager)
+{
+  // The copy lags behind by up to one poll, only compare when at the same version
+  if (client->GetSpectrumVersion () == db->GetSpectrumVersion ())
+    {
+      ++g_checks;
+      if (!client->GetOccupiedSpectrum ()->IsEqual (db->GetOccupiedSpectrum ())
+          || client->GetFreeSubchannels () != db->GetFreeSubchannels ()
+          || manager->GetUsableSubchannels () != db->GetFreeSubchannels ())
+        {
+          ++g_mismatches;
+          NS_LOG_ERROR ("Copy of the client differs from the database at version " << db->GetSpectrumVersion ());
+        }
+    }
+  Simulator::Schedule (MilliSeconds (1), &CheckCopy, db, client, manager);
+}
+
+static void
+CountChange (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy, std::bitset<Couwbat::MAX_SUBCHANS> becameFree)
+{
+  ++g_changes;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string mode = "selftest";
+  std::string socketPath = "/tmp/couwbat-spectrum-db.sock";
+  uint32_t duration = 3; // in seconds
+  uint32_t count = 200;
+  uint32_t seed = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("mode", "server, pu, monitor or selftest", mode);
+  cmd.AddValue ("socket", "path of the Unix domain socket of the spectrum database", socketPath);
+  cmd.AddValue ("duration", "duration of server, monitor and selftest in seconds", duration);
+  cmd.AddValue ("count", "number of occupy and leave requests of the PU emulator", count);
+  cmd.AddValue ("seed", "seed of the PU emulator", seed);
+  cmd.Parse (argc, argv);
+
+  if (mode == "pu")
+    {
+      return RunPuEmulator (socketPath, count, seed);
+    }
+
+  // Serve other processes in wall clock time
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+  LogComponentEnable ("CouwbatSpectrumDbIpcExample", LOG_LEVEL_INFO);
+
+  if (mode == "server")
+    {
+      LogComponentEnable ("SpectrumDbServer", LOG_LEVEL_INFO);
+      Ptr<SpectrumDb> db = CreateObject<SpectrumDb> ();
+      Ptr<SpectrumDbServer> server = CreateObject<SpectrumDbServer> ();
+      server->SetAttribute ("SocketPath", StringValue (socketPath));
+      server->SetSpectrumDb (db);
+      server->Start ();
+      db->TraceConnectWithoutContext ("SubchannelsChanged", MakeCallback (&PrintChange));
+      Simulator::Stop (Seconds (duration));
+      Simulator::Run ();
+      server->Dispose ();
+      Simulator::Destroy ();
+      return 0;
+    }
+
+  if (mode == "monitor")
+    {
+      Ptr<SpectrumDbClient> client = CreateObject<SpectrumDbClient> ();
+      client->SetAttribute ("SocketPath", StringValue (socketPath));
+      if (!client->Connect ())
+        {
+          NS_FATAL_ERROR ("Cannot connect to " << socketPath);
+        }
+      client->TraceConnectWithoutContext ("SubchannelsChanged", MakeCallback (&PrintChange));
+      client->Subscribe ();
+      Simulator::Stop (Seconds (duration));
+      Simulator::Run ();
+      client->Dispose ();
+      Simulator::Destroy ();
+      return 0;
+    }
+
+  if (mode != "selftest")
+    {
+      NS_FATAL_ERROR ("Unknown mode " << mode);
+    }
+
+  // The server listens before the emulator is forked, so the emulator can connect at once
+  Ptr<SpectrumDb> db = CreateObject<SpectrumDb> ();
+  Ptr<SpectrumDbServer> server = CreateObject<SpectrumDbServer> ();
+  server->SetAttribute ("SocketPath", StringValue (socketPath));
+  server->SetSpectrumDb (db);
+  server->Start ();
+
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      // Leave the objects of the parent alone, in particular the socket file of the server
+      _exit (RunPuEmulator (socketPath, count, seed));
+    }
+  NS_ABORT_MSG_IF (pid < 0, "Cannot fork the PU emulator");
+
+  Ptr<SpectrumDbClient> client = CreateObject<SpectrumDbClient> ();
+  client->SetAttribute ("SocketPath", StringValue (socketPath));
+  if (!client->Connect ())
+    {
+      NS_FATAL_ERROR ("Cannot connect to " << socketPath);
+    }
+  Ptr<SpectrumManager> manager = CreateObject<SpectrumManager> ();
+  manager->SetSpectrumDb (client);
+  manager->TraceConnectWithoutContext ("SubchannelsChanged", MakeCallback (&CountChange));
+  Simulator::Schedule (MilliSeconds (1), &CheckCopy, db, client, manager);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  int status = 0;
+  waitpid (pid, &status, 0);
+
+  std::cout << "PU emulator exit status: " << WEXITSTATUS (status) << std::endl;
+  std::cout << "Spectrum version: " << db->GetSpectrumVersion () << ", subchannel changes seen by the manager: " << g_changes << std::endl;
+  std::cout << "Checks at equal version: " << g_checks << ", mismatches: " << g_mismatches << std::endl;
+  std::cout << "Occupied subcarriers after the emulator left: " << db->GetOccupiedSpectrum ()->Count () << std::endl;
+
+  manager->Dispose ();
+  client->Dispose ();
+  server->Dispose ();
+  Simulator::Destroy ();
+  return g_mismatches == 0 ? 0 : 1;
+}
@@ -123,8 +123,8 @@ main (int argc, char *argv[])
         (
           "FirstOn" , TimeValue (Seconds (2)),
           "FinalOff", TimeValue (Seconds (0)),
-          "PeriodOn" , TimeValue (Seconds (1)),
-          "PeriodOff", TimeValue (Seconds (2))
+          "PeriodOn" , TimeValue (Seconds (2)),
+          "PeriodOff", TimeValue (Seconds (1))
         )
     );
 
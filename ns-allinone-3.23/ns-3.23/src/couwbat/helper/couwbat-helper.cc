@@ -3,14 +3,18 @@
 #include "couwbat-helper.h"
 #include "ns3/pu-net-device.h"
 #include "ns3/trace-based-pu-net-device.h"
+#include "ns3/pu-population.h"
 #include "ns3/network-module.h"
 #include "ns3/spectrum-db.h"
+#include "ns3/spectrum-db-server.h"
+#include "ns3/spectrum-db-client.h"
 #include "ns3/spectrum-map.h"
 #include "ns3/once-onoff-model.h"
 #include "ns3/network-module.h"
 #include "ns3/couwbat-net-device.h"
 #include "ns3/couwbat-mac.h"
 #include "ns3/couwbat-phy.h"
+#include "ns3/couwbat-config.h"
 #include "ns3/bs-couwbat-mac.h"
 #include "ns3/spectrum-manager.h"
 #include "ns3/log.h"
@@ -63,13 +67,60 @@ CouwbatHelper::InstallSpectrumDb (Ptr<Node> node)
   return specDb;
 }
 
+Ptr<SpectrumDbServer>
+CouwbatHelper::InstallSpectrumDbServer (std::string socketPath)
+{
+  NS_LOG_FUNCTION (this << socketPath);
+  Ptr<SpectrumDbServer> server;
+  if (m_specDbNode == 0 || !m_specDbNode->GetObject<SpectrumDb> ())
+    {
+      NS_LOG_ERROR ("To install a spectrum database server "
+        << "a spectrum database must be installed first.");
+    }
+  else
+    {
+      server = CreateObject<SpectrumDbServer> ();
+      server->SetAttribute ("SocketPath", StringValue (socketPath));
+      server->SetSpectrumDb (m_specDbNode->GetObject<SpectrumDb> ());
+      m_specDbNode->AggregateObject (server);
+      server->Start ();
+    }
+  return server;
+}
+
+Ptr<SpectrumDbClient>
+CouwbatHelper::InstallSpectrumDbClient (Ptr<Node> node, std::string socketPath)
+{
+  NS_LOG_FUNCTION (this << node << socketPath);
+  Ptr<SpectrumDbClient> client;
+  if (m_specDbNode != 0)
+    {
+      NS_LOG_WARN ("You are trying to install a "
+        << "Couwbat Spectrum Database client although "
+        << "a spectrum database is already installed, "
+        << "the first one will be used instead.");
+    }
+  else
+    {
+      client = CreateObject<SpectrumDbClient> ();
+      client->SetAttribute ("SocketPath", StringValue (socketPath));
+      if (!client->Connect ())
+        {
+          NS_FATAL_ERROR ("Cannot connect to the spectrum database at " << socketPath);
+        }
+      node->AggregateObject (client);
+      m_specDbNode = node;
+    }
+  return client;
+}
+
 Ptr<PrimaryUserNetDevice>
 CouwbatHelper::InstallPrimaryUser (Ptr<Node> node, Ptr<SpectrumMap> map, Ptr<OnOffModel> onOffModel)
 {
   NS_LOG_FUNCTION (this << node << map << onOffModel);
   Ptr<PrimaryUserNetDevice> puNetDevice;
   Ptr<SpectrumDb> specDb;
-  if (m_specDbNode == 0)
+  if (m_specDbNode == 0 || !m_specDbNode->GetObject<SpectrumDb> ())
     {
       NS_LOG_ERROR ("To install a primary user "
         << "a spectrum database must be installed first.");
@@ -109,7 +160,7 @@ CouwbatHelper::InstallTraceBasedPu (
   NS_LOG_FUNCTION (this << node << onOffModel << fileName << samplingInterval << startingLine);
   Ptr<TraceBasedPuNetDevice> puNetDevice;
   Ptr<SpectrumDb> specDb;
-  if (m_specDbNode == 0)
+  if (m_specDbNode == 0 || !m_specDbNode->GetObject<SpectrumDb> ())
     {
       NS_LOG_ERROR ("To install a primary user "
         << "a spectrum database must be installed first.");
@@ -145,6 +196,13 @@ CouwbatHelper::InstallTraceBasedPu (
   return puNetDevice;
 }
 
+void
+CouwbatHelper::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  m_config = config;
+}
+
 Ptr<CouwbatNetDevice>
 CouwbatHelper::Install
   (
@@ -157,6 +215,10 @@ CouwbatHelper::Install
 
   // create a couwbat network device
   Ptr<CouwbatNetDevice> netDevice = CreateObject<CouwbatNetDevice> ();
+  if (m_config)
+    {
+      netDevice->SetConfig (m_config);
+    }
 
   // connect phy
   Ptr<CouwbatPhy> phy = phyHelper.Create (node, netDevice);
@@ -180,7 +242,11 @@ CouwbatHelper::Install
     {
       NS_LOG_INFO ("Created a CR-BS, adding SpectrumManager");
       Ptr<SpectrumManager> spectrumManager = CreateObject<SpectrumManager> ();
-      Ptr<SpectrumDb> specDb = m_specDbNode->GetObject<SpectrumDb> ();
+      Ptr<Object> specDb = m_specDbNode->GetObject<SpectrumDb> ();
+      if (!specDb)
+        {
+          specDb = m_specDbNode->GetObject<SpectrumDbClient> ();
+        }
       spectrumManager->SetSpectrumDb (specDb);
       netDevice->AggregateObject (spectrumManager);
     }
@@ -191,6 +257,25 @@ CouwbatHelper::Install
   return netDevice;
 }
 
+Ptr<PuPopulation>
+CouwbatHelper::InstallPuPopulation (Ptr<Node> node, Ptr<PuPopulation> population)
+{
+  NS_LOG_FUNCTION (this << node << population);
+  if (m_specDbNode == 0 || !m_specDbNode->GetObject<SpectrumDb> ())
+    {
+      NS_LOG_ERROR ("To install a primary user population "
+        << "a spectrum database must be installed first.");
+      return 0;
+    }
+
+  population->SetSpectrumDb (m_specDbNode->GetObject<SpectrumDb> ());
+  node->AggregateObject (population);
+
+  // start the primary users
+  Simulator::ScheduleWithContext (node->GetId (), Seconds (0), &PuPopulation::Start, population);
+  return population;
+}
+
 Ptr<SpectrumMap>
 CouwbatHelper::CreateSpectrumMap (uint32_t start_subcarrier, uint32_t n_subcarriers)
 {
@@ -221,6 +306,7 @@ CouwbatHelper::EnableLogComponents (void)
   LogComponentEnable ("OnceOnOffModel", LOG_LEVEL_ALL);
   LogComponentEnable ("PeriodicOnOffModel", LOG_LEVEL_ALL);
   LogComponentEnable ("RandomOnOffModel", LOG_LEVEL_ALL);
+  LogComponentEnable ("PuPopulation", LOG_LEVEL_ALL);
   LogComponentEnable ("SimpleCouwbatHelper", LOG_LEVEL_ALL);
   LogComponentEnable ("CouwbatChannel", LOG_LEVEL_ALL);
   LogComponentEnable ("SimpleCouwbatChannel", LOG_LEVEL_ALL);
@@ -231,6 +317,8 @@ CouwbatHelper::EnableLogComponents (void)
   LogComponentEnable ("StaCouwbatMac", LOG_LEVEL_ALL);
   LogComponentEnable ("CouwbatNetDevice", LOG_LEVEL_ALL);
   LogComponentEnable ("SpectrumManager", LOG_LEVEL_ALL);
+  LogComponentEnable ("SpectrumDbServer", LOG_LEVEL_ALL);
+  LogComponentEnable ("SpectrumDbClient", LOG_LEVEL_ALL);
 }
 
 } // namespace ns3
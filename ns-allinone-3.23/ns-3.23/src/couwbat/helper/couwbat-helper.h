@@ -9,13 +9,17 @@ namespace ns3 {
 class Node;
 class PrimaryUserNetDevice;
 class TraceBasedPuNetDevice;
+class PuPopulation;
 class SpectrumDb;
+class SpectrumDbServer;
+class SpectrumDbClient;
 class SpectrumMap;
 class OnOffModel;
 class OnceOnOffModel;
 class CouwbatPhy;
 class CouwbatMac;
 class CouwbatNetDevice;
+class CouwbatConfig;
 class NetDevice;
 
 /**
@@ -93,6 +97,27 @@ public:
    */
   Ptr<SpectrumDb> InstallSpectrumDb (Ptr<Node> node);
 
+  /**
+   * \param socketPath The file system path of the Unix domain socket to listen on.
+   * \return The started server, null if no spectrum database has been installed.
+   *
+   * Serve the spectrum database installed with InstallSpectrumDb to other processes.
+   * The server is aggregated to the node of the spectrum database.
+   */
+  Ptr<SpectrumDbServer> InstallSpectrumDbServer (std::string socketPath);
+
+  /**
+   * \param node The node on which to install the client.
+   * \param socketPath The file system path of the Unix domain socket of the server.
+   * \return The connected client, null if there already exists a spectrum database.
+   *
+   * Use the spectrum database of another process instead of installing one.
+   * CR-BSs installed afterwards use the client, primary users cannot be
+   * installed since they need direct access to the database.
+   * Aborts if the server cannot be reached.
+   */
+  Ptr<SpectrumDbClient> InstallSpectrumDbClient (Ptr<Node> node, std::string socketPath);
+
   /**
    * \param node A node on which to install a Primary User.
    * \param map The spectrum map that this primary user will use.
@@ -128,6 +153,19 @@ public:
       Ptr<Node> node, Ptr<OnOffModel> onOffModel, std::string fileName,
       Time samplingInterval, int startingLine);
 
+  /**
+   * \param node A node on which to install the population.
+   * \param population The population, with its primary users added and attributes set.
+   * \return The population, null if it could not be installed.
+   *
+   * Install a population of primary users (PuPopulation) on a given node.
+   * The primary users will inform the spectrum database that was installed
+   * with InstallSpectrumDb about their used subcarriers.
+   * If no spectrum database is available in this helper,
+   * the population cannot be installed.
+   */
+  Ptr<PuPopulation> InstallPuPopulation (Ptr<Node> node, Ptr<PuPopulation> population);
+
   /**
    * \param start_subcarrier The index of the first subcarrier that is set in the new spectrum map.
    * \param n_subcarriers The number of subcarriers to set.
@@ -146,6 +184,14 @@ public:
    */
   Ptr<OnceOnOffModel> CreateOnceOnOffModel (TimeValue firstOn, TimeValue finalOff);
 
+  /**
+   * \param config configuration of all devices created by Install from now on
+   *
+   * Devices of one cell should share one configuration. Without a call to
+   * SetConfig every device gets its own snapshot of the Couwbat statics.
+   */
+  void SetConfig (Ptr<CouwbatConfig> config);
+
   /**
    * \param phy the PHY helper to create PHY objects
    * \param mac the MAC helper to create MAC object
@@ -170,6 +216,7 @@ public:
 
 private:
   Ptr<Node> m_specDbNode; //!< the node on which the spectrum db gets installed
+  Ptr<CouwbatConfig> m_config; //!< configuration of installed devices, 0 for the device default
 
 };
 
@@ -3,6 +3,10 @@
 #include "couwbat.h"
 #include "ns3/log.h"
 #include "ns3/assert.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
 #include <algorithm>
 #include <numeric>
 
@@ -23,16 +27,77 @@ BsCouwbatMac::GetTypeId (void)
     .AddConstructor<BsCouwbatMac> ()
 
     .SetGroupName ("Couwbat")
+
+    .AddAttribute ("OuterLoopLinkAdaptation",
+                   "If true, the CQI used for MCS selection is corrected by a per STA and "
+                   "subchannel offset that is driven by the ACKs of DL bursts.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BsCouwbatMac::m_ollaEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("OllaTargetBler",
+                   "Target block error rate of DL bursts for outer-loop link adaptation.",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&BsCouwbatMac::m_ollaTargetBler),
+                   MakeDoubleChecker<double> (0.001, 0.5))
+    .AddAttribute ("OllaStepDown",
+                   "CQI offset decrease after a lost DL burst. The increase after an ACKed "
+                   "DL burst is derived from this value and OllaTargetBler.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&BsCouwbatMac::m_ollaStepDown),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("OllaMaxOffset",
+                   "Maximum absolute value of the outer-loop CQI offset.",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&BsCouwbatMac::m_ollaMaxOffset),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("OllaAckTimeout",
+                   "Number of superframes after which a DL burst without ACK is counted as lost.",
+                   UintegerValue (5),
+                   MakeUintegerAccessor (&BsCouwbatMac::m_ollaAckTimeout),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AdmissionControl",
+                   "If true, association requests are only accepted if every STA keeps at least "
+                   "MinGuaranteedRate after the admission.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BsCouwbatMac::m_admissionControl),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MinGuaranteedRate",
+                   "Minimum DL + UL rate per STA used by the admission control.",
+                   DataRateValue (DataRate ("1Mbps")),
+                   MakeDataRateAccessor (&BsCouwbatMac::m_minGuaranteedRate),
+                   MakeDataRateChecker ())
+    .AddTraceSource ("CellCapacity",
+                     "Estimated DL + UL capacity of the cell in bit/s for the currently associated STAs",
+                     MakeTraceSourceAccessor (&BsCouwbatMac::m_cellCapacity))
+    .AddTraceSource ("Admission",
+                     "Trace source indicating an admission decision for an associating STA "
+                     "together with the estimated per-STA rate after admission",
+                     MakeTraceSourceAccessor (&BsCouwbatMac::m_admissionTrace))
+    .AddTraceSource ("McsSelection",
+                     "Trace source indicating the MCS selected for a subchannel of a STA "
+                     "together with the applied outer-loop CQI offset",
+                     MakeTraceSourceAccessor (&BsCouwbatMac::m_mcsSelectionTrace))
   ;
   return tid;
 }
 
 BsCouwbatMac::BsCouwbatMac (void)
-: m_ccSelected (false)
+: m_ccSelected (false),
+  m_ollaEnabled (false),
+  m_ollaTargetBler (0.1),
+  m_ollaStepDown (1.0),
+  m_ollaMaxOffset (10.0),
+  m_ollaAckTimeout (5),
+  m_admissionControl (false),
+  m_minGuaranteedRate ("1Mbps"),
+  m_cellCapacity (0)
 {
   NS_LOG_FUNCTION (this);
 
   m_rxOkCallback = MakeCallback (&BsCouwbatMac::RxOk, this);
+  m_txQueue.SetDequeueCallback (MakeCallback (&BsCouwbatMac::NotifyQueueDelay, this));
+  m_txQueue.SetDropCallback (MakeCallback (&BsCouwbatMac::NotifyQueueDrop, this));
+  m_txQueue.SetConfig (m_config);
 }
 
 BsCouwbatMac::~BsCouwbatMac (void)
@@ -41,6 +106,14 @@ BsCouwbatMac::~BsCouwbatMac (void)
   DoDispose ();
 }
 
+void
+BsCouwbatMac::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  CouwbatMac::SetConfig (config);
+  m_txQueue.SetConfig (config);
+}
+
 bool
 BsCouwbatMac::IsLinkUp (void) const
 {
@@ -63,6 +136,12 @@ BsCouwbatMac::DoInitialize (void)
         {
           NS_FATAL_ERROR ("Initialising base station without a spectrum manager!");
         }
+      // Without a partition policy registering would only make the database track load changes
+      if (m_specManager->IsCoordinationEnabled ())
+        {
+          m_specManager->RegisterCrBs (m_address);
+        }
+      ConnectSpectrumManager ();
 
       if (!m_phy)
         {
@@ -89,7 +168,7 @@ BsCouwbatMac::DoInitialize (void)
   m_ccSelected = false;
 
   // TODO use different sequences of SEQ numbers for different STAs
-  m_seq = std::rand ();
+  m_seq = std::rand () % CouwbatTxHistoryBuffer::NO_ACK;
 
   m_restoreBackupCcTempStasTimeout = -1;
 
@@ -101,9 +180,10 @@ BsCouwbatMac::SelectNewCcNoBackup (void)
   NS_LOG_FUNCTION (this);
   m_allocatedNbSubChannels[0].reset ();
   bool selected = false;
-  for (uint32_t ccId = 0; ccId < Couwbat::GetNumberOfSubchannels (); ++ccId)
+  const std::bitset<Couwbat::MAX_SUBCHANS> usable = m_specManager->GetUsableSubchannels ();
+  for (uint32_t ccId = 0; ccId < m_config->GetNumberOfSubchannels (); ++ccId)
     {
-      if (m_specManager->IsCcFree (ccId))
+      if (usable.test (ccId))
         {
           m_allocatedNbSubChannels[0].set (ccId, true);
           m_ccId[0] = ccId;
@@ -124,13 +204,49 @@ BsCouwbatMac::SelectNewCcNoBackup (void)
   return true;
 }
 
+void
+BsCouwbatMac::ConnectSpectrumManager (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_specManager->TraceConnectWithoutContext ("SubchannelsChanged",
+                                             MakeCallback (&BsCouwbatMac::NotifySubchannelsChanged, this));
+}
+
+void
+BsCouwbatMac::NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                        std::bitset<Couwbat::MAX_SUBCHANS> becameFree)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_ccSelected || !becameBusy.test (m_ccId[0]))
+    {
+      return;
+    }
+  NS_LOG_INFO ("CR-BS " << m_address << ": primary user arrived on active CC " << m_ccId[0]);
+
+  // Stop using the CC now instead of at the next superframe: the DL/UL grants of the
+  // last MAP are skipped if their bursts would use it, and the cell moves to the backup
+  // CC or a new one. Transmissions already scheduled in the PHY are not recalled.
+  if (m_pssHistory[1].m_allocation.test (m_ccId[0]))
+    {
+      m_downlinkMapSubpacketHistory[0].clear ();
+      m_uplinkMapSubpacketHistory[0].clear ();
+    }
+
+  // If no CC is free, StartSuperframe retries since m_ccSelected is false
+  if (!SelectCc ())
+    {
+      NS_LOG_INFO ("CR-BS " << m_address << " cannot find free subchannel");
+    }
+}
+
 void BsCouwbatMac::SelectBackupCc (void)
 {
   // Select backup CC
   m_backupCc.fields.chSwitchActive = false;
-  for (uint32_t ccId = 0; ccId < Couwbat::GetNumberOfSubchannels (); ++ccId)
+  const std::bitset<Couwbat::MAX_SUBCHANS> usable = m_specManager->GetUsableSubchannels ();
+  for (uint32_t ccId = 0; ccId < m_config->GetNumberOfSubchannels (); ++ccId)
     {
-      if (m_specManager->IsCcFree (ccId) && ccId != m_ccId[0])
+      if (usable.test (ccId) && ccId != m_ccId[0])
         {
           // Found backup CC
           m_backupCc.fields.newChNumber = ccId;
@@ -149,14 +265,15 @@ BsCouwbatMac::UpdateWidebandDetails (const CouwbatMetaHeader &mh)
   NS_LOG_FUNCTION (this);
   m_allocatedWbSubChannels[0].reset ();
   int count = 0;
-  for (uint32_t ccId = 0; ccId < Couwbat::GetNumberOfSubchannels (); ++ccId)
+  const std::bitset<Couwbat::MAX_SUBCHANS> usable = m_specManager->GetUsableSubchannels ();
+  for (uint32_t ccId = 0; ccId < m_config->GetNumberOfSubchannels (); ++ccId)
     {
-      if (m_specManager->IsCcFree (ccId))
+      if (usable.test (ccId))
         {
           // Avoid low CQI wideband subchannels according to STA feedback during CR-BS wideband channel selection per superframe
           bool avoid = false;
 
-          if (Couwbat::mac_avoid_low_cqi_wb_subchannels) // Only do this if functionality is enabled
+          if (m_config->IsAvoidLowCqiEnabled ()) // Only do this if functionality is enabled
             {
               int entriesRead = 0;
               int entriesAgainst = 0;
@@ -187,8 +304,11 @@ BsCouwbatMac::UpdateWidebandDetails (const CouwbatMetaHeader &mh)
                         }
 
                       ++entriesRead;
-                      cqis.push_back (entry.cqi[ccId]);
-                      if (entry.cqi[ccId] < Couwbat::mac_below_value_avoid_low_cqi_wb_subchannels)
+                      if (COUWBAT_LOG_ENABLED (LOG_INFO))
+                        {
+                          cqis.push_back (entry.cqi[ccId]);
+                        }
+                      if (entry.cqi[ccId] < m_config->GetAvoidLowCqiValue ())
                         {
                           // Entry is below minimum CQI value. Count as "against this subchannel"
                           ++entriesAgainst;
@@ -202,18 +322,21 @@ BsCouwbatMac::UpdateWidebandDetails (const CouwbatMetaHeader &mh)
                   double ratio = double(entriesAgainst) / double (entriesRead);
 
                   // If ratio exceeds the threshold percentage, skip using this subchannel despite it being unoccupied according to SpecDb
-                  if (ratio >= Couwbat::mac_against_threshold_avoid_low_cqi_wb_subchannels)
+                  if (ratio >= m_config->GetAvoidLowCqiThreshold ())
                     {
-                      // Print info and list of CQI feedback values that lead to this decision
-                      std::ostringstream ss;
-                      ss << "Read " << entriesRead << " total CQI feedback entries from STA(s) regarding subchannel "
-                                   << ccId << ", entries against: " << entriesAgainst;
-
-                      ss << " => Avoiding unoccupied wideband subchannel " << ccId << " due to negative CQI feedback from STA(s): {";
-                      std::copy (cqis.begin(), cqis.end() - 1, std::ostream_iterator<int>(ss, ","));
-                      ss << int(cqis.back ());
-                      ss << "}";
-                      NS_LOG_INFO (ss.str ());
+                      if (COUWBAT_LOG_ENABLED (LOG_INFO))
+                        {
+                          // Print info and list of CQI feedback values that lead to this decision
+                          std::ostringstream ss;
+                          ss << "Read " << entriesRead << " total CQI feedback entries from STA(s) regarding subchannel "
+                                       << ccId << ", entries against: " << entriesAgainst;
+
+                          ss << " => Avoiding unoccupied wideband subchannel " << ccId << " due to negative CQI feedback from STA(s): {";
+                          std::copy (cqis.begin(), cqis.end() - 1, std::ostream_iterator<int>(ss, ","));
+                          ss << int(cqis.back ());
+                          ss << "}";
+                          NS_LOG_INFO (ss.str ());
+                        }
 
                       avoid = true;
                     }
@@ -228,9 +351,13 @@ BsCouwbatMac::UpdateWidebandDetails (const CouwbatMetaHeader &mh)
         }
     }
   m_wbSubchannelCnt[0] = count;
-  std::string wbSubChannelString = m_allocatedWbSubChannels[0].to_string ();
-  std::reverse (wbSubChannelString.begin (), wbSubChannelString.end ());
-  NS_LOG_INFO ("CR-BS " << m_address << " using " << count << " wideband subchannels: " << wbSubChannelString);
+  m_specManager->ReportAllocation (m_allocatedWbSubChannels[0] | m_allocatedNbSubChannels[0]);
+  if (COUWBAT_LOG_ENABLED (LOG_INFO))
+    {
+      std::string wbSubChannelString = m_allocatedWbSubChannels[0].to_string ();
+      std::reverse (wbSubChannelString.begin (), wbSubChannelString.end ());
+      NS_LOG_INFO ("CR-BS " << m_address << " using " << count << " wideband subchannels: " << wbSubChannelString);
+    }
   return count > 0;
 }
 
@@ -303,6 +430,8 @@ BsCouwbatMac::StartSuperframe (const CouwbatMetaHeader &mh)
   m_downlinkMapSubpacketHistory[0].clear ();
   m_uplinkMapSubpacketHistory[1] = m_uplinkMapSubpacketHistory[0];
   m_uplinkMapSubpacketHistory[0].clear ();
+  m_mapAnnounce[1] = m_mapAnnounce[0];
+  m_mapAnnounce[0].clear ();
   m_mapPaddingBytes[2] = m_mapPaddingBytes[1];
   m_mapPaddingBytes[1] = m_mapPaddingBytes[0];
   m_mapSizeSymbols[2] = m_mapSizeSymbols[1];
@@ -321,6 +450,9 @@ BsCouwbatMac::StartSuperframe (const CouwbatMetaHeader &mh)
   m_staDataMcs[0].clear ();
   m_txHistory.SuperframeTick (m_txQueue);
 
+  // Let the spectrum database know how busy this cell is, used for inter-cell partitioning
+  m_specManager->ReportLoad (m_associatedStas[0].size () + m_newStas.size ());
+
   // Check if CC is free, select new CC or abort superframe if no CC is available
   if (!m_ccSelected || !m_specManager->IsCcFree (m_ccId[0]))
     {
@@ -328,6 +460,7 @@ BsCouwbatMac::StartSuperframe (const CouwbatMetaHeader &mh)
         {
           // No free CC available
           NS_LOG_INFO ("CR-BS " << m_address << " cannot find free subchannel");
+          m_specManager->ReportAllocation (std::bitset<Couwbat::MAX_SUBCHANS> ());
           return;
         }
     }
@@ -360,6 +493,8 @@ BsCouwbatMac::StartSuperframe (const CouwbatMetaHeader &mh)
     }
 
   CleanCqiHist (mh.m_ofdm_sym_sframe_count);
+  OllaExpirePending (mh.m_ofdm_sym_sframe_count);
+  ReleaseTxHistory ();
 
   // Check availability of wideband channels and update accordingly
   if (!UpdateWidebandDetails (mh))
@@ -373,20 +508,23 @@ BsCouwbatMac::StartSuperframe (const CouwbatMetaHeader &mh)
   NS_LOG_LOGIC ("CR-BS " << m_address << " superframe starting");
 
   // Print extra info
-  std::ostringstream ss;
-  ss << "CR-BS " << m_address << " current parameters: CC=" << m_ccId[0];
-  ss << ", BackupCC=" << m_backupCc.fields.newChNumber;
-  ss << ", AssociatedStas={";
-  for (size_t i = 0; i < m_associatedStas[0].size (); ++i)
+  if (COUWBAT_LOG_ENABLED (LOG_INFO))
     {
-      ss << m_associatedStas[0][i] << ",";
-    }
-  ss << "}";
-  if (!m_netlinkMode)
-    {
-      ss << ", TimeSinceLastCcChange=" << Simulator::Now () - m_lastCcChange;
+      std::ostringstream ss;
+      ss << "CR-BS " << m_address << " current parameters: CC=" << m_ccId[0];
+      ss << ", BackupCC=" << m_backupCc.fields.newChNumber;
+      ss << ", AssociatedStas={";
+      for (size_t i = 0; i < m_associatedStas[0].size (); ++i)
+        {
+          ss << m_associatedStas[0][i] << ",";
+        }
+      ss << "}";
+      if (!m_netlinkMode)
+        {
+          ss << ", TimeSinceLastCcChange=" << Simulator::Now () - m_lastCcChange;
+        }
+      NS_LOG_INFO (ss.str ());
     }
-  NS_LOG_INFO (ss.str ());
 
   // Do work
 
@@ -404,7 +542,7 @@ BsCouwbatMac::SendPss (const CouwbatMetaHeader &mhSfStart)
   NS_LOG_LOGIC ("CR-BS " << m_address << " starting PSS transmission on subchannel " << m_ccId[0]);
 
   unsigned int stas = m_associatedStas[0].size ();
-  unsigned int symbWideband = 2446; // TODO should this be hard coded? Maybe add to couwbat.h?
+  const unsigned int symbWideband = GetWidebandSymbols ();
 
   for (std::vector<Mac48Address>::iterator macIterator = m_associatedStas[0].begin (); macIterator != m_associatedStas[0].end (); ++macIterator)
     {
@@ -412,7 +550,16 @@ BsCouwbatMac::SendPss (const CouwbatMetaHeader &mhSfStart)
       m_staDataMcs[0].push_back (GetOptimalMcs (*macIterator, m_allocatedWbSubChannels[0], mhSfStart));
     }
 
-  BsCouwbatMac::MapLengthRetType ml = GetMapLength (stas, m_wbSubchannelCnt[0], symbWideband, m_staDataMcs[0]);
+  if (m_config->IsCompactMapEnabled ())
+    {
+      UpdateShortIds ();
+    }
+
+  BsCouwbatMac::MapLengthRetType ml = GetMapLength (stas, m_wbSubchannelCnt[0], symbWideband, m_staDataMcs[0], m_mapAnnounce[0].size ());
+
+  double cellCapacity = 0;
+  EstimateStaCapacity (m_staDataMcs[0], ml, cellCapacity);
+  m_cellCapacity = cellCapacity;
 
   m_mapPaddingBytes[0] = ml.mapPaddingBytes;
   m_mapSizeSymbols[0] = ml.mapSymbols;
@@ -428,7 +575,7 @@ BsCouwbatMac::SendPss (const CouwbatMetaHeader &mhSfStart)
   pss->AddHeader (pssHeader);
 
   CouwbatPacketHelper::CreateCouwbatControlPacket(pss, COUWBAT_FC_CONTROL_PSS, m_address, Mac48Address("ff:ff:ff:ff:ff:ff"), 0);
-  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
   double pssPaddingBytes = 0;
   const uint32_t pssTxDurationSymb = NecessarySymbolsForBytes (m_pssSizeBytes, 1, pssMcs, pssPaddingBytes);
   NS_ASSERT (pssPaddingBytes == 0);
@@ -439,7 +586,7 @@ BsCouwbatMac::SendPss (const CouwbatMetaHeader &mhSfStart)
   mh.m_ofdm_sym_offset = 0;
   mh.m_ofdm_sym_len = pssTxDurationSymb;
   mh.m_allocatedSubChannels = m_allocatedNbSubChannels[0];
-  mh.m_MCS[m_ccId[0]] = Couwbat::GetDefaultMcs ();
+  mh.m_MCS[m_ccId[0]] = m_config->GetDefaultMcs ();
 
   NS_LOG_DEBUG ("schedule PSS");
   Send (mh, pss);
@@ -452,22 +599,22 @@ BsCouwbatMac::RecvAssoc (const CouwbatMetaHeader &mhSfStart)
 {
   NS_LOG_LOGIC ("CR-BS " << m_address << " scheduling assoc RX");
 
-  std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+  std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
   double padding;
   const uint32_t pssTxDurationSymb = NecessarySymbolsForBytes(m_pssSizeBytes, 1, nbMcs, padding);
   const uint32_t assocTxDurationSymb = NecessarySymbolsForBytes(m_assocSizeBytes, 1, nbMcs, padding);
   NS_ASSERT (padding == 0);
-  const uint32_t guard = Couwbat::GetAlohaNrGuardSymbols ();
+  const uint32_t guard = m_config->GetAlohaNrGuardSymbols ();
 
   CouwbatMetaHeader schedRxMh;
   schedRxMh.m_flags = CW_CMD_WIFI_EXTRA_ZERO_RX;
   schedRxMh.m_ofdm_sym_sframe_count = mhSfStart.m_ofdm_sym_sframe_count + 1;
   schedRxMh.m_ofdm_sym_len = assocTxDurationSymb;
-  schedRxMh.m_ofdm_sym_offset = pssTxDurationSymb + Couwbat::GetAlohaNrGuardSymbols ();
+  schedRxMh.m_ofdm_sym_offset = pssTxDurationSymb + m_config->GetAlohaNrGuardSymbols ();
   schedRxMh.m_allocatedSubChannels = m_allocatedNbSubChannels[0];
-  schedRxMh.m_MCS[m_ccId[0]] = Couwbat::GetDefaultMcs ();
+  schedRxMh.m_MCS[m_ccId[0]] = m_config->GetDefaultMcs ();
 
-  for (uint32_t i = 0; i < Couwbat::GetContentionSlotCount (); ++i)
+  for (uint32_t i = 0; i < m_config->GetContentionSlotCount (); ++i)
     {
       Ptr<Packet> schedRx = Create<Packet> ();
       NS_LOG_DEBUG ("schedule assoc RX");
@@ -488,29 +635,17 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
     {
       return;
     }
+  if (m_staDataMcs[1].empty () || m_mapUlDlSlotsPerSta[1] == 0)
+    {
+      // Nothing to schedule: the last superframe was aborted before its PSS, e.g.
+      // without free wideband subchannels, or not even one DL/UL slot per STA fit
+      return;
+    }
 
-  // Get an MCS vector for narrowband (control) phase with 1 subchannel and default MCS
-  const std::vector<CouwbatMCS> narrowbandMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
-
-  double padding;
-  // pssTxDurationSymb: 12 = 10 + 2 (preamble)
-  const double pssTxDurationSymb = NecessarySymbolsForBytes (m_pssSizeBytes, 1, narrowbandMcs, padding);
-  NS_ASSERT (padding == 0); // implies pssTxDurationSymb is whole number
-
-  // singleAssocTxDurationSymb: 8 = 6 + 2 (preamble)
-  const double singleAssocTxDurationSymb = NecessarySymbolsForBytes (m_assocSizeBytes, 1, narrowbandMcs, padding);
-  NS_ASSERT (padding == 0); // implies singleAssocTxDurationSymb is whole number
-
-  const unsigned int alohaGuardSymb = Couwbat::GetAlohaNrGuardSymbols ();
-  const unsigned int widebandBaseOffsetSymb = pssTxDurationSymb + Couwbat::GetContentionSlotCount () * (singleAssocTxDurationSymb + alohaGuardSymb) + alohaGuardSymb;
-
-  // sf_symbols: 2500
-  const unsigned int superframeTotalSymb = Couwbat::GetSuperframeDuration() / Couwbat::GetSymbolDuration();
-
-  // total wideband symbols: 2446. TODO inconsistent: hardcoded in SendPss, but calculated here
-  const unsigned int widebandTotalSymb = superframeTotalSymb - widebandBaseOffsetSymb;
+  const unsigned int widebandBaseOffsetSymb = GetWidebandOffset ();
+  const unsigned int widebandTotalSymb = GetWidebandSymbols ();
 
-  const unsigned int widebandGuardSymb = Couwbat::GetSuperframeGuardSymbols ();
+  const unsigned int widebandGuardSymb = m_config->GetSuperframeGuardSymbols ();
 
   unsigned int mapLengthExtraSymbols = 0;
   if (m_mapSizeSymbols[0] > m_mapSizeSymbols[1] && m_mapSizeSymbols[1] != 0 && m_mapUlDlSlotsPerSta[1] != 0)
@@ -524,7 +659,7 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
   // Subtract: guard time between MAP and data phase + guard time at the end of data phase before next PSS + 1x MAP TX symbol count
   const unsigned int dataPhaseUsableSymb = widebandTotalSymb - (2 * widebandGuardSymb) - m_mapSizeSymbols[1] - mapLengthExtraSymbols;
 
-  const double downlinkSymb = std::floor (Couwbat::GetDataPhaseDownlinkPortion () * dataPhaseUsableSymb);
+  const double downlinkSymb = std::floor (m_config->GetDataPhaseDownlinkPortion () * dataPhaseUsableSymb);
   const double uplinkSymb = dataPhaseUsableSymb - downlinkSymb;
 
   // Total number of DL and UL symbols per STA, remove a few to serve as guard
@@ -542,6 +677,7 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
   // Save MAP subpackets for each STA here
   std::vector<Ptr<Packet> > downlinkMapSubpackets;
   std::vector<Ptr<Packet> > uplinkMapSubpackets;
+  std::vector<std::vector<CouwbatMapSubpacket> > staDlHeaders (staCount);
 
   NS_LOG_INFO ("MAP DL/UL slot count: " << m_mapUlDlSlotsPerSta[1]);
 
@@ -588,9 +724,12 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
             ulHeader.m_ofdm_count = uplinkOfdmCount;
             NS_LOG_DEBUG ("ulHeader uplinkOffset=" << uplinkOffset << ", uplinkOfdmCount=" << uplinkOfdmCount);
             ulHeader.SetAmc (dataMcs);
-            Ptr<Packet> ulSubp = Create<Packet> ();
-            ulSubp->AddHeader(ulHeader);
-            uplinkMapSubpackets.push_back (ulSubp);
+            if (!m_config->IsCompactMapEnabled ())
+              {
+                Ptr<Packet> ulSubp = Create<Packet> ();
+                ulSubp->AddHeader(ulHeader);
+                uplinkMapSubpackets.push_back (ulSubp);
+              }
 
             m_uplinkMapSubpacketHistory[0].push_back (ulHeader);
 
@@ -616,34 +755,61 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
               }
             NS_ASSERT (downlinkOfdmCount > 0);
 
-            // Downlink map subpacket
+            // Downlink map subpacket, the offset is assigned below once the DL order is known
             CouwbatMapSubpacket dlHeader;
             dlHeader.m_ie_id = *macIterator;
-            NS_LOG_DEBUG ("dlHeader downlinkOffset: " << downlinkOffset << ", downlinkOfdmCount=" << downlinkOfdmCount);
-            dlHeader.m_ofdm_offset = downlinkOffset;
             dlHeader.m_ofdm_count = downlinkOfdmCount;
             dlHeader.SetAmc (dataMcs);
-            Ptr<Packet> dlSubp = Create<Packet> ();
-            dlSubp->AddHeader(dlHeader);
-            downlinkMapSubpackets.push_back (dlSubp);
+            staDlHeaders[macIterator - m_associatedStas[1].begin ()].push_back (dlHeader);
+          }
+      }
+    }
+
+  // DL slots of STAs with higher priority traffic queued come first in the data phase
+  std::vector<std::pair<uint32_t, uint32_t> > dlOrder;
+  for (uint32_t i = 0; i < staCount; ++i)
+    {
+      const uint32_t tc = m_config->IsClassDlOrderEnabled () ? m_txQueue.GetTopClass (m_associatedStas[1][i]) : 0;
+      dlOrder.push_back (std::make_pair (tc, i));
+    }
+  std::stable_sort (dlOrder.begin (), dlOrder.end ());
 
-            m_downlinkMapSubpacketHistory[0].push_back (dlHeader);
+  for (std::vector<std::pair<uint32_t, uint32_t> >::iterator it = dlOrder.begin (); it != dlOrder.end (); ++it)
+    {
+      std::vector<CouwbatMapSubpacket> &dlHeaders = staDlHeaders[it->second];
+      for (std::vector<CouwbatMapSubpacket>::iterator dlHeader = dlHeaders.begin (); dlHeader != dlHeaders.end (); ++dlHeader)
+        {
+          NS_LOG_DEBUG ("dlHeader downlinkOffset: " << downlinkOffset << ", downlinkOfdmCount=" << dlHeader->m_ofdm_count
+                        << ", class=" << it->first);
+          dlHeader->m_ofdm_offset = downlinkOffset;
+          if (!m_config->IsCompactMapEnabled ())
+            {
+              Ptr<Packet> dlSubp = Create<Packet> ();
+              dlSubp->AddHeader (*dlHeader);
+              downlinkMapSubpackets.push_back (dlSubp);
+            }
 
-            downlinkOffset += dlHeader.m_ofdm_count;
-          }
+          m_downlinkMapSubpacketHistory[0].push_back (*dlHeader);
 
-        downlinkOffset += widebandGuardSymb;
+          downlinkOffset += dlHeader->m_ofdm_count;
+        }
 
-      }
+      downlinkOffset += widebandGuardSymb;
     }
 
   // Create MAP and send
-  Ptr<Packet> map = CouwbatPacketHelper::CreateMap (m_address, downlinkMapSubpackets, uplinkMapSubpackets);
+  Ptr<Packet> map;
+  if (m_config->IsCompactMapEnabled ())
+    {
+      map = CouwbatPacketHelper::CreateMap (m_address, m_downlinkMapSubpacketHistory[0], m_uplinkMapSubpacketHistory[0],
+                                            m_shortIds, m_mapAnnounce[1]);
+    }
+  else
+    {
+      map = CouwbatPacketHelper::CreateMap (m_address, downlinkMapSubpackets, uplinkMapSubpackets);
+    }
   // Add real padding
-  uint8_t *buf = new uint8_t[m_mapPaddingBytes[1]];
-  Ptr<Packet> padPacket = Create<Packet> (buf, m_mapPaddingBytes[1]);
-  delete[] buf;
-  map->AddAtEnd (padPacket);
+  CouwbatPacketHelper::AddPadding (map, m_mapPaddingBytes[1]);
 
   CouwbatMetaHeader mapTxMh;
   mapTxMh.m_flags = CW_CMD_WIFI_EXTRA_TX;
@@ -652,13 +818,14 @@ BsCouwbatMac::SendMap (const CouwbatMetaHeader &mhSfStart)
   mapTxMh.m_ofdm_sym_len = m_mapSizeSymbols[1];
   mapTxMh.m_allocatedSubChannels = m_pssHistory[1].m_allocation;
 
-  double msz = NecessarySymbolsForBytes (map->GetSize (), m_wbSubchannelCnt[1], std::vector<CouwbatMCS> (m_wbSubchannelCnt[1], Couwbat::GetDefaultMcs ()), padding);
+  double padding;
+  double msz = NecessarySymbolsForBytes (map->GetSize (), m_wbSubchannelCnt[1], std::vector<CouwbatMCS> (m_wbSubchannelCnt[1], m_config->GetDefaultMcs ()), padding);
   NS_ASSERT_MSG (m_mapSizeSymbols[1] == msz, "m_mapSizeSymbols[1]: " << m_mapSizeSymbols[1] << "; NecessarySymbolsForBytes: " << msz);
   NS_ASSERT (padding == 0);
 
-  for (uint32_t subCh = 0; subCh < Couwbat::GetNumberOfSubchannels (); ++subCh)
+  for (uint32_t subCh = 0; subCh < m_config->GetNumberOfSubchannels (); ++subCh)
     {
-      if (m_pssHistory[1].m_allocation.test (subCh)) mapTxMh.m_MCS[subCh] = Couwbat::GetDefaultMcs ();
+      if (m_pssHistory[1].m_allocation.test (subCh)) mapTxMh.m_MCS[subCh] = m_config->GetDefaultMcs ();
     }
 
   NS_LOG_DEBUG ("Created MAP to send (" << msz << " symbols) ");
@@ -697,20 +864,26 @@ BsCouwbatMac::SendDl (const CouwbatMetaHeader &mhSfStart)
         }
       NS_ASSERT (mcsVector.size () == m_wbSubchannelCnt[2]);
 
+      // Index of this DL burst among the DL bursts to the same STA, selects the UL SEQ to ACK
+      const uint8_t staDlIndex = nrDlPacketsCreated[dest]++;
+
       uint8_t ack;
-      if (dlMapSubpIndex < m_lastSeq[dest].size ())
+      if (staDlIndex < m_lastSeq[dest].size ())
         {
-          ack = m_lastSeq[dest][dlMapSubpIndex];
+          ack = m_lastSeq[dest][staDlIndex];
         }
       else
         {
-          ack = 0; // TODO What value to put here? Maybe needs a reserved SEQ number for "not an ACK"
+          // No UL burst of this STA left to ACK
+          ack = CouwbatTxHistoryBuffer::NO_ACK;
         }
 
       // Data packet
       double maxSizeBytes = TransmittableBytesWithSymbols (downlinkSymbolCount, m_wbSubchannelCnt[2], mcsVector);
       NS_ASSERT (maxSizeBytes == floor (maxSizeBytes));
       std::vector<Ptr<Packet> > dummyHistory;
+      std::vector<Ptr<Packet> > &payloadHist = m_config->IsArqEnabled () ? *m_txHistory.GetNewList (dest, m_seq) : dummyHistory;
+      const uint8_t seq = m_seq;
       Ptr<Packet> dlPack = CouwbatPacketHelper::CreateDlDataPacket(
           m_address,
           dest,
@@ -718,11 +891,10 @@ BsCouwbatMac::SendDl (const CouwbatMetaHeader &mhSfStart)
           m_txQueue,
           maxSizeBytes,
           ack,
-          // txHistory retransmission disabled
-//          *m_txHistory.GetNewList (dest, m_seq)
-          dummyHistory
+          payloadHist,
+          m_packetScratch
           );
-      ++m_seq;
+      m_seq = CouwbatTxHistoryBuffer::NextSeq (m_seq);
 
       if (!dlPack)
         {
@@ -730,14 +902,12 @@ BsCouwbatMac::SendDl (const CouwbatMetaHeader &mhSfStart)
           continue;
         }
 
+      OllaAddPending (dest, seq, m_pssHistory[2].m_allocation, mhSfStart.m_ofdm_sym_sframe_count);
+
       NS_LOG_DEBUG ("DL padding=" << maxSizeBytes - dlPack->GetSize ());
       NS_LOG_DEBUG ("DL pack size=" << dlPack->GetSize ());
       // Add real padding
-      int paddingSize = maxSizeBytes - dlPack->GetSize ();
-      uint8_t *buf = new uint8_t[paddingSize];
-      Ptr<Packet> padPacket = Create<Packet> (buf, paddingSize);
-      delete[] buf;
-      dlPack->AddAtEnd (padPacket);
+      CouwbatPacketHelper::AddPadding (dlPack, maxSizeBytes - dlPack->GetSize ());
 
       // Downlink data packet TX metaheader
       double padding;
@@ -841,8 +1011,11 @@ BsCouwbatMac::RxOkHandleExtraRx (const CouwbatMetaHeader &mh, Ptr<Packet> packet
       if (CheckControlPacket (packet)) return;
     }
 
-  std::string ps = packet->ToString ();
-  if (ps != "") NS_LOG_DEBUG("CR-BS " << m_address << " RX: {" << ps << "}");
+  if (COUWBAT_LOG_ENABLED (LOG_DEBUG))
+    {
+      std::string ps = packet->ToString ();
+      if (ps != "") NS_LOG_DEBUG("CR-BS " << m_address << " RX: {" << ps << "}");
+    }
 
   // Get header
   CouwbatMacHeader ch;
@@ -875,13 +1048,19 @@ BsCouwbatMac::RxOkHandleExtraRx (const CouwbatMetaHeader &mh, Ptr<Packet> packet
         CouwbatUlBurstHeader ulHeader;
 
         std::vector<Ptr<Packet> > data;
-        bool fcsCorrect = CouwbatPacketHelper::GetPayload (packet, data, &ulHeader);
+        bool fcsCorrect = CouwbatPacketHelper::GetPayload (packet, m_packetScratch, data, &ulHeader);
 //        NS_LOG_DEBUG ("BsCouwbatMac::RxOkHandleExtraRx() packet ref count: " << packet->GetReferenceCount ());
         if (!fcsCorrect) return;
 
         // Register ACKed entry
-        // txHistory retransmission disabled
-//        m_txHistory.RegisterAck (src, ulHeader.m_ack);
+        if (m_config->IsArqEnabled ())
+          {
+            m_txHistory.RegisterAck (src, ulHeader.m_ack);
+          }
+        OllaRegisterAck (src, ulHeader.m_ack);
+
+        // The STA has decoded a MAP with its short ID, no need to announce it any longer
+        m_shortIdConfirmed.insert (src);
 
         m_lastSeq[src].push_back (ch.GetSequence ());
 
@@ -934,15 +1113,90 @@ void
 BsCouwbatMac::AddSta (Mac48Address addr)
 {
   NS_LOG_FUNCTION (this << addr);
+  // A (re)associating STA has to learn its short ID again
+  m_shortIdConfirmed.erase (addr);
   // Don't add if already present
   if (std::find (m_associatedStas[0].begin (), m_associatedStas[0].end (), addr)
-      == m_associatedStas[0].end ())
+      != m_associatedStas[0].end ()
+      || std::find (m_newStas.begin (), m_newStas.end (), addr) != m_newStas.end ())
     {
-      m_newStas.push_back (addr);
-      NS_LOG_INFO ("CR-BS " << m_address
-       << " added STA "
-       << addr);
+      return;
     }
+
+  if (m_admissionControl)
+    {
+      // STAs of the current superframe keep their MCS, new STAs start with the default MCS
+      const std::vector<CouwbatMCS> defaultMcs (m_wbSubchannelCnt[0], m_config->GetDefaultMcs ());
+      std::vector<std::vector<CouwbatMCS> > dataMcs;
+      for (unsigned int i = 0; i < m_associatedStas[0].size (); ++i)
+        {
+          bool valid = m_staDataMcs[0].size () == m_associatedStas[0].size ()
+              && m_staDataMcs[0][i].size () == m_wbSubchannelCnt[0];
+          dataMcs.push_back (valid ? m_staDataMcs[0][i] : defaultMcs);
+        }
+      dataMcs.resize (dataMcs.size () + m_newStas.size () + 1, defaultMcs);
+
+      double totalRate;
+      const double staRate = m_wbSubchannelCnt[0] == 0 ? 0 :
+          EstimateStaCapacity (dataMcs, GetMapLength (dataMcs.size (), m_wbSubchannelCnt[0], GetWidebandSymbols (), dataMcs, dataMcs.size ()), totalRate);
+      const bool admitted = staRate >= m_minGuaranteedRate.GetBitRate ();
+      m_admissionTrace (addr, admitted, staRate);
+      if (!admitted)
+        {
+          NS_LOG_INFO ("CR-BS " << m_address << " deferred STA " << addr
+                       << ", estimated per-STA rate after admission " << staRate
+                       << " bit/s is below " << m_minGuaranteedRate);
+          return;
+        }
+    }
+
+  m_newStas.push_back (addr);
+  NS_LOG_INFO ("CR-BS " << m_address
+   << " added STA "
+   << addr);
+}
+
+double
+BsCouwbatMac::EstimateStaCapacity (const std::vector<std::vector<CouwbatMCS> > &dataMcs, const MapLengthRetType &ml, double &totalRate)
+{
+  NS_LOG_FUNCTION (this << dataMcs.size ());
+
+  totalRate = 0;
+  const unsigned int stas = dataMcs.size ();
+  const unsigned int subchannels = m_wbSubchannelCnt[0];
+  if (stas == 0 || subchannels == 0)
+    {
+      return 0;
+    }
+
+  const unsigned int symbWideband = GetWidebandSymbols ();
+  const unsigned int guard = m_config->GetSuperframeGuardSymbols ();
+  if (ml.ulDlSlotsPerSta == 0 || symbWideband <= ml.mapSymbols + 2 * guard)
+    {
+      // Data transmission would stop for all STAs
+      return 0;
+    }
+
+  // Share of the data phase per STA, minus the guards after its DL and UL bursts, as in SendMap
+  const double dataPhaseSymb = symbWideband - ml.mapSymbols - 2 * guard;
+  const double staSymb = dataPhaseSymb / stas - 2 * guard;
+  if (staSymb <= 0)
+    {
+      return 0;
+    }
+
+  const double superframesPerSecond = 1e6 / m_config->GetSuperframeDuration ();
+  double minRate = -1;
+  for (unsigned int i = 0; i < stas; ++i)
+    {
+      double rate = TransmittableBytesWithSymbols (staSymb, subchannels, dataMcs[i]) * 8 * superframesPerSecond;
+      totalRate += rate;
+      if (minRate < 0 || rate < minRate)
+        {
+          minRate = rate;
+        }
+    }
+  return minRate;
 }
 
 void
@@ -977,6 +1231,12 @@ BsCouwbatMac::GetOptimalMcs (const Mac48Address &dest, std::bitset<Couwbat::MAX_
 
   staCqiHist_t &hi = m_cqiHist[dest];
 
+  std::vector<double> &ollaOffset = m_ollaOffset[dest];
+  if (ollaOffset.empty ())
+    {
+      ollaOffset.assign (Couwbat::MAX_SUBCHANS, 0.0);
+    }
+
   for (uint32_t ccId = 0; ccId < Couwbat::MAX_SUBCHANS; ++ccId)
     {
       if (allocatedSubchannels.test (ccId))
@@ -985,7 +1245,8 @@ BsCouwbatMac::GetOptimalMcs (const Mac48Address &dest, std::bitset<Couwbat::MAX_
           if (hi.empty ())
             {
               // No history present, use default MCS
-              ret.push_back (Couwbat::GetDefaultMcs ());
+              ret.push_back (m_config->GetDefaultMcs ());
+              m_mcsSelectionTrace (dest, ccId, m_config->GetDefaultMcs (), 0.0);
             }
           else
             {
@@ -1017,9 +1278,17 @@ BsCouwbatMac::GetOptimalMcs (const Mac48Address &dest, std::bitset<Couwbat::MAX_
                 }
 
               double avgCqi = 0;
+              double offset = 0;
               if (entriesRead > 0)
                 {
                   avgCqi = cqiSum / entriesRead;
+
+                  // Correct the CQI by the outer-loop offset learned from the ACKs of previous DL bursts
+                  if (m_ollaEnabled)
+                    {
+                      offset = ollaOffset[ccId];
+                      avgCqi += offset;
+                    }
                 }
 
               // SNR levels roughly correspond to 802.11a/g client MCS taken from:
@@ -1050,19 +1319,20 @@ BsCouwbatMac::GetOptimalMcs (const Mac48Address &dest, std::bitset<Couwbat::MAX_
                 {
                   m = COUWBAT_MCS_QPSK_3_4;
                 }
-             else if (avgCqi >= Couwbat::mac_below_value_avoid_low_cqi_wb_subchannels)
+             else if (avgCqi >= m_config->GetAvoidLowCqiValue ())
                 {
-                  m = Couwbat::GetDefaultMcs ();
+                  m = m_config->GetDefaultMcs ();
                 }
              else
                {
                  NS_LOG_INFO ("STA " << dest << " combined CQI for subchannel " << ccId << " is below the"
                      " minimum acceptable value. But it has been decided to use this subchannel despite that."
                      " Using default, most reliable MCS for the STA in this case");
-                 m = Couwbat::GetDefaultMcs ();
+                 m = m_config->GetDefaultMcs ();
                }
 
               ret.push_back (m);
+              m_mcsSelectionTrace (dest, ccId, m, offset);
             }
         }
     }
@@ -1070,17 +1340,50 @@ BsCouwbatMac::GetOptimalMcs (const Mac48Address &dest, std::bitset<Couwbat::MAX_
   return ret;
 }
 
+/*
+ * The wideband phase starts after the PSS and the ALOHA contention slots for
+ * association requests, each followed by a guard
+ */
+unsigned int
+BsCouwbatMac::GetWidebandOffset (void) const
+{
+  // Get an MCS vector for narrowband (control) phase with 1 subchannel and default MCS
+  const std::vector<CouwbatMCS> narrowbandMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
+
+  double padding;
+  // pssTxDurationSymb: 12 = 10 + 2 (preamble)
+  const double pssTxDurationSymb = NecessarySymbolsForBytes (m_pssSizeBytes, 1, narrowbandMcs, padding);
+  NS_ASSERT (padding == 0); // implies pssTxDurationSymb is whole number
+
+  // singleAssocTxDurationSymb: 8 = 6 + 2 (preamble)
+  const double singleAssocTxDurationSymb = NecessarySymbolsForBytes (m_assocSizeBytes, 1, narrowbandMcs, padding);
+  NS_ASSERT (padding == 0); // implies singleAssocTxDurationSymb is whole number
+
+  const unsigned int alohaGuardSymb = m_config->GetAlohaNrGuardSymbols ();
+  return pssTxDurationSymb + m_config->GetContentionSlotCount () * (singleAssocTxDurationSymb + alohaGuardSymb) + alohaGuardSymb;
+}
+
+/*
+ * The wideband phase lasts until the end of the superframe
+ */
+unsigned int
+BsCouwbatMac::GetWidebandSymbols (void) const
+{
+  // sf_symbols: 2500, total wideband symbols: 2446
+  return m_config->GetSymbolsPerSuperframe () - GetWidebandOffset ();
+}
+
 /*
  * GetMapLength tries to get the number of slots for the maximum length bursts
  */
 BsCouwbatMac::MapLengthRetType
-BsCouwbatMac::GetMapLength (unsigned int stas, unsigned int subchannels, unsigned int symbWideband, const std::vector<std::vector<CouwbatMCS> > &dataMcs)
+BsCouwbatMac::GetMapLength (unsigned int stas, unsigned int subchannels, unsigned int symbWideband, const std::vector<std::vector<CouwbatMCS> > &dataMcs, unsigned int announcedStas)
 {
   NS_ASSERT (dataMcs.size () == stas);
 
   // Set starting/base values
-  int minMapBytes = 18 + stas * 2 * 34 + 2; // for 1 DL/UL burst per STA
-  std::vector<CouwbatMCS> mapMcs (subchannels, Couwbat::GetDefaultMcs());
+  int minMapBytes = GetMapSizeBytes (stas, 1, announcedStas); // for 1 DL/UL burst per STA
+  std::vector<CouwbatMCS> mapMcs (subchannels, m_config->GetDefaultMcs ());
   double mapPadding = 0;
   double mapSymbols = std::ceil (NecessarySymbolsForBytes (minMapBytes, subchannels, mapMcs, mapPadding));
   int dlOverheadBytes = 20;
@@ -1150,9 +1453,10 @@ BsCouwbatMac::GetMapLength (unsigned int stas, unsigned int subchannels, unsigne
         {
           unsigned int ulDlSlotsPerStaNew = ulDlSlotsPerSta + 1;
 
-          if (ulDlSlotsPerStaNew > Couwbat::mac_dlul_slot_limit_size) break; // Limit max slots for purposes of testing and reducing output to terminal
+          if (ulDlSlotsPerStaNew > m_config->GetDlUlSlotLimit ()) break; // Limit max slots for purposes of testing and reducing output to terminal
+          if (m_config->IsCompactMapEnabled () && ulDlSlotsPerStaNew > 255) break; // All slots of a STA must fit into one compact MAP grant
 
-          unsigned int minMapBytesNew = 18 + stas * 2 * 34 * ulDlSlotsPerStaNew + 2;
+          unsigned int minMapBytesNew = GetMapSizeBytes (stas, ulDlSlotsPerStaNew, announcedStas);
           double mapPaddingNew;
           double mapSymbolsNew = std::ceil (NecessarySymbolsForBytes (minMapBytesNew, subchannels, mapMcs, mapPaddingNew));
           double allocNew = mapSymbolsNew + totalSymbPerDlUlSlot * ulDlSlotsPerStaNew;
@@ -1186,13 +1490,119 @@ BsCouwbatMac::GetMapLength (unsigned int stas, unsigned int subchannels, unsigne
   return ret;
 }
 
+unsigned int
+BsCouwbatMac::GetMapSizeBytes (unsigned int stas, unsigned int ulDlSlotsPerSta, unsigned int announcedStas) const
+{
+  if (!m_config->IsCompactMapEnabled ())
+    {
+      // MAC header + FCS, 2 count bytes, one 34 byte subpacket per DL and UL slot
+      return 18 + stas * 2 * 34 * ulDlSlotsPerSta + 2;
+    }
+
+  // MAC header + FCS, 4 count bytes, 7 bytes per short ID assignment,
+  // 25 bytes per MCS vector, one 6 byte DL and UL grant per STA covering all slots
+  return 18 + 4 + announcedStas * 7 + stas * 25 + stas * 2 * 6;
+}
+
+bool
+BsCouwbatMac::IsKnownSta (Mac48Address addr) const
+{
+  if (std::find (m_associatedStasBackupCcTemp.begin (), m_associatedStasBackupCcTemp.end (), addr)
+        != m_associatedStasBackupCcTemp.end ()
+      || std::find (m_newStas.begin (), m_newStas.end (), addr) != m_newStas.end ())
+    {
+      return true;
+    }
+  for (unsigned int i = 0; i < 3; ++i)
+    {
+      if (std::find (m_associatedStas[i].begin (), m_associatedStas[i].end (), addr)
+            != m_associatedStas[i].end ())
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+BsCouwbatMac::ReleaseTxHistory (void)
+{
+  NS_LOG_FUNCTION (this);
+  const std::vector<Mac48Address> dests = m_txHistory.GetDestinations ();
+  for (std::vector<Mac48Address>::const_iterator it = dests.begin (); it != dests.end (); ++it)
+    {
+      if (!IsKnownSta (*it))
+        {
+          NS_LOG_DEBUG ("CR-BS " << m_address << " releasing ARQ window of " << *it);
+          m_txHistory.RemoveDestination (*it);
+        }
+    }
+}
+
+void
+BsCouwbatMac::UpdateShortIds (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Release short IDs of STAs which are neither associated nor still scheduled
+  std::map<Mac48Address, uint8_t>::iterator it = m_shortIds.begin ();
+  while (it != m_shortIds.end ())
+    {
+      bool known = std::find (m_associatedStasBackupCcTemp.begin (), m_associatedStasBackupCcTemp.end (), it->first)
+          != m_associatedStasBackupCcTemp.end ();
+      for (unsigned int i = 0; i < 3 && !known; ++i)
+        {
+          known = std::find (m_associatedStas[i].begin (), m_associatedStas[i].end (), it->first)
+              != m_associatedStas[i].end ();
+        }
+
+      if (known)
+        {
+          ++it;
+          continue;
+        }
+
+      NS_LOG_DEBUG ("CR-BS " << m_address << " releasing short ID " << (uint32_t) it->second << " of " << it->first);
+      m_shortIdConfirmed.erase (it->first);
+      m_shortIds.erase (it++);
+    }
+
+  std::set<uint8_t> used;
+  for (it = m_shortIds.begin (); it != m_shortIds.end (); ++it)
+    {
+      used.insert (it->second);
+    }
+
+  for (std::vector<Mac48Address>::iterator macIterator = m_associatedStas[0].begin (); macIterator != m_associatedStas[0].end (); ++macIterator)
+    {
+      if (m_shortIds.find (*macIterator) == m_shortIds.end ())
+        {
+          // Smallest free short ID
+          uint32_t id = 0;
+          while (used.count (id))
+            {
+              ++id;
+            }
+          NS_ASSERT_MSG (id < 256, "No free short STA ID");
+          used.insert (id);
+          m_shortIds[*macIterator] = id;
+          NS_LOG_DEBUG ("CR-BS " << m_address << " assigned short ID " << id << " to " << *macIterator);
+        }
+
+      if (m_shortIdConfirmed.find (*macIterator) == m_shortIdConfirmed.end ())
+        {
+          m_mapAnnounce[0].insert (*macIterator);
+        }
+    }
+}
+
 void
 BsCouwbatMac::AddCqiHist (Mac48Address source, uint8_t cqi[], uint32_t sframe_count)
 {
   NS_LOG_FUNCTION (this << source << sframe_count);
 
   bool allBlank = true;
-  for (unsigned int i = 0; i < Couwbat::GetNumberOfSubchannels(); ++i)
+  for (unsigned int i = 0; i < m_config->GetNumberOfSubchannels (); ++i)
     {
       if (cqi[i] != 255)
         {
@@ -1208,37 +1618,53 @@ BsCouwbatMac::AddCqiHist (Mac48Address source, uint8_t cqi[], uint32_t sframe_co
 
   // Add an entry to the CQI history
 
-  std::ostringstream ss;
-  ss << "CR-BS " << m_address << " adding CQI from " << source
-      << " sframe " << sframe_count
-      << " to history, cqi[]={" << (int) cqi[0];
-  for (unsigned int i = 1; i < Couwbat::MAX_SUBCHANS; ++i)
+  if (COUWBAT_LOG_ENABLED (LOG_INFO))
     {
-      ss << "," << (int) cqi[i];
+      std::ostringstream ss;
+      ss << "CR-BS " << m_address << " adding CQI from " << source
+          << " sframe " << sframe_count
+          << " to history, cqi[]={" << (int) cqi[0];
+      for (unsigned int i = 1; i < Couwbat::MAX_SUBCHANS; ++i)
+        {
+          ss << "," << (int) cqi[i];
+        }
+      ss << "}";
+      NS_LOG_INFO (ss.str ());
     }
-  ss << "}";
-  NS_LOG_INFO (ss.str ());
 
   cqiHistEntry_t entry;
   entry.src = source;
   entry.sframe_count = sframe_count;
-  entry.cqi.assign (cqi, cqi + Couwbat::MAX_SUBCHANS);
+  entry.cqi = CouwbatCqiArray (cqi);
 
   staCqiHist_t &hi = m_cqiHist[source];
   hi.push_front (entry);
 }
 
+const CouwbatTxHistoryBuffer::Stats &
+BsCouwbatMac::GetArqStats (void) const
+{
+  return m_txHistory.GetStats ();
+}
+
 int
 BsCouwbatMac::GetTxQueueSize (const Mac48Address dest)
 {
   return m_txQueue.GetQueueSize (dest);
 }
 
+uint32_t
+BsCouwbatMac::GetTxQueueBytes (const Mac48Address dest)
+{
+  return m_txQueue.GetQueueBytes (dest);
+}
+
 void
 BsCouwbatMac::SetSpectrumManager (Ptr<SpectrumManager> sm)
 {
   NS_LOG_FUNCTION (this << sm);
   m_specManager = sm;
+  ConnectSpectrumManager ();
 }
 
 Callback<void,Ptr<Packet> >
@@ -1298,4 +1724,107 @@ BsCouwbatMac::CleanCqiHist (uint32_t sframe_count)
     }
 }
 
+void
+BsCouwbatMac::OllaAddPending (Mac48Address dest, uint8_t seq, std::bitset<Couwbat::MAX_SUBCHANS> subchannels, uint32_t sframe_count)
+{
+  NS_LOG_FUNCTION (this << dest << (int) seq << sframe_count);
+
+  if (!m_ollaEnabled)
+    {
+      return;
+    }
+
+  OllaPendingBurst burst;
+  burst.seq = seq;
+  burst.sframe_count = sframe_count;
+  burst.subchannels = subchannels;
+  m_ollaPending[dest].push_back (burst);
+}
+
+void
+BsCouwbatMac::OllaRegisterAck (Mac48Address source, uint8_t ack)
+{
+  NS_LOG_FUNCTION (this << source << (int) ack);
+
+  if (!m_ollaEnabled || ack == CouwbatTxHistoryBuffer::NO_ACK)
+    {
+      return;
+    }
+
+  std::deque<OllaPendingBurst> &pending = m_ollaPending[source];
+  for (std::deque<OllaPendingBurst>::iterator it = pending.begin (); it != pending.end (); ++it)
+    {
+      if (it->seq == ack)
+        {
+          OllaUpdateOffset (source, it->subchannels, true);
+          pending.erase (it);
+          return;
+        }
+    }
+}
+
+void
+BsCouwbatMac::OllaExpirePending (uint32_t sframe_count)
+{
+  NS_LOG_FUNCTION (this << sframe_count);
+
+  typedef std::map<Mac48Address, std::deque<OllaPendingBurst> >::iterator it_type;
+  for (it_type iterator = m_ollaPending.begin (); iterator != m_ollaPending.end (); ++iterator)
+    {
+      std::deque<OllaPendingBurst> &pending = iterator->second;
+
+      if (!IsKnownSta (iterator->first))
+        {
+          // STA no longer associated, missing ACKs say nothing about the link
+          pending.clear ();
+          m_ollaOffset.erase (iterator->first);
+          continue;
+        }
+      if (std::find (m_associatedStas[0].begin (), m_associatedStas[0].end (), iterator->first)
+            == m_associatedStas[0].end ())
+        {
+          // STA not served in this superframe, e.g. parked on the backup CC: keep its
+          // offsets, bursts lost with the CC change say nothing about the link either
+          pending.clear ();
+          continue;
+        }
+
+      // Bursts are appended in order of scheduling, so expired ones are at the front
+      while (!pending.empty ()
+             && pending.front ().sframe_count + m_ollaAckTimeout <= sframe_count)
+        {
+          OllaUpdateOffset (iterator->first, pending.front ().subchannels, false);
+          pending.pop_front ();
+        }
+    }
+}
+
+void
+BsCouwbatMac::OllaUpdateOffset (Mac48Address dest, std::bitset<Couwbat::MAX_SUBCHANS> subchannels, bool acked)
+{
+  // Step sizes are chosen so that up and down movements cancel out exactly at the target BLER:
+  // (1 - BLER) * stepUp == BLER * stepDown
+  const double stepUp = m_ollaStepDown * m_ollaTargetBler / (1.0 - m_ollaTargetBler);
+
+  std::vector<double> &offset = m_ollaOffset[dest];
+  if (offset.empty ())
+    {
+      offset.assign (Couwbat::MAX_SUBCHANS, 0.0);
+    }
+
+  for (uint32_t ccId = 0; ccId < Couwbat::MAX_SUBCHANS; ++ccId)
+    {
+      if (!subchannels.test (ccId))
+        {
+          continue;
+        }
+
+      offset[ccId] += acked ? stepUp : -m_ollaStepDown;
+      offset[ccId] = std::max (-m_ollaMaxOffset, std::min (m_ollaMaxOffset, offset[ccId]));
+    }
+
+  NS_LOG_LOGIC ("CR-BS " << m_address << " DL burst to " << dest
+                << (acked ? " ACKed" : " lost") << ", OLLA offsets updated");
+}
+
 } // namespace ns3
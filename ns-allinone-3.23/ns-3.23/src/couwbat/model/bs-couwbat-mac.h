@@ -6,6 +6,9 @@
 #include "couwbat-meta-header.h"
 #include "couwbat-packet-helper.h"
 #include "couwbat-tx-history-buffer.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
+#include "ns3/data-rate.h"
 #include <set>
 #include <bitset>
 #include <map>
@@ -37,6 +40,11 @@ public:
   BsCouwbatMac (); //!< Default constructor
   ~BsCouwbatMac (); //!< Destructor
 
+  /**
+   * Set the configuration of this mac and its TxQueue
+   */
+  virtual void SetConfig (Ptr<CouwbatConfig> config);
+
   /**
    * Return link state used in CouwbatNetDevice. Currently always returns true.
    * \return true
@@ -56,6 +64,17 @@ public:
    */
   int GetTxQueueSize (const Mac48Address dest);
 
+  /**
+   * Return the current number of bytes in the TxQueue for a certain destination MAC address.
+   * \param dest destination address
+   */
+  uint32_t GetTxQueueBytes (const Mac48Address dest);
+
+  /**
+   * Return the ARQ retransmission statistics of all DL bursts sent so far.
+   */
+  const CouwbatTxHistoryBuffer::Stats &GetArqStats (void) const;
+
   /**
    * Set the spectrum manager member m_specManager explicitly. Only used in m_netlinkMode.
    */
@@ -86,6 +105,21 @@ private:
    */
   bool SelectNewCcNoBackup (void);
 
+  /**
+   * Connect to the SubchannelsChanged trace source of m_specManager.
+   */
+  void ConnectSpectrumManager (void);
+
+  /**
+   * Called by the spectrum manager when subchannels became busy or free. If the
+   * active CC became busy, the pending DL/UL bursts on it are skipped and a new
+   * CC is selected at once, see SelectCc.
+   * \param becameBusy The subchannels that became occupied.
+   * \param becameFree The subchannels that became free.
+   */
+  void NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                 std::bitset<Couwbat::MAX_SUBCHANS> becameFree);
+
   /**
    * Find new backup CC and update m_backupCc
    */
@@ -201,6 +235,9 @@ private:
   /**
    * Adds a STA with this address to m_newStas. This STA is not yet actually associated.
    * It becomes associated when it is removed from m_newStas and added to m_associatedStas.
+   * With admission control, the STA is not added if the estimated per-STA capacity after
+   * its admission is below m_minGuaranteedRate. The STA repeats its association request
+   * in the following superframes, so it is deferred until capacity becomes available.
    */
   void AddSta (Mac48Address addr);
 
@@ -226,6 +263,22 @@ private:
     unsigned int mapPaddingBytes; //!< Number of padding bytes for MAP
   };
   
+  /**
+   * First symbol of the wideband phase of a superframe, after the PSS and the
+   * contention slots of the narrowband phase.
+   *
+   * \return offset of the wideband phase in symbols
+   */
+  unsigned int GetWidebandOffset (void) const;
+
+  /**
+   * Number of symbols of the wideband phase of a superframe, i.e. the
+   * superframe without the PSS and the contention slots of the narrowband phase.
+   *
+   * \return number of total available wideband symbols
+   */
+  unsigned int GetWidebandSymbols (void) const;
+
   /**
    * Calculate an optimal bandwidth allocation based on the number of STAs,
    * number of used subchannels, number of total available wideband symbols
@@ -235,9 +288,51 @@ private:
    * \param subchannels number of subchannels
    * \param symbWideband number of total available wideband symbols
    * \param mcs vector of the target MCS vector for each STA. Number of elements must be equal to number of STAs.
+   * \param announcedStas number of STAs whose short ID is announced in the (compact) MAP
    * \return results in MapLengthRetType struct
    */
-  MapLengthRetType GetMapLength (unsigned int stas, unsigned int subchannels, unsigned int symbWideband, const std::vector<std::vector<CouwbatMCS> > &mcs);
+  MapLengthRetType GetMapLength (unsigned int stas, unsigned int subchannels, unsigned int symbWideband, const std::vector<std::vector<CouwbatMCS> > &mcs, unsigned int announcedStas);
+
+  /**
+   * Size of the MAP in bytes without padding, for the legacy or compact
+   * encoding depending on CouwbatConfig::IsCompactMapEnabled.
+   *
+   * \param stas number of STAs
+   * \param ulDlSlotsPerSta number of DL and UL slots per STA
+   * \param announcedStas number of short ID assignments in the compact MAP
+   */
+  unsigned int GetMapSizeBytes (unsigned int stas, unsigned int ulDlSlotsPerSta, unsigned int announcedStas) const;
+
+  /**
+   * Estimate the DL + UL rate each STA would get if the wideband phase of the
+   * current superframe was shared equally by STAs with the given MCS vectors.
+   *
+   * \param dataMcs MCS vector for each STA, with one entry per wideband subchannel
+   * \param ml result of GetMapLength for these STAs
+   * \param totalRate set to the sum of the rates of all STAs in bit/s
+   * \return the smallest per-STA rate in bit/s, 0 if no DL/UL slot fits
+   */
+  double EstimateStaCapacity (const std::vector<std::vector<CouwbatMCS> > &dataMcs, const MapLengthRetType &ml, double &totalRate);
+
+  /**
+   * Assign a short ID to every STA of the current superframe which does not
+   * have one yet, and release the short IDs of STAs which left.
+   * STAs whose short ID has not been confirmed are added to m_mapAnnounce[0].
+   */
+  void UpdateShortIds (void);
+
+  /**
+   * \param addr The address of a STA.
+   * \return True if the STA is associated, new, parked on the backup CC or
+   *   still scheduled in one of the last superframes.
+   */
+  bool IsKnownSta (Mac48Address addr) const;
+
+  /**
+   * Drop the ARQ windows of STAs which are neither associated nor still
+   * scheduled, so that departed STAs do not keep their retransmission history.
+   */
+  void ReleaseTxHistory (void);
 
   /**
    * Add an entry to the CQI history.
@@ -257,6 +352,47 @@ private:
    */
   void CleanCqiHist (uint32_t sframe_count);
 
+  /**
+   * Outer-loop link adaptation: remember a DL burst that has been scheduled
+   * so that its ACK (or the lack of one) can be used to adjust the MCS offset.
+   *
+   * \param dest destination address
+   * \param seq SEQ number of the DL burst
+   * \param subchannels subchannels used by the DL burst
+   * \param sframe_count sframe count in which the DL burst was scheduled
+   */
+  void OllaAddPending (Mac48Address dest, uint8_t seq, std::bitset<Couwbat::MAX_SUBCHANS> subchannels, uint32_t sframe_count);
+
+  /**
+   * Outer-loop link adaptation: handle an ACK received in an UL burst.
+   * The matching pending DL burst counts as successfully decoded.
+   *
+   * \param source the source address of the UL burst
+   * \param ack the ACK field of the UL burst, CouwbatTxHistoryBuffer::NO_ACK is ignored
+   */
+  void OllaRegisterAck (Mac48Address source, uint8_t ack);
+
+  /**
+   * Outer-loop link adaptation: count all pending DL bursts that have not been ACKed
+   * within m_ollaAckTimeout superframes as lost and drop the state of STAs that are
+   * no longer known (IsKnownSta). Known STAs not served in this superframe keep
+   * their offsets.
+   *
+   * \param sframe_count current sframe count
+   */
+  void OllaExpirePending (uint32_t sframe_count);
+
+  /**
+   * Outer-loop link adaptation: move the CQI offset of the given subchannels
+   * up (burst ACKed) or down (burst lost) so that the long term block error rate
+   * converges to m_ollaTargetBler.
+   *
+   * \param dest destination address
+   * \param subchannels subchannels used by the DL burst
+   * \param acked true if the DL burst was ACKed
+   */
+  void OllaUpdateOffset (Mac48Address dest, std::bitset<Couwbat::MAX_SUBCHANS> subchannels, bool acked);
+
   /*
    * --------------------------------
    * - MEMBER VARIABLES
@@ -329,11 +465,30 @@ private:
    */
   std::vector<Mac48Address> m_newStas;
 
+  /**
+   * Short STA IDs used in the compact MAP
+   */
+  std::map<Mac48Address, uint8_t> m_shortIds;
+
+  /**
+   * STAs which have sent an UL burst since their short ID was assigned,
+   * i.e. which have received a MAP containing the assignment
+   */
+  std::set<Mac48Address> m_shortIdConfirmed;
+
+  /**
+   * STAs whose short ID assignment is announced in the MAP, analogous to m_associatedStas.
+   * Filled by SendPss() in [0], read by SendMap() from [1].
+   */
+  std::set<Mac48Address> m_mapAnnounce[2];
+
   /**
    * TX queue instance, holds all packet pointers to packets in the transmission queue
    */
   CouwbatTxQueue m_txQueue;
 
+  CouwbatPacketHelper::Scratch m_packetScratch; //!< Buffers reused by the packet helper for all frames of this MAC
+
   /**
    * Time of last control channel change, purely for statistics.
    */
@@ -399,7 +554,7 @@ private:
   typedef struct
     {
       Mac48Address src;
-      std::vector<uint8_t> cqi;
+      CouwbatCqiArray cqi;
       uint32_t sframe_count;
     } cqiHistEntry_t;
     
@@ -409,6 +564,54 @@ private:
   typedef std::deque<cqiHistEntry_t> staCqiHist_t;
 
   std::map<Mac48Address, staCqiHist_t> m_cqiHist; //!< Storage of all CQI history entries by source address
+
+  /*
+   * Outer-loop link adaptation
+   */
+
+  /** \struct OllaPendingBurst
+   * DL burst that is waiting for its ACK
+   */
+  struct OllaPendingBurst
+  {
+    uint8_t seq; //!< SEQ number of the DL burst
+    uint32_t sframe_count; //!< sframe count in which the DL burst was scheduled
+    std::bitset<Couwbat::MAX_SUBCHANS> subchannels; //!< Subchannels used by the DL burst
+  };
+
+  bool m_ollaEnabled; //!< True if the CQI to MCS mapping is corrected by the outer-loop offset
+  double m_ollaTargetBler; //!< Target block error rate of DL bursts
+  double m_ollaStepDown; //!< CQI offset decrease on a lost DL burst
+  double m_ollaMaxOffset; //!< Maximum absolute value of the CQI offset
+  uint32_t m_ollaAckTimeout; //!< Superframes after which an unACKed DL burst counts as lost
+
+  std::map<Mac48Address, std::deque<OllaPendingBurst> > m_ollaPending; //!< DL bursts waiting for ACK by destination address
+  std::map<Mac48Address, std::vector<double> > m_ollaOffset; //!< CQI offset per subchannel by destination address
+
+  /**
+   * The trace source fired when the MCS of a subchannel has been selected for a STA.
+   * Parameters are the STA address, the subchannel, the selected MCS and the applied CQI offset.
+   */
+  TracedCallback<Mac48Address, uint32_t, CouwbatMCS, double> m_mcsSelectionTrace;
+
+  /*
+   * Admission control
+   */
+  bool m_admissionControl; //!< True if association requests are subject to admission control
+  DataRate m_minGuaranteedRate; //!< Minimum DL + UL rate that every STA must keep after an admission
+
+  /**
+   * Estimated DL + UL capacity of the cell in bit/s for the STAs of the current superframe,
+   * updated every superframe.
+   */
+  TracedValue<double> m_cellCapacity;
+
+  /**
+   * The trace source fired on every admission decision.
+   * Parameters are the STA address, true if admitted and the estimated
+   * per-STA rate in bit/s after admission.
+   */
+  TracedCallback<Mac48Address, bool, double> m_admissionTrace;
 };
 
 } // namespace ns3
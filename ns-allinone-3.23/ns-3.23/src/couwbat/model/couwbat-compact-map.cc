@@ -0,0 +1,249 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <iomanip>
+#include <iostream>
+#include <string.h>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/header.h"
+#include "couwbat-compact-map.h"
+#include "ns3/address-utils.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatCompactMap");
+
+/*
+ * CouwbatMapIdAssignment
+ */
+
+NS_OBJECT_ENSURE_REGISTERED (CouwbatMapIdAssignment);
+
+CouwbatMapIdAssignment::CouwbatMapIdAssignment ()
+  : m_shortId (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+CouwbatMapIdAssignment::GetHeaderSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return GetSerializedSize ();
+}
+
+TypeId
+CouwbatMapIdAssignment::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CouwbatMapIdAssignment")
+    .SetParent<Header> ()
+    .AddConstructor<CouwbatMapIdAssignment> ()
+  ;
+  return tid;
+}
+
+TypeId
+CouwbatMapIdAssignment::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+CouwbatMapIdAssignment::Print (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this << &os);
+
+  os << "short_id=" << uint32_t (m_shortId)
+     << ", addr=" << m_addr;
+}
+
+uint32_t
+CouwbatMapIdAssignment::GetSerializedSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  static const uint32_t ret = sizeof (m_shortId) + 6;
+  return ret;
+}
+
+void
+CouwbatMapIdAssignment::Serialize (Buffer::Iterator start) const
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  i.WriteU8 (m_shortId);
+  WriteTo (i, m_addr);
+}
+
+uint32_t
+CouwbatMapIdAssignment::Deserialize (Buffer::Iterator start)
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  m_shortId = i.ReadU8 ();
+  ReadFrom (i, m_addr);
+
+  return GetSerializedSize ();
+}
+
+/*
+ * CouwbatMapStaMcs
+ */
+
+NS_OBJECT_ENSURE_REGISTERED (CouwbatMapStaMcs);
+
+CouwbatMapStaMcs::CouwbatMapStaMcs ()
+  : m_shortId (0)
+{
+  NS_LOG_FUNCTION (this);
+  std::memset (m_amc, 0, sizeof (m_amc));
+}
+
+uint32_t
+CouwbatMapStaMcs::GetHeaderSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return GetSerializedSize ();
+}
+
+TypeId
+CouwbatMapStaMcs::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CouwbatMapStaMcs")
+    .SetParent<Header> ()
+    .AddConstructor<CouwbatMapStaMcs> ()
+  ;
+  return tid;
+}
+
+TypeId
+CouwbatMapStaMcs::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+CouwbatMapStaMcs::Print (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this << &os);
+
+  os << "short_id=" << uint32_t (m_shortId)
+     << ", amc[]=" << "some_amc";
+}
+
+uint32_t
+CouwbatMapStaMcs::GetSerializedSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  static const uint32_t ret = sizeof (m_shortId) + sizeof (m_amc);
+  return ret;
+}
+
+void
+CouwbatMapStaMcs::Serialize (Buffer::Iterator start) const
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  i.WriteU8 (m_shortId);
+  i.Write (m_amc, sizeof (m_amc));
+}
+
+uint32_t
+CouwbatMapStaMcs::Deserialize (Buffer::Iterator start)
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  m_shortId = i.ReadU8 ();
+  i.Read (m_amc, sizeof (m_amc));
+
+  return GetSerializedSize ();
+}
+
+/*
+ * CouwbatMapGrant
+ */
+
+NS_OBJECT_ENSURE_REGISTERED (CouwbatMapGrant);
+
+CouwbatMapGrant::CouwbatMapGrant ()
+  : m_shortId (0),
+    m_ofdm_offset (0),
+    m_ofdm_count (0),
+    m_repeat (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+CouwbatMapGrant::GetHeaderSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return GetSerializedSize ();
+}
+
+TypeId
+CouwbatMapGrant::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CouwbatMapGrant")
+    .SetParent<Header> ()
+    .AddConstructor<CouwbatMapGrant> ()
+  ;
+  return tid;
+}
+
+TypeId
+CouwbatMapGrant::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+CouwbatMapGrant::Print (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this << &os);
+
+  os << "short_id=" << uint32_t (m_shortId)
+     << ", ofdm_offset=" << m_ofdm_offset
+     << ", ofdm_count=" << m_ofdm_count
+     << ", repeat=" << uint32_t (m_repeat);
+}
+
+uint32_t
+CouwbatMapGrant::GetSerializedSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  static const uint32_t ret = sizeof (m_shortId) + sizeof (m_ofdm_offset)
+      + sizeof (m_ofdm_count) + sizeof (m_repeat);
+  return ret;
+}
+
+void
+CouwbatMapGrant::Serialize (Buffer::Iterator start) const
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  i.WriteU8 (m_shortId);
+  i.WriteHtonU16 (m_ofdm_offset);
+  i.WriteHtonU16 (m_ofdm_count);
+  i.WriteU8 (m_repeat);
+}
+
+uint32_t
+CouwbatMapGrant::Deserialize (Buffer::Iterator start)
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+
+  m_shortId = i.ReadU8 ();
+  m_ofdm_offset = i.ReadNtohU16 ();
+  m_ofdm_count = i.ReadNtohU16 ();
+  m_repeat = i.ReadU8 ();
+
+  return GetSerializedSize ();
+}
+
+} // namespace ns3
@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef COUWBAT_COMPACT_MAP_H
+#define COUWBAT_COMPACT_MAP_H
+
+#include "ns3/header.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup couwbat
+ *
+ * \brief Compact MAP element assigning a short STA ID to a MAC address
+ *
+ * Sent by the CR-BS in the compact MAP for newly associated STAs until
+ * the STA has confirmed the ID with an UL burst.
+ */
+class CouwbatMapIdAssignment : public Header
+{
+public:
+  CouwbatMapIdAssignment ();
+
+  uint32_t GetHeaderSize () const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  uint8_t m_shortId; //!< Short STA ID
+  Mac48Address m_addr; //!< STA address
+};
+
+/**
+ * \ingroup couwbat
+ *
+ * \brief Compact MAP element carrying the data phase MCS vector of a STA
+ *
+ * Sent once per STA and MAP, valid for all DL and UL grants of this STA.
+ */
+class CouwbatMapStaMcs : public Header
+{
+public:
+  CouwbatMapStaMcs ();
+
+  uint32_t GetHeaderSize () const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  uint8_t m_shortId; //!< Short STA ID
+  uint8_t m_amc[24]; //!< bitarray of AMC, same format as CouwbatMapSubpacket::m_amc
+};
+
+/**
+ * \ingroup couwbat
+ *
+ * \brief Compact MAP element granting a run of equally sized, back-to-back bursts to a STA
+ *
+ * Burst k (0 <= k < m_repeat) starts at m_ofdm_offset + k * m_ofdm_count.
+ */
+class CouwbatMapGrant : public Header
+{
+public:
+  CouwbatMapGrant ();
+
+  uint32_t GetHeaderSize () const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  uint8_t m_shortId; //!< Short STA ID
+  uint16_t m_ofdm_offset; //!< OFDM offset of first burst
+  uint16_t m_ofdm_count; //!< OFDM count of every burst
+  uint8_t m_repeat; //!< Number of bursts
+};
+
+} // namespace ns3
+
+
+#endif /* COUWBAT_COMPACT_MAP_H */
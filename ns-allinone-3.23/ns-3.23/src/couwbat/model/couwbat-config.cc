@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "couwbat-config.h"
+#include "couwbat-phy.h"
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/integer.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatConfig");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (CouwbatConfig);
+
+TypeId
+CouwbatConfig::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CouwbatConfig")
+    .SetParent<Object> ()
+    .AddConstructor<CouwbatConfig> ()
+    .SetGroupName ("Couwbat")
+    // Not set at construction, see the class documentation
+    .AddAttribute ("QueueLimitEnabled",
+                   "Limit the number of packets queued per destination.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_queue_limit_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_queueLimitEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("QueueLimitSize",
+                   "Maximum number of packets queued per destination, if QueueLimitEnabled.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   IntegerValue (Couwbat::mac_queue_limit_size),
+                   MakeIntegerAccessor (&CouwbatConfig::m_queueLimitSize),
+                   MakeIntegerChecker<int> (0))
+    .AddAttribute ("QueueLimitBytesEnabled",
+                   "Limit the number of bytes queued per destination.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_queue_limit_bytes_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_queueLimitBytesEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("QueueLimitBytes",
+                   "Maximum number of bytes queued per destination, if QueueLimitBytesEnabled.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_limit_bytes),
+                   MakeUintegerAccessor (&CouwbatConfig::m_queueLimitBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CodelEnabled",
+                   "Enable CoDel active queue management in the TX queue.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_codel_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_codelEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CodelTarget",
+                   "Acceptable standing queue delay of CoDel in microseconds.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_codel_target_us),
+                   MakeUintegerAccessor (&CouwbatConfig::m_codelTarget),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CodelInterval",
+                   "Sliding window of CoDel in microseconds.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_codel_interval_us),
+                   MakeUintegerAccessor (&CouwbatConfig::m_codelInterval),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("CodelMinBytes",
+                   "CoDel never drops if no more than this number of bytes is queued.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_codel_min_bytes),
+                   MakeUintegerAccessor (&CouwbatConfig::m_codelMinBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("QueuePrioEnabled",
+                   "Give small packets priority in the TX queue (Ratio scheduler).",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_queue_prio_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_queuePrioEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("QueuePrioRatio",
+                   "Share of the packets served from the priority class.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   DoubleValue (Couwbat::mac_queue_prio_ratio),
+                   MakeDoubleAccessor (&CouwbatConfig::m_queuePrioRatio),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("QueuePrioRatioCount",
+                   "Number of packets QueuePrioRatio is based on.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   IntegerValue (Couwbat::mac_queue_prio_ratio_count),
+                   MakeIntegerAccessor (&CouwbatConfig::m_queuePrioRatioCount),
+                   MakeIntegerChecker<int> (1))
+    .AddAttribute ("QueuePrioSizeThreshold",
+                   "Packets up to this size in bytes get priority.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_prio_size_threshold),
+                   MakeUintegerAccessor (&CouwbatConfig::m_queuePrioSizeThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("QueueClassifier",
+                   "How packets are assigned to traffic classes.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   EnumValue (Couwbat::mac_queue_classifier),
+                   MakeEnumAccessor (&CouwbatConfig::m_queueClassifier),
+                   MakeEnumChecker (COUWBAT_QUEUE_CLASSIFY_SIZE, "Size",
+                                    COUWBAT_QUEUE_CLASSIFY_DSCP, "Dscp"))
+    .AddAttribute ("QueueScheduler",
+                   "How the traffic classes of a destination are served.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   EnumValue (Couwbat::mac_queue_scheduler),
+                   MakeEnumAccessor (&CouwbatConfig::m_queueScheduler),
+                   MakeEnumChecker (COUWBAT_QUEUE_SCHED_RATIO, "Ratio",
+                                    COUWBAT_QUEUE_SCHED_STRICT, "Strict",
+                                    COUWBAT_QUEUE_SCHED_DRR, "Drr"))
+    .AddAttribute ("DrrQuantumVoice",
+                   "Bytes per round of the voice class (Drr scheduler), at least the largest MTU.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_drr_quantum[COUWBAT_TC_VOICE]),
+                   MakeUintegerAccessor (&CouwbatConfig::SetQueueDrrQuantumOf<COUWBAT_TC_VOICE>,
+                                         &CouwbatConfig::GetQueueDrrQuantumOf<COUWBAT_TC_VOICE>),
+                   MakeUintegerChecker<uint32_t> (Couwbat::MAX_MTU))
+    .AddAttribute ("DrrQuantumVideo",
+                   "Bytes per round of the video class (Drr scheduler), at least the largest MTU.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_drr_quantum[COUWBAT_TC_VIDEO]),
+                   MakeUintegerAccessor (&CouwbatConfig::SetQueueDrrQuantumOf<COUWBAT_TC_VIDEO>,
+                                         &CouwbatConfig::GetQueueDrrQuantumOf<COUWBAT_TC_VIDEO>),
+                   MakeUintegerChecker<uint32_t> (Couwbat::MAX_MTU))
+    .AddAttribute ("DrrQuantumBestEffort",
+                   "Bytes per round of the best effort class (Drr scheduler), at least the largest MTU.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_drr_quantum[COUWBAT_TC_BEST_EFFORT]),
+                   MakeUintegerAccessor (&CouwbatConfig::SetQueueDrrQuantumOf<COUWBAT_TC_BEST_EFFORT>,
+                                         &CouwbatConfig::GetQueueDrrQuantumOf<COUWBAT_TC_BEST_EFFORT>),
+                   MakeUintegerChecker<uint32_t> (Couwbat::MAX_MTU))
+    .AddAttribute ("DrrQuantumBackground",
+                   "Bytes per round of the background class (Drr scheduler), at least the largest MTU.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_queue_drr_quantum[COUWBAT_TC_BACKGROUND]),
+                   MakeUintegerAccessor (&CouwbatConfig::SetQueueDrrQuantumOf<COUWBAT_TC_BACKGROUND>,
+                                         &CouwbatConfig::GetQueueDrrQuantumOf<COUWBAT_TC_BACKGROUND>),
+                   MakeUintegerChecker<uint32_t> (Couwbat::MAX_MTU))
+    .AddAttribute ("ClassDlOrder",
+                   "The CR-BS places DL slots of STAs with higher priority traffic queued first in the superframe.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_queue_class_dl_order),
+                   MakeBooleanAccessor (&CouwbatConfig::m_classDlOrder),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DlUlSlotLimit",
+                   "Maximum number of DL/UL slots per STA and superframe.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_dlul_slot_limit_size),
+                   MakeUintegerAccessor (&CouwbatConfig::m_dlUlSlotLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ArqEnabled",
+                   "Enable selective-repeat ARQ, retransmission of unACKed bursts.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_arq_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_arqEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CompactMapEnabled",
+                   "Encode MAPs with short STA IDs and run-length merged grants.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_compact_map_enabled),
+                   MakeBooleanAccessor (&CouwbatConfig::m_compactMapEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AvoidLowCqiEnabled",
+                   "The CR-BS avoids unoccupied wideband subchannels with low CQI feedback from STAs.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   BooleanValue (Couwbat::mac_avoid_low_cqi_wb_subchannels),
+                   MakeBooleanAccessor (&CouwbatConfig::m_avoidLowCqi),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AvoidLowCqiThreshold",
+                   "Share of negative CQI feedback above which a subchannel is avoided.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   DoubleValue (Couwbat::mac_against_threshold_avoid_low_cqi_wb_subchannels),
+                   MakeDoubleAccessor (&CouwbatConfig::m_avoidLowCqiThreshold),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("AvoidLowCqiValue",
+                   "CQIs below this value are negative feedback.",
+                   TypeId::ATTR_GET | TypeId::ATTR_SET,
+                   UintegerValue (Couwbat::mac_below_value_avoid_low_cqi_wb_subchannels),
+                   MakeUintegerAccessor (&CouwbatConfig::m_avoidLowCqiValue),
+                   MakeUintegerChecker<uint8_t> ())
+  ;
+  return tid;
+}
+
+CouwbatConfig::CouwbatConfig ()
+  :     m_symbolDuration (Couwbat::GetSymbolDuration ()),
+    m_symbolsPreamble (Couwbat::GetSymbolspreamble ()),
+    m_nrSubchannels (Couwbat::GetNumberOfSubchannels ()),
+    m_nrSubcarriersPerSubchannel (Couwbat::GetNumberOfSubcarriersPerSubchannel ()),
+    m_nrDataSubcarriersPerSubchannel (Couwbat::GetNumberOfDataSubcarriersPerSubchannel ()),
+    m_txPowerBs (Couwbat::GetTxPowerBS ()),
+    m_superframeDuration (Couwbat::GetSuperframeDuration ()),
+    m_superframeGuardSymbols (Couwbat::GetSuperframeGuardSymbols ()),
+    m_contentionSlotCount (Couwbat::GetContentionSlotCount ()),
+    m_alohaNrGuardSymbols (Couwbat::GetAlohaNrGuardSymbols ()),
+    m_dataPhaseDownlinkPortion (Couwbat::GetDataPhaseDownlinkPortion ()),
+    m_defaultMcs (Couwbat::GetDefaultMcs ()),
+    m_queueLimitEnabled (Couwbat::mac_queue_limit_enabled),
+    m_queueLimitSize (Couwbat::mac_queue_limit_size),
+    m_queueLimitBytesEnabled (Couwbat::mac_queue_limit_bytes_enabled),
+    m_queueLimitBytes (Couwbat::mac_queue_limit_bytes),
+    m_codelEnabled (Couwbat::mac_codel_enabled),
+    m_codelTarget (Couwbat::mac_codel_target_us),
+    m_codelInterval (Couwbat::mac_codel_interval_us),
+    m_codelMinBytes (Couwbat::mac_codel_min_bytes),
+    m_queuePrioEnabled (Couwbat::mac_queue_prio_enabled),
+    m_queuePrioRatio (Couwbat::mac_queue_prio_ratio),
+    m_queuePrioRatioCount (Couwbat::mac_queue_prio_ratio_count),
+    m_queuePrioSizeThreshold (Couwbat::mac_queue_prio_size_threshold),
+    m_queueClassifier (Couwbat::mac_queue_classifier),
+    m_queueScheduler (Couwbat::mac_queue_scheduler),
+    m_classDlOrder (Couwbat::mac_queue_class_dl_order),
+    m_dlUlSlotLimit (Couwbat::mac_dlul_slot_limit_size),
+    m_arqEnabled (Couwbat::mac_arq_enabled),
+    m_compactMapEnabled (Couwbat::mac_compact_map_enabled),
+    m_avoidLowCqi (Couwbat::mac_avoid_low_cqi_wb_subchannels),
+    m_avoidLowCqiThreshold (Couwbat::mac_against_threshold_avoid_low_cqi_wb_subchannels),
+    m_avoidLowCqiValue (Couwbat::mac_below_value_avoid_low_cqi_wb_subchannels)
+{
+  NS_LOG_FUNCTION (this);
+  std::copy (Couwbat::mac_queue_drr_quantum, Couwbat::mac_queue_drr_quantum + COUWBAT_TC_COUNT, m_queueDrrQuantum);
+  Update ();
+}
+
+void
+CouwbatConfig::Update (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_symbolsPerSuperframe = m_superframeDuration / m_symbolDuration;
+  for (uint32_t mcs = 0; mcs < MCS_TABLE_SIZE; ++mcs)
+    {
+      m_dataBitsPerSymbol[mcs] = CouwbatPhy::BitsPerSymbol (static_cast<enum CouwbatMCS> (mcs)) * m_nrDataSubcarriersPerSubchannel;
+    }
+}
+
+void
+CouwbatConfig::SetSymbolDuration (uint32_t us)
+{
+  NS_LOG_FUNCTION (this << us);
+  m_symbolDuration = us;
+  Update ();
+}
+
+void
+CouwbatConfig::SetSymbolsPreamble (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_symbolsPreamble = n;
+}
+
+void
+CouwbatConfig::SetNumberOfDataSubcarriersPerSubchannel (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_nrDataSubcarriersPerSubchannel = n;
+  Update ();
+}
+
+void
+CouwbatConfig::SetTxPowerBS (double w)
+{
+  NS_LOG_FUNCTION (this << w);
+  m_txPowerBs = w;
+}
+
+void
+CouwbatConfig::SetSuperframeDuration (uint32_t us)
+{
+  NS_LOG_FUNCTION (this << us);
+  m_superframeDuration = us;
+  Update ();
+}
+
+void
+CouwbatConfig::SetSuperframeGuardSymbols (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_superframeGuardSymbols = n;
+}
+
+void
+CouwbatConfig::SetContentionSlotCount (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_contentionSlotCount = n;
+}
+
+void
+CouwbatConfig::SetAlohaNrGuardSymbols (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_alohaNrGuardSymbols = n;
+}
+
+void
+CouwbatConfig::SetDataPhaseDownlinkPortion (double portion)
+{
+  NS_LOG_FUNCTION (this << portion);
+  m_dataPhaseDownlinkPortion = portion;
+}
+
+void
+CouwbatConfig::SetDefaultMcs (enum CouwbatMCS mcs)
+{
+  NS_LOG_FUNCTION (this << mcs);
+  m_defaultMcs = mcs;
+}
+
+} // namespace ns3
@@ -0,0 +1,198 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef COUWBAT_CONFIG_H
+#define COUWBAT_CONFIG_H
+
+#include "ns3/object.h"
+#include "ns3/assert.h"
+#include "couwbat.h"
+
+namespace ns3 {
+
+/**
+ * \brief PHY and MAC parameters of one Couwbat cell
+ * \ingroup couwbat
+ *
+ * Every CouwbatNetDevice holds a CouwbatConfig and passes it to its MAC, PHY and
+ * TX queue, so devices with different configurations can be simulated together.
+ * Devices of one cell should share the same object, see CouwbatHelper::SetConfig.
+ *
+ * A default constructed CouwbatConfig is a snapshot of the static parameters of
+ * class Couwbat at the time of construction. The static API therefore remains the
+ * way to configure all devices at once, as long as it is used before the devices
+ * are installed. The MAC tuning parameters are attributes as well, to configure a
+ * single cell after construction (SetAttribute, Config::Set). Their initial values
+ * are the defaults of the statics. They are not set at construction, so that the
+ * snapshot is kept; Config::SetDefault and CreateObjectWithAttributes do not apply.
+ *
+ * Values derived from the parameters, e.g. the number of symbols per superframe and
+ * the data bits per symbol and subchannel for every MCS, are precomputed whenever a
+ * parameter changes. All getters are inline.
+ */
+class CouwbatConfig : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /**
+   * Create a configuration with the current values of the Couwbat statics
+   */
+  CouwbatConfig ();
+
+  // PHY parameters
+
+  uint32_t GetSymbolDuration (void) const { return m_symbolDuration; } //!< \return symbol duration in microseconds
+  void SetSymbolDuration (uint32_t us);
+
+  uint32_t GetSymbolsPreamble (void) const { return m_symbolsPreamble; } //!< \return number of preamble symbols per frame
+  void SetSymbolsPreamble (uint32_t n);
+
+  uint32_t GetNumberOfSubchannels (void) const { return m_nrSubchannels; } //!< \return number of subchannels
+  uint32_t GetNumberOfSubcarriersPerSubchannel (void) const { return m_nrSubcarriersPerSubchannel; } //!< \return subcarriers per subchannel
+
+  uint32_t GetNumberOfDataSubcarriersPerSubchannel (void) const { return m_nrDataSubcarriersPerSubchannel; } //!< \return data subcarriers per subchannel
+  void SetNumberOfDataSubcarriersPerSubchannel (uint32_t n);
+
+  double GetTxPowerBS (void) const { return m_txPowerBs; } //!< \return TX power of the CR-BS in linear units
+  void SetTxPowerBS (double w);
+
+  // MAC parameters
+
+  uint32_t GetSuperframeDuration (void) const { return m_superframeDuration; } //!< \return superframe duration in microseconds
+  void SetSuperframeDuration (uint32_t us);
+
+  uint32_t GetSuperframeGuardSymbols (void) const { return m_superframeGuardSymbols; } //!< \return guard symbols between MAP and data phase
+  void SetSuperframeGuardSymbols (uint32_t n);
+
+  uint32_t GetContentionSlotCount (void) const { return m_contentionSlotCount; } //!< \return number of association slots
+  void SetContentionSlotCount (uint32_t n);
+
+  uint32_t GetAlohaNrGuardSymbols (void) const { return m_alohaNrGuardSymbols; } //!< \return guard symbols around association slots and data phase frames
+  void SetAlohaNrGuardSymbols (uint32_t n);
+
+  double GetDataPhaseDownlinkPortion (void) const { return m_dataPhaseDownlinkPortion; } //!< \return share of the data phase used for the downlink
+  void SetDataPhaseDownlinkPortion (double portion);
+
+  enum CouwbatMCS GetDefaultMcs (void) const { return m_defaultMcs; } //!< \return MCS of control frames and of subchannels without CQI
+  void SetDefaultMcs (enum CouwbatMCS mcs);
+
+  // Derived values
+
+  /**
+   * \return number of whole OFDM symbols in a superframe
+   */
+  uint32_t GetSymbolsPerSuperframe (void) const
+  {
+    return m_symbolsPerSuperframe;
+  }
+
+  /**
+   * \return number of data bits carried by one OFDM symbol on one subchannel with mcs,
+   *         i.e. CouwbatPhy::BitsPerSymbol (mcs) times the data subcarriers per subchannel
+   */
+  double GetDataBitsPerSymbol (enum CouwbatMCS mcs) const
+  {
+    NS_ASSERT (static_cast<uint32_t> (mcs) < MCS_TABLE_SIZE);
+    return m_dataBitsPerSymbol[mcs];
+  }
+
+  // MAC tuning parameters, see the members of class Couwbat named in the comments.
+  // They are set through the attributes of the same name.
+
+  bool IsQueueLimitEnabled (void) const { return m_queueLimitEnabled; } //!< \return mac_queue_limit_enabled
+  int GetQueueLimitSize (void) const { return m_queueLimitSize; } //!< \return mac_queue_limit_size
+  bool IsQueueLimitBytesEnabled (void) const { return m_queueLimitBytesEnabled; } //!< \return mac_queue_limit_bytes_enabled
+  uint32_t GetQueueLimitBytes (void) const { return m_queueLimitBytes; } //!< \return mac_queue_limit_bytes
+  bool IsCodelEnabled (void) const { return m_codelEnabled; } //!< \return mac_codel_enabled
+  uint32_t GetCodelTarget (void) const { return m_codelTarget; } //!< \return mac_codel_target_us
+  uint32_t GetCodelInterval (void) const { return m_codelInterval; } //!< \return mac_codel_interval_us
+  uint32_t GetCodelMinBytes (void) const { return m_codelMinBytes; } //!< \return mac_codel_min_bytes
+  bool IsQueuePrioEnabled (void) const { return m_queuePrioEnabled; } //!< \return mac_queue_prio_enabled
+  double GetQueuePrioRatio (void) const { return m_queuePrioRatio; } //!< \return mac_queue_prio_ratio
+  int GetQueuePrioRatioCount (void) const { return m_queuePrioRatioCount; } //!< \return mac_queue_prio_ratio_count
+  uint32_t GetQueuePrioSizeThreshold (void) const { return m_queuePrioSizeThreshold; } //!< \return mac_queue_prio_size_threshold
+  enum CouwbatQueueClassifier GetQueueClassifier (void) const { return m_queueClassifier; } //!< \return mac_queue_classifier
+  enum CouwbatQueueScheduler GetQueueScheduler (void) const { return m_queueScheduler; } //!< \return mac_queue_scheduler
+  bool IsClassDlOrderEnabled (void) const { return m_classDlOrder; } //!< \return mac_queue_class_dl_order
+  uint32_t GetDlUlSlotLimit (void) const { return m_dlUlSlotLimit; } //!< \return mac_dlul_slot_limit_size
+  bool IsArqEnabled (void) const { return m_arqEnabled; } //!< \return mac_arq_enabled
+  bool IsCompactMapEnabled (void) const { return m_compactMapEnabled; } //!< \return mac_compact_map_enabled
+  bool IsAvoidLowCqiEnabled (void) const { return m_avoidLowCqi; } //!< \return mac_avoid_low_cqi_wb_subchannels
+  double GetAvoidLowCqiThreshold (void) const { return m_avoidLowCqiThreshold; } //!< \return mac_against_threshold_avoid_low_cqi_wb_subchannels
+  uint8_t GetAvoidLowCqiValue (void) const { return m_avoidLowCqiValue; } //!< \return mac_below_value_avoid_low_cqi_wb_subchannels
+
+  /**
+   * \param tc traffic class
+   * \return mac_queue_drr_quantum[tc]
+   */
+  uint32_t GetQueueDrrQuantum (uint32_t tc) const
+  {
+    NS_ASSERT (tc < COUWBAT_TC_COUNT);
+    return m_queueDrrQuantum[tc];
+  }
+
+private:
+  /**
+   * Recompute the derived values after a parameter change
+   */
+  void Update (void);
+
+  /**
+   * Attribute accessors of one entry of m_queueDrrQuantum
+   */
+  template <enum CouwbatTrafficClass tc>
+  void SetQueueDrrQuantumOf (uint32_t bytes)
+  {
+    m_queueDrrQuantum[tc] = bytes;
+  }
+  template <enum CouwbatTrafficClass tc>
+  uint32_t GetQueueDrrQuantumOf (void) const
+  {
+    return m_queueDrrQuantum[tc];
+  }
+
+  static const uint32_t MCS_TABLE_SIZE = 64; //!< Larger than the highest CouwbatMCS value
+
+  uint32_t m_symbolDuration; //!< in microseconds
+  uint32_t m_symbolsPreamble; //!< Preamble symbols per frame
+  uint32_t m_nrSubchannels; //!< Number of subchannels
+  uint32_t m_nrSubcarriersPerSubchannel; //!< Subcarriers per subchannel
+  uint32_t m_nrDataSubcarriersPerSubchannel; //!< Data subcarriers per subchannel
+  double m_txPowerBs; //!< TX power of the CR-BS in linear units
+  uint32_t m_superframeDuration; //!< in microseconds
+  uint32_t m_superframeGuardSymbols; //!< Guard between MAP and data phase
+  uint32_t m_contentionSlotCount; //!< Number of association slots
+  uint32_t m_alohaNrGuardSymbols; //!< Guard around association slots and data phase frames
+  double m_dataPhaseDownlinkPortion; //!< Share of the data phase used for the downlink
+  enum CouwbatMCS m_defaultMcs; //!< MCS of control frames
+
+  bool m_queueLimitEnabled; //!< Limit the packets queued per destination
+  int m_queueLimitSize; //!< Packet limit per destination
+  bool m_queueLimitBytesEnabled; //!< Limit the bytes queued per destination
+  uint32_t m_queueLimitBytes; //!< Byte limit per destination
+  bool m_codelEnabled; //!< CoDel in the TX queue
+  uint32_t m_codelTarget; //!< CoDel target in microseconds
+  uint32_t m_codelInterval; //!< CoDel interval in microseconds
+  uint32_t m_codelMinBytes; //!< CoDel never drops below this queue size
+  bool m_queuePrioEnabled; //!< Priority for small packets
+  double m_queuePrioRatio; //!< Share of priority packets
+  int m_queuePrioRatioCount; //!< Packets the share is based on
+  uint32_t m_queuePrioSizeThreshold; //!< Largest priority packet in bytes
+  enum CouwbatQueueClassifier m_queueClassifier; //!< Traffic class assignment
+  enum CouwbatQueueScheduler m_queueScheduler; //!< Traffic class scheduler
+  uint32_t m_queueDrrQuantum[COUWBAT_TC_COUNT]; //!< DRR bytes per round, indexed by CouwbatTrafficClass
+  bool m_classDlOrder; //!< DL slots ordered by queued traffic class
+  uint32_t m_dlUlSlotLimit; //!< Max DL/UL slots per STA and superframe
+  bool m_arqEnabled; //!< Selective-repeat ARQ
+  bool m_compactMapEnabled; //!< Compact MAP encoding
+  bool m_avoidLowCqi; //!< Avoid low CQI wideband subchannels
+  double m_avoidLowCqiThreshold; //!< Share of negative feedback to avoid a subchannel
+  uint8_t m_avoidLowCqiValue; //!< CQIs below this value are negative feedback
+
+  uint32_t m_symbolsPerSuperframe; //!< Derived from m_superframeDuration and m_symbolDuration
+  double m_dataBitsPerSymbol[MCS_TABLE_SIZE]; //!< Derived from m_nrDataSubcarriersPerSubchannel, indexed by CouwbatMCS
+};
+
+} // namespace ns3
+
+#endif /* COUWBAT_CONFIG_H */
@@ -0,0 +1,390 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "couwbat-crc32.h"
+#include "ns3/log.h"
+#include <ostream>
+#include <streambuf>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COUWBAT_CRC32_PCLMUL 1
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#define COUWBAT_CRC32_ARMV8 1
+#include <sys/auxv.h>
+#include <arm_acle.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CouwbatCrc32");
+
+/*
+ * All engines work on the inverted CRC register (initial value 0xffffffff,
+ * final XOR 0xffffffff is applied by the public functions).
+ */
+typedef uint32_t (*CrcFunction) (uint32_t state, const uint8_t *data, uint32_t size);
+
+/**
+ * Slicing-by-8 lookup tables for the reflected polynomial 0xEDB88320
+ */
+struct CrcTables
+{
+  CrcTables ()
+  {
+    for (uint32_t i = 0; i < 256; ++i)
+      {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+          {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+          }
+        t[0][i] = c;
+      }
+    for (uint32_t i = 0; i < 256; ++i)
+      {
+        for (int k = 1; k < 8; ++k)
+          {
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+          }
+      }
+  }
+  uint32_t t[8][256];
+};
+
+static const CrcTables &
+GetTables (void)
+{
+  static const CrcTables tables;
+  return tables;
+}
+
+static inline uint32_t
+ReadLe32 (const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint32_t
+CrcSlicingBy8 (uint32_t state, const uint8_t *data, uint32_t size)
+{
+  const uint32_t (*t)[256] = GetTables ().t;
+
+  // Byte-wise up to 4 byte alignment, then 8 bytes per iteration
+  while (size > 0 && (reinterpret_cast<uintptr_t> (data) & 3) != 0)
+    {
+      state = t[0][(state ^ *data++) & 0xff] ^ (state >> 8);
+      --size;
+    }
+  while (size >= 8)
+    {
+      uint32_t one = ReadLe32 (data) ^ state;
+      uint32_t two = ReadLe32 (data + 4);
+      state = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24]
+        ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+      data += 8;
+      size -= 8;
+    }
+  while (size > 0)
+    {
+      state = t[0][(state ^ *data++) & 0xff] ^ (state >> 8);
+      --size;
+    }
+  return state;
+}
+
+#ifdef COUWBAT_CRC32_PCLMUL
+/*
+ * Folding with carry-less multiplication, see Gopal et al., "Fast CRC Computation
+ * for Generic Polynomials Using PCLMULQDQ Instruction", Intel 2009. Four 128 bit
+ * lanes are folded 64 bytes ahead, then combined and reduced to 32 bit with a
+ * Barrett reduction. Constants are for the bit-reflected polynomial 0x04C11DB7.
+ * Requires size >= 64 and a multiple of 16.
+ */
+__attribute__ ((target ("pclmul,sse4.1")))
+static uint32_t
+CrcPclmulBlocks (uint32_t state, const uint8_t *data, uint32_t size)
+{
+  const __m128i k1k2 = _mm_set_epi64x (0x1c6e41596ULL, 0x154442bd4ULL);
+  const __m128i k3k4 = _mm_set_epi64x (0x0ccaa009eULL, 0x1751997d0ULL);
+  const __m128i k5 = _mm_set_epi64x (0, 0x163cd6124ULL);
+  const __m128i poly = _mm_set_epi64x (0x1f7011641ULL, 0x1db710641ULL);
+  const __m128i mask32 = _mm_set_epi32 (0, 0, 0, 0xffffffff);
+
+  const __m128i *p = reinterpret_cast<const __m128i *> (data);
+  __m128i x1 = _mm_loadu_si128 (p);
+  __m128i x2 = _mm_loadu_si128 (p + 1);
+  __m128i x3 = _mm_loadu_si128 (p + 2);
+  __m128i x4 = _mm_loadu_si128 (p + 3);
+  x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 (state));
+  p += 4;
+  size -= 64;
+
+  while (size >= 64)
+    {
+      __m128i y1 = _mm_clmulepi64_si128 (x1, k1k2, 0x00);
+      __m128i y2 = _mm_clmulepi64_si128 (x2, k1k2, 0x00);
+      __m128i y3 = _mm_clmulepi64_si128 (x3, k1k2, 0x00);
+      __m128i y4 = _mm_clmulepi64_si128 (x4, k1k2, 0x00);
+      x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, k1k2, 0x11), y1), _mm_loadu_si128 (p));
+      x2 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x2, k1k2, 0x11), y2), _mm_loadu_si128 (p + 1));
+      x3 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x3, k1k2, 0x11), y3), _mm_loadu_si128 (p + 2));
+      x4 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x4, k1k2, 0x11), y4), _mm_loadu_si128 (p + 3));
+      p += 4;
+      size -= 64;
+    }
+
+  // Fold the four lanes into one
+  x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, k3k4, 0x00), _mm_clmulepi64_si128 (x1, k3k4, 0x11)), x2);
+  x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, k3k4, 0x00), _mm_clmulepi64_si128 (x1, k3k4, 0x11)), x3);
+  x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, k3k4, 0x00), _mm_clmulepi64_si128 (x1, k3k4, 0x11)), x4);
+
+  while (size >= 16)
+    {
+      x1 = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x1, k3k4, 0x00), _mm_clmulepi64_si128 (x1, k3k4, 0x11)),
+                          _mm_loadu_si128 (p));
+      ++p;
+      size -= 16;
+    }
+
+  // 128 -> 64 bit
+  x1 = _mm_xor_si128 (_mm_clmulepi64_si128 (x1, k3k4, 0x10), _mm_srli_si128 (x1, 8));
+  // 64 -> 32 bit
+  x1 = _mm_xor_si128 (_mm_clmulepi64_si128 (_mm_and_si128 (x1, mask32), k5, 0x00), _mm_srli_si128 (x1, 4));
+  // Barrett reduction
+  __m128i x2r = x1;
+  x1 = _mm_and_si128 (_mm_clmulepi64_si128 (_mm_and_si128 (x1, mask32), poly, 0x10), mask32);
+  x1 = _mm_xor_si128 (_mm_clmulepi64_si128 (x1, poly, 0x00), x2r);
+  return _mm_extract_epi32 (x1, 1);
+}
+
+static uint32_t
+CrcPclmul (uint32_t state, const uint8_t *data, uint32_t size)
+{
+  if (size < 64)
+    {
+      return CrcSlicingBy8 (state, data, size);
+    }
+  uint32_t blocks = size & ~15u;
+  state = CrcPclmulBlocks (state, data, blocks);
+  return CrcSlicingBy8 (state, data + blocks, size - blocks);
+}
+
+static bool
+PclmulSupported (void)
+{
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+    {
+      return false;
+    }
+  return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+#endif /* COUWBAT_CRC32_PCLMUL */
+
+#ifdef COUWBAT_CRC32_ARMV8
+__attribute__ ((target ("+crc")))
+static uint32_t
+CrcArmv8 (uint32_t state, const uint8_t *data, uint32_t size)
+{
+  while (size >= 8)
+    {
+      uint64_t word;
+      std::memcpy (&word, data, 8);
+      state = __crc32d (state, word);
+      data += 8;
+      size -= 8;
+    }
+  while (size > 0)
+    {
+      state = __crc32b (state, *data++);
+      --size;
+    }
+  return state;
+}
+
+static bool
+Armv8Supported (void)
+{
+  return (getauxval (AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#endif /* COUWBAT_CRC32_ARMV8 */
+
+static CrcFunction
+GetFunction (enum CouwbatCrc32::Engine engine)
+{
+  switch (engine)
+    {
+#ifdef COUWBAT_CRC32_PCLMUL
+    case CouwbatCrc32::PCLMUL:
+      return &CrcPclmul;
+#endif
+#ifdef COUWBAT_CRC32_ARMV8
+    case CouwbatCrc32::ARMV8:
+      return &CrcArmv8;
+#endif
+    default:
+      return &CrcSlicingBy8;
+    }
+}
+
+static enum CouwbatCrc32::Engine
+DetectEngine (void)
+{
+  if (CouwbatCrc32::IsSupported (CouwbatCrc32::PCLMUL))
+    {
+      return CouwbatCrc32::PCLMUL;
+    }
+  if (CouwbatCrc32::IsSupported (CouwbatCrc32::ARMV8))
+    {
+      return CouwbatCrc32::ARMV8;
+    }
+  return CouwbatCrc32::SLICING_BY_8;
+}
+
+/**
+ * The implementation in use. Detected on first use instead of during static
+ * initialization, so that the order of static initialization does not matter
+ * and programs that never compute a CRC do not probe the CPU.
+ */
+struct Selection
+{
+  Selection ()
+    : engine (DetectEngine ()),
+      function (GetFunction (engine))
+  {
+  }
+  enum CouwbatCrc32::Engine engine;
+  CrcFunction function;
+};
+
+static Selection &
+GetSelection (void)
+{
+  static Selection selection;
+  return selection;
+}
+
+/**
+ * Output stream buffer that runs the CRC over everything written to it,
+ * used to walk the chunks of a packet buffer with Packet::CopyData (std::ostream *, uint32_t).
+ */
+class CrcStreamBuf : public std::streambuf
+{
+public:
+  CrcStreamBuf () : m_state (0xffffffff) {}
+  uint32_t GetCrc (void) const
+  {
+    return m_state ^ 0xffffffff;
+  }
+protected:
+  virtual std::streamsize xsputn (const char *s, std::streamsize n)
+  {
+    m_state = GetSelection ().function (m_state, reinterpret_cast<const uint8_t *> (s), n);
+    return n;
+  }
+  virtual int_type overflow (int_type c)
+  {
+    if (!traits_type::eq_int_type (c, traits_type::eof ()))
+      {
+        uint8_t b = c;
+        m_state = GetSelection ().function (m_state, &b, 1);
+      }
+    return traits_type::not_eof (c);
+  }
+private:
+  uint32_t m_state;
+};
+
+uint32_t
+CouwbatCrc32::Calculate (const uint8_t *data, uint32_t size)
+{
+  return GetSelection ().function (0xffffffff, data, size) ^ 0xffffffff;
+}
+
+uint32_t
+CouwbatCrc32::Calculate (Ptr<const Packet> p, uint32_t size)
+{
+  NS_ASSERT (size <= p->GetSize ());
+  if (size <= 512)
+    {
+      // Setting up the stream costs more than copying small packets
+      uint8_t buffer[512];
+      p->CopyData (buffer, size);
+      return Calculate (buffer, size);
+    }
+  CrcStreamBuf buf;
+  std::ostream os (&buf);
+  p->CopyData (&os, size);
+  return buf.GetCrc ();
+}
+
+uint32_t
+CouwbatCrc32::Update (uint32_t crc, const uint8_t *data, uint32_t size)
+{
+  return GetSelection ().function (crc ^ 0xffffffff, data, size) ^ 0xffffffff;
+}
+
+enum CouwbatCrc32::Engine
+CouwbatCrc32::GetEngine (void)
+{
+  return GetSelection ().engine;
+}
+
+bool
+CouwbatCrc32::SetEngine (enum Engine engine)
+{
+  NS_LOG_FUNCTION (engine);
+  if (!IsSupported (engine))
+    {
+      return false;
+    }
+  GetSelection ().engine = engine;
+  GetSelection ().function = GetFunction (engine);
+  return true;
+}
+
+bool
+CouwbatCrc32::IsSupported (enum Engine engine)
+{
+  switch (engine)
+    {
+    case SLICING_BY_8:
+      return true;
+#ifdef COUWBAT_CRC32_PCLMUL
+    case PCLMUL:
+      return PclmulSupported ();
+#endif
+#ifdef COUWBAT_CRC32_ARMV8
+    case ARMV8:
+      return Armv8Supported ();
+#endif
+    default:
+      return false;
+    }
+}
+
+std::string
+CouwbatCrc32::GetEngineName (enum Engine engine)
+{
+  switch (engine)
+    {
+    case SLICING_BY_8:
+      return "slicing-by-8";
+    case PCLMUL:
+      return "pclmul";
+    case ARMV8:
+      return "armv8-crc";
+    default:
+      return "unknown";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef COUWBAT_CRC32_H
+#define COUWBAT_CRC32_H
+
+#include "ns3/packet.h"
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup couwbat
+ *
+ * \brief CRC-32 (IEEE 802.3) engine used for the FCS of Couwbat MAC frames
+ *
+ * Results are identical to CRC32Calculate from src/network/utils/crc32.h.
+ * Three implementations are available: a portable slicing-by-8 table
+ * implementation, carry-less multiplication folding (x86 PCLMULQDQ) and the
+ * ARMv8 CRC32 instructions. The fastest one supported by the CPU is selected
+ * at runtime on first use.
+ *
+ * A CRC over a Packet is computed directly on the chunks of the packet
+ * buffer (data area and zero area), without copying the packet into a
+ * contiguous array first.
+ */
+class CouwbatCrc32
+{
+public:
+  /**
+   * CRC-32 implementations
+   */
+  enum Engine
+  {
+    SLICING_BY_8 = 0,
+    PCLMUL,
+    ARMV8,
+    ENGINE_COUNT
+  };
+
+  /**
+   * \brief Calculate the CRC of a contiguous byte array
+   */
+  static uint32_t Calculate (const uint8_t *data, uint32_t size);
+
+  /**
+   * \brief Calculate the CRC of the first bytes of a packet
+   * \param size number of bytes from the start of the packet, must not exceed the packet size
+   */
+  static uint32_t Calculate (Ptr<const Packet> p, uint32_t size);
+
+  /**
+   * \brief Continue a CRC with more data
+   *
+   * Update (Calculate (a), b) == Calculate (a followed by b). Calculate of an
+   * empty array is 0, so Update (0, data, size) == Calculate (data, size).
+   *
+   * \param crc CRC of the preceding data
+   */
+  static uint32_t Update (uint32_t crc, const uint8_t *data, uint32_t size);
+
+  /**
+   * \return the implementation currently in use
+   */
+  static enum Engine GetEngine (void);
+
+  /**
+   * \brief Select the implementation, e.g. for benchmarks
+   * \return false and keep the current one if engine is not supported by this CPU
+   */
+  static bool SetEngine (enum Engine engine);
+
+  /**
+   * \return true if engine is compiled in and supported by this CPU
+   */
+  static bool IsSupported (enum Engine engine);
+
+  /**
+   * \return a printable name of engine
+   */
+  static std::string GetEngineName (enum Engine engine);
+};
+
+} // namespace ns3
+
+#endif /* COUWBAT_CRC32_H */
@@ -283,13 +283,16 @@ CouwbatInterferenceHelper::CalculateNoiseInterferenceW (Ptr<CouwbatInterferenceH
     }
   ni->insert (ni->begin (), NiChange (event->GetStartTime (), noiseInterference));
   ni->push_back (NiChange (event->GetEndTime (), 0));
-  std::vector<double> nis;
-  for (NiChanges::const_iterator i = ni->begin (); i != ni->end (); ++i)
+  if (COUWBAT_LOG_ENABLED (LOG_INFO))
     {
-      nis.push_back ((*i).GetDelta ());
+      std::vector<double> nis;
+      for (NiChanges::const_iterator i = ni->begin (); i != ni->end (); ++i)
+        {
+          nis.push_back ((*i).GetDelta ());
+        }
+      NS_LOG_INFO ("CalculateNoiseInterferenceW(): noiseInterference="<<noiseInterference
+                   <<", ni="<<nis);
     }
-  NS_LOG_INFO ("CalculateNoiseInterferenceW(): noiseInterference="<<noiseInterference
-               <<", ni="<<nis);
   return noiseInterference;
 }
 
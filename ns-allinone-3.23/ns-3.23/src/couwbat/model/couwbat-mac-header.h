@@ -20,6 +20,7 @@ enum couwbat_frame_t
     COUWBAT_FC_CONTROL_STA_ASSOC = 1, //!< STA association type
     COUWBAT_FC_CONTROL_STA_DISASSOC = 2, //!< STA disassociation type
     COUWBAT_FC_CONTROL_MAP = 3, //!< MAP type
+    COUWBAT_FC_CONTROL_MAP_COMPACT = 4, //!< MAP type with compact encoding (short STA IDs, per STA MCS, run-length grants)
     COUWBAT_FC_DATA_DL = 64, //!< Data downlink type
     COUWBAT_FC_DATA_UL = 65, //!< Data uplink type
     COUWBAT_FC_UNINITIALIZED
@@ -1,5 +1,6 @@
 #include "couwbat-mac.h"
 #include "couwbat.h"
+#include "couwbat-config.h"
 #include "ns3/log.h"
 
 NS_LOG_COMPONENT_DEFINE ("CouwbatMac");
@@ -16,6 +17,12 @@ CouwbatMac::GetTypeId (void)
     .SetParent<Object> ()
 
     .SetGroupName ("Couwbat")
+    .AddTraceSource ("QueueDelay",
+                     "Sojourn time of a packet dequeued from the TxQueue for transmission",
+                     MakeTraceSourceAccessor (&CouwbatMac::m_queueDelayTrace))
+    .AddTraceSource ("QueueDrop",
+                     "Trace source indicating a packet dropped from the TxQueue by CoDel",
+                     MakeTraceSourceAccessor (&CouwbatMac::m_queueDropTrace))
   ;
   return tid;
 }
@@ -24,6 +31,7 @@ CouwbatMac::CouwbatMac ()
 : m_netlinkMode (false)
 {
   NS_LOG_FUNCTION (this);
+  m_config = CreateObject<CouwbatConfig> ();
 }
 
 CouwbatMac::~CouwbatMac ()
@@ -73,6 +81,18 @@ CouwbatMac::GetPhy (void)
   return m_phy;
 }
 
+void
+CouwbatMac::NotifyQueueDelay (Mac48Address dest, Time sojourn)
+{
+  m_queueDelayTrace (dest, sojourn);
+}
+
+void
+CouwbatMac::NotifyQueueDrop (Ptr<const Packet> packet, Mac48Address dest, Time sojourn)
+{
+  m_queueDropTrace (packet, dest, sojourn);
+}
+
 void
 CouwbatMac::SetNetlinkMode (bool value)
 {
@@ -80,6 +100,19 @@ CouwbatMac::SetNetlinkMode (bool value)
   m_netlinkMode = value;
 }
 
+void
+CouwbatMac::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  m_config = config;
+}
+
+Ptr<CouwbatConfig>
+CouwbatMac::GetConfig (void) const
+{
+  return m_config;
+}
+
 void
 CouwbatMac::ForwardUp (Ptr<Packet> packet, Mac48Address from, Mac48Address to)
 {
@@ -156,7 +189,7 @@ CouwbatMac::BitsPerSymbol (enum CouwbatMCS mcs)
 }
 
 double
-CouwbatMac::TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs)
+CouwbatMac::TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs) const
 {
 
   NS_LOG_FUNCTION (num_symbols << num_subchannels);
@@ -164,13 +197,13 @@ CouwbatMac::TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_su
   NS_ASSERT (mcs.size () == num_subchannels);
   NS_ASSERT (num_subchannels > 0);
 
-  double preamble_symb = Couwbat::GetSymbolspreamble();
+  double preamble_symb = m_config->GetSymbolsPreamble ();
 
   double total_bits_per_symb = 0;
   for (uint32_t i = 0; i < mcs.size (); ++i)
     {
       NS_ASSERT (mcs[i] != COUWBAT_MCS_SUBCARRIER_NOT_AVAILABLE);
-      total_bits_per_symb += (CouwbatPhy::BitsPerSymbol (mcs[i]) * Couwbat::GetNumberOfDataSubcarriersPerSubchannel());
+      total_bits_per_symb += m_config->GetDataBitsPerSymbol (mcs[i]);
     }
   double total_bytes_per_symb = total_bits_per_symb / 8;
 
@@ -181,7 +214,7 @@ CouwbatMac::TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_su
 }
 
 double
-CouwbatMac::NecessarySymbolsForBytes (uint32_t size_bytes, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs, double &padding_bytes)
+CouwbatMac::NecessarySymbolsForBytes (uint32_t size_bytes, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs, double &padding_bytes) const
 {
   NS_ASSERT (mcs.size () == num_subchannels);
   NS_ASSERT (num_subchannels > 0);
@@ -189,13 +222,13 @@ CouwbatMac::NecessarySymbolsForBytes (uint32_t size_bytes, uint32_t num_subchann
   double bits_per_symb = 0;
   for (uint32_t i = 0; i < mcs.size(); ++i)
     {
-      bits_per_symb += (CouwbatPhy::BitsPerSymbol (mcs[i]) * Couwbat::GetNumberOfDataSubcarriersPerSubchannel());
+      bits_per_symb += m_config->GetDataBitsPerSymbol (mcs[i]);
     }
 
   // size is in bytes
   double size_bits = size_bytes * 8.0;
 
-  double preamble_symb = Couwbat::GetSymbolspreamble();
+  double preamble_symb = m_config->GetSymbolsPreamble ();
 
   // number of OFDM symbols depends on the MCS, number of subcarriers per subchannel
   // and total number of used subchannels
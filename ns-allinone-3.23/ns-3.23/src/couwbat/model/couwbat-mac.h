@@ -3,6 +3,7 @@
 
 #include "ns3/object.h"
 #include "ns3/network-module.h"
+#include "ns3/traced-callback.h"
 #include "couwbat-phy.h"
 #include "couwbat-net-device.h"
 
@@ -62,6 +63,16 @@ public:
    */
   Ptr<CouwbatPhy> GetPhy (void);
 
+  /**
+   * Set the configuration this mac uses, normally called by CouwbatNetDevice::SetConfig
+   */
+  virtual void SetConfig (Ptr<CouwbatConfig> config);
+
+  /**
+   * \return the configuration this mac uses
+   */
+  Ptr<CouwbatConfig> GetConfig (void) const;
+
   /**
    * Set m_netlinkMode to a certain value
    */
@@ -81,6 +92,11 @@ public:
    */
   virtual int GetTxQueueSize (const Mac48Address dest) = 0;
 
+  /**
+   * Return the number of bytes in the TxQueue
+   */
+  virtual uint32_t GetTxQueueBytes (const Mac48Address dest) = 0;
+
   /**
    * Forward received payload packets to higher layers (CouwbatNetDevice)
    */
@@ -104,7 +120,7 @@ public:
    * \param mcs MCS vector for used subchannels, size must be equal to num_subchannels, i.e. no entry for unused subchannels
    * \returns number of transmittable bytes
    */
-  static double TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs);
+  double TransmittableBytesWithSymbols (uint32_t num_symbols, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs) const;
 
   /**
    * Calculate the number of necessary symbols in order to transmit a payload packet of a certain size in bytes.
@@ -115,14 +131,35 @@ public:
    * \param padding_bytes [out] this variable gets modified and will contain the necessary padding bytes for the given configuration
    * \returns number of necessary symbols
    */
-  static double NecessarySymbolsForBytes (uint32_t size_bytes, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs, double &padding_bytes);
+  double NecessarySymbolsForBytes (uint32_t size_bytes, uint32_t num_subchannels, const std::vector<enum CouwbatMCS> &mcs, double &padding_bytes) const;
 
 protected:
+  /**
+   * Fire m_queueDelayTrace, registered as dequeue callback of the TxQueue
+   */
+  void NotifyQueueDelay (Mac48Address dest, Time sojourn);
+
+  /**
+   * Fire m_queueDropTrace, registered as drop callback of the TxQueue
+   */
+  void NotifyQueueDrop (Ptr<const Packet> packet, Mac48Address dest, Time sojourn);
+
   Mac48Address m_address; //!< Mac48Address of this mac.
   Ptr<Object> m_device;  //!< Parent CouwbatNetDevice
   Ptr<CouwbatPhy> m_phy; //!< Access to PHY
+  Ptr<CouwbatConfig> m_config; //!< PHY and MAC parameters
   bool m_netlinkMode; //!< If true, MAC runs in real time netlink mode (forwardup to m_netlinkForwardUpCallback), else in complete ns3 simulator mode (forawrdup to CouwbatNetDevice)
   Callback<void, Ptr<Packet>, Mac48Address, Mac48Address> m_netlinkForwardUpCallback; //!< Used only in netlink mode, forwardup callback for packets going from MAC to upper layers (external applications), gets called by MAC. 
+
+  /**
+   * Sojourn time of every packet dequeued from the TxQueue for transmission, retransmissions excluded
+   */
+  TracedCallback<Mac48Address, Time> m_queueDelayTrace;
+
+  /**
+   * Packets dropped from the TxQueue by CoDel together with their sojourn time
+   */
+  TracedCallback<Ptr<const Packet>, Mac48Address, Time> m_queueDropTrace;
 };
 
 } // namespace ns3
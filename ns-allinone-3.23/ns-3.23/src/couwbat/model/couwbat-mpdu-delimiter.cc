@@ -128,6 +128,17 @@ CouwbatMpduDelimiter::Deserialize (Buffer::Iterator start)
   return GetSerializedSize ();
 }
 
+uint32_t
+CouwbatMpduDelimiter::Deserialize (const uint8_t *start)
+{
+  // Buffer::Iterator::ReadU16 reads little endian
+  m_res_mpdu_len = start[0] | (start[1] << 8);
+  m_crc = start[2];
+  m_sig = start[3];
+
+  return GetSerializedSize ();
+}
+
 /*
  * Copyright (c) 2007,2008, 2009 INRIA, UDcast
  *
@@ -73,6 +73,13 @@ public:
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
+  /**
+   * \brief Deserialize from a contiguous byte array, same layout as Deserialize (Buffer::Iterator)
+   * \param start first byte, GetSerializedSize () bytes must be readable
+   * \return the number of bytes read
+   */
+  uint32_t Deserialize (const uint8_t *start);
+
 private:
   /**
    * \return The CRC value for the CURRENT m_res_mpdu_len
@@ -3,6 +3,7 @@
 #include "couwbat-mac.h"
 #include "couwbat-phy.h"
 #include "couwbat.h"
+#include "couwbat-config.h"
 #include "couwbat-channel.h"
 #include "ns3/network-module.h"
 #include "ns3/log.h"
@@ -25,15 +26,16 @@ CouwbatNetDevice::GetTypeId (void)
     .AddConstructor<CouwbatNetDevice> ()
     .SetGroupName ("Couwbat")
     .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit",
-                   UintegerValue (MAX_MTU),
+                   UintegerValue (Couwbat::MAX_MTU),
                    MakeUintegerAccessor (&CouwbatNetDevice::SetMtu,
                                          &CouwbatNetDevice::GetMtu),
-                   MakeUintegerChecker<uint16_t> (1,MAX_MTU))
+                   MakeUintegerChecker<uint16_t> (1,Couwbat::MAX_MTU))
   ;
   return tid;
 }
 
 CouwbatNetDevice::CouwbatNetDevice ()
+  : m_config (CreateObject<CouwbatConfig> ())
 {
   NS_LOG_FUNCTION (this);
 }
@@ -57,6 +59,7 @@ CouwbatNetDevice::SetMac (Ptr<CouwbatMac> mac)
 {
   NS_LOG_FUNCTION (this << mac);
   m_mac = mac;
+  m_mac->SetConfig (m_config);
 }
 
 void
@@ -64,6 +67,28 @@ CouwbatNetDevice::SetPhy (Ptr<CouwbatPhy> phy)
 {
   NS_LOG_FUNCTION (this << phy);
   m_phy = phy;
+  m_phy->SetConfig (m_config);
+}
+
+void
+CouwbatNetDevice::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  m_config = config;
+  if (m_mac)
+    {
+      m_mac->SetConfig (config);
+    }
+  if (m_phy)
+    {
+      m_phy->SetConfig (config);
+    }
+}
+
+Ptr<CouwbatConfig>
+CouwbatNetDevice::GetConfig (void) const
+{
+  return m_config;
 }
 
 Ptr<CouwbatMac>
@@ -171,7 +196,7 @@ bool
 CouwbatNetDevice::SetMtu (const uint16_t mtu)
 {
   NS_LOG_FUNCTION (this << mtu);
-  if (mtu > MAX_MTU)
+  if (mtu > Couwbat::MAX_MTU)
     {
       return false;
     }
@@ -266,13 +291,19 @@ CouwbatNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protoc
       return false;
     }
 
-  if (Couwbat::mac_queue_limit_enabled && GetMac ()->GetTxQueueSize (realTo) > Couwbat::mac_queue_limit_size)
+  if (m_config->IsQueueLimitEnabled () && GetMac ()->GetTxQueueSize (realTo) > m_config->GetQueueLimitSize ())
     {
       return false;
     }
 
   LlcSnapHeader llc;
   llc.SetType (protocolNumber);
+
+  if (m_config->IsQueueLimitBytesEnabled ()
+      && GetMac ()->GetTxQueueBytes (realTo) + packet->GetSize () + llc.GetSerializedSize () > m_config->GetQueueLimitBytes ())
+    {
+      return false;
+    }
   packet->AddHeader (llc);
 
   m_mac->Enqueue (packet, realTo);
@@ -12,6 +12,7 @@ class CouwbatPhy;
 class Channel;
 class Address;
 class SpectrumDb;
+class CouwbatConfig;
 
 /**
  * \ingroup couwbat
@@ -60,6 +61,19 @@ public:
    */
   Ptr<CouwbatPhy> GetPhy (void);
 
+  /**
+   * Set the configuration of this device and pass it on to the mac and phy.
+   * By default every device uses a snapshot of the Couwbat statics taken at construction.
+   * \param config The configuration, may be shared with other devices of the same cell.
+   */
+  void SetConfig (Ptr<CouwbatConfig> config);
+
+  /**
+   * Return the configuration of this device.
+   * \return The configuration of this device.
+   */
+  Ptr<CouwbatConfig> GetConfig (void) const;
+
   /**
    * \param node The node that contains the spectrum database to use.
    * 
@@ -130,12 +144,12 @@ protected:
   virtual void DoInitialize (void);
 
 private:
-  static const uint16_t MAX_MTU = 2304; //!< TODO rename this and find useful values; MTU value is not used at all and packets are forwarded as given, i.e. no splitting is implemented.
   uint16_t m_mtu;
   uint32_t m_ifIndex; //!< The interface index of this device.
   Ptr<SpectrumDb> m_specDb; //!< The spectrum db implementation for this device.
   Ptr<CouwbatMac> m_mac; //!< The mac layer.
   Ptr<CouwbatPhy> m_phy; //!< The phy layer.
+  Ptr<CouwbatConfig> m_config; //!< The configuration, shared with mac and phy.
   Ptr<Node> m_node; //!< The node of this device.
   NetDevice::ReceiveCallback m_forwardUp; //!< Method to call when forwarding received packets to the upper layer.
   std::map<Ipv4Address, Mac48Address> m_ipToMacTable; //!< IP to MAC translation table
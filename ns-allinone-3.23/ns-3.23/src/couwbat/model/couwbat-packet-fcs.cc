@@ -3,7 +3,7 @@
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "couwbat-packet-fcs.h"
-#include "ns3/crc32.h"
+#include "couwbat-crc32.h"
 
 namespace ns3 {
 
@@ -38,16 +38,12 @@ CouwbatFcsTrailer::CalcFcs (Ptr<const Packet> p, uint32_t size)
       return;
     }
 
-  uint8_t *buffer;
   uint32_t packSz = p->GetSize ();
   if (size == 0 || size > packSz)
     {
       size = packSz;
     }
-  buffer = new uint8_t[size];
-  p->CopyData (buffer, size);
-  m_fcs = CRC32Calculate (buffer, size);
-  delete[] buffer;
+  m_fcs = CouwbatCrc32::Calculate (p, size);
 }
 
 bool
@@ -59,22 +55,16 @@ CouwbatFcsTrailer::CheckFcs (Ptr<const Packet> p, uint32_t size)
       return true;
     }
 
-  uint8_t *buffer;
-  uint32_t crc;
   uint32_t packSz = p->GetSize ();
   if (size == 0 || size > packSz)
     {
       size = packSz;
     }
-  buffer = new uint8_t[size];
-  p->CopyData (buffer, size);
-  crc = CRC32Calculate (buffer, size);
-  delete[] buffer;
-  return (m_fcs == crc);
+  return (m_fcs == CouwbatCrc32::Calculate (p, size));
 }
 
 bool
-CouwbatFcsTrailer::CheckFcs (uint8_t *buffer, uint32_t size)
+CouwbatFcsTrailer::CheckFcs (const uint8_t *buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << buffer << size);
   if (!m_calcFcs)
@@ -82,10 +72,7 @@ CouwbatFcsTrailer::CheckFcs (uint8_t *buffer, uint32_t size)
       return true;
     }
 
-  uint32_t crc;
-
-  crc = CRC32Calculate (buffer, size);
-  return (m_fcs == crc);
+  return (m_fcs == CouwbatCrc32::Calculate (buffer, size));
 }
 
 void
@@ -196,22 +183,16 @@ CouwbatFcsHeader::CheckFcs (Ptr<const Packet> p, uint32_t size)
       return true;
     }
 
-  uint8_t *buffer;
-  uint32_t crc;
   uint32_t packSz = p->GetSize ();
   if (size == 0 || size > packSz)
     {
       size = packSz;
     }
-  buffer = new uint8_t[size];
-  p->CopyData (buffer, size);
-  crc = CRC32Calculate (buffer, size);
-  delete[] buffer;
-  return (m_fcs == crc);
+  return (m_fcs == CouwbatCrc32::Calculate (p, size));
 }
 
 bool
-CouwbatFcsHeader::CheckFcs (uint8_t *buffer, uint32_t size)
+CouwbatFcsHeader::CheckFcs (const uint8_t *buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << buffer << size);
   if (!m_calcFcs)
@@ -219,10 +200,7 @@ CouwbatFcsHeader::CheckFcs (uint8_t *buffer, uint32_t size)
       return true;
     }
 
-  uint32_t crc;
-
-  crc = CRC32Calculate (buffer, size);
-  return (m_fcs == crc);
+  return (m_fcs == CouwbatCrc32::Calculate (buffer, size));
 }
 
 void
@@ -298,4 +276,13 @@ CouwbatFcsHeader::Deserialize (Buffer::Iterator start)
   return size;
 }
 
+uint32_t
+CouwbatFcsHeader::Deserialize (const uint8_t *start)
+{
+  // Buffer::Iterator::ReadU32 reads little endian
+  m_fcs = start[0] | (start[1] << 8) | (start[2] << 16) | ((uint32_t) start[3] << 24);
+
+  return GetSerializedSize ();
+}
+
 } // namespace ns3
@@ -66,7 +66,7 @@ public:
   /**
    * Same as CheckFcs (Ptr<const Packet> p, uint32_t size) but takes an existing buffer
    */
-  bool CheckFcs (uint8_t *buffer, uint32_t size);
+  bool CheckFcs (const uint8_t *buffer, uint32_t size);
 
   /**
    * \brief Sets the FCS to a new value
@@ -153,7 +153,7 @@ public:
   /**
    * Same as CheckFcs (Ptr<const Packet> p, uint32_t size) but takes an existing buffer
    */
-  bool CheckFcs (uint8_t *buffer, uint32_t size);
+  bool CheckFcs (const uint8_t *buffer, uint32_t size);
 
   uint32_t GetHeaderSize () const;
 
@@ -164,6 +164,13 @@ public:
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
+  /**
+   * \brief Deserialize from a contiguous byte array, same layout as Deserialize (Buffer::Iterator)
+   * \param start first byte, GetSerializedSize () bytes must be readable
+   * \return the number of bytes read
+   */
+  uint32_t Deserialize (const uint8_t *start);
+
 private:
 
   /**
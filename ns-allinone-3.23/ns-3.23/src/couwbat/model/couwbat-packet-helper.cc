@@ -13,6 +13,7 @@
 #include "ns3/packet.h"
 #include <algorithm>
 #include "couwbat-1-byte-header.h"
+#include "couwbat-crc32.h"
 
 namespace ns3
 {
@@ -155,68 +156,255 @@ CouwbatPacketHelper::CreateMap (Mac48Address source,
   return CreateCouwbatControlPacket (packet, fc, source, BroadcastAddr, seq);
 }
 
+Ptr<Packet>
+CouwbatPacketHelper::CreateMapGrants (const std::vector<CouwbatMapSubpacket>& subpackets,
+                                      const std::map<Mac48Address, uint8_t>& shortIds)
+{
+  std::vector<CouwbatMapGrant> grants;
+  for (std::vector<CouwbatMapSubpacket>::const_iterator it = subpackets.begin (); it != subpackets.end (); ++it)
+    {
+      std::map<Mac48Address, uint8_t>::const_iterator id = shortIds.find (it->m_ie_id);
+      NS_ASSERT_MSG (id != shortIds.end (), "No short ID for " << it->m_ie_id);
+
+      if (!grants.empty ())
+        {
+          CouwbatMapGrant &last = grants.back ();
+          if (last.m_shortId == id->second
+              && last.m_ofdm_count == it->m_ofdm_count
+              && last.m_ofdm_offset + last.m_repeat * last.m_ofdm_count == it->m_ofdm_offset
+              && last.m_repeat < 255)
+            {
+              // Next burst of the current run
+              ++last.m_repeat;
+              continue;
+            }
+        }
+
+      CouwbatMapGrant grant;
+      grant.m_shortId = id->second;
+      grant.m_ofdm_offset = it->m_ofdm_offset;
+      grant.m_ofdm_count = it->m_ofdm_count;
+      grant.m_repeat = 1;
+      grants.push_back (grant);
+    }
+
+  NS_ASSERT (grants.size () < 256);
+  Ptr<Packet> ret = Create<Packet> ();
+  for (std::vector<CouwbatMapGrant>::reverse_iterator it = grants.rbegin (); it != grants.rend (); ++it)
+    {
+      ret->AddHeader (*it);
+    }
+  Couwbat1ByteHeader count;
+  count.SetVal (grants.size ());
+  ret->AddHeader (count);
+  return ret;
+}
+
+Ptr<Packet>
+CouwbatPacketHelper::CreateMap (Mac48Address source,
+        const std::vector<CouwbatMapSubpacket>& dlSubpackets,
+        const std::vector<CouwbatMapSubpacket>& ulSubpackets,
+        const std::map<Mac48Address, uint8_t>& shortIds,
+        const std::set<Mac48Address>& announce)
+{
+  NS_LOG_FUNCTION(source << dlSubpackets.size () << ulSubpackets.size () << announce.size ());
+
+  // One MCS vector per STA, in order of first appearance
+  std::vector<CouwbatMapStaMcs> staMcs;
+  std::set<uint8_t> seen;
+  for (uint32_t i = 0; i < dlSubpackets.size () + ulSubpackets.size (); ++i)
+    {
+      const CouwbatMapSubpacket &subp = (i < dlSubpackets.size ()) ? dlSubpackets[i] : ulSubpackets[i - dlSubpackets.size ()];
+      std::map<Mac48Address, uint8_t>::const_iterator id = shortIds.find (subp.m_ie_id);
+      NS_ASSERT_MSG (id != shortIds.end (), "No short ID for " << subp.m_ie_id);
+      if (!seen.insert (id->second).second)
+        {
+          continue;
+        }
+
+      CouwbatMapStaMcs entry;
+      entry.m_shortId = id->second;
+      std::copy (subp.m_amc, subp.m_amc + sizeof (subp.m_amc), entry.m_amc);
+      staMcs.push_back (entry);
+    }
+
+  Ptr<Packet> packet = CreateMapGrants (dlSubpackets, shortIds);
+  packet->AddAtEnd (CreateMapGrants (ulSubpackets, shortIds));
+
+  for (std::vector<CouwbatMapStaMcs>::reverse_iterator it = staMcs.rbegin (); it != staMcs.rend (); ++it)
+    {
+      packet->AddHeader (*it);
+    }
+  Couwbat1ByteHeader staCount;
+  staCount.SetVal (staMcs.size ());
+  packet->AddHeader (staCount);
+
+  uint8_t announceCount = 0;
+  for (std::set<Mac48Address>::const_reverse_iterator it = announce.rbegin (); it != announce.rend (); ++it)
+    {
+      std::map<Mac48Address, uint8_t>::const_iterator id = shortIds.find (*it);
+      NS_ASSERT_MSG (id != shortIds.end (), "No short ID for " << *it);
+      CouwbatMapIdAssignment assignment;
+      assignment.m_shortId = id->second;
+      assignment.m_addr = *it;
+      packet->AddHeader (assignment);
+      ++announceCount;
+    }
+  Couwbat1ByteHeader announceHeader;
+  announceHeader.SetVal (announceCount);
+  packet->AddHeader (announceHeader);
+
+  couwbat_frame_t fc = COUWBAT_FC_CONTROL_MAP_COMPACT;
+  Mac48Address BroadcastAddr = "ff:ff:ff:ff:ff:ff";
+  uint8_t seq = 0;
+
+  return CreateCouwbatControlPacket (packet, fc, source, BroadcastAddr, seq);
+}
+
 bool
-CouwbatPacketHelper::GetMapSubpackets (Ptr<const Packet> packet, std::vector<Ptr<Packet> >& dlSubpackets,
-               std::vector<Ptr<Packet> >& ulSubpackets)
+CouwbatPacketHelper::GetCompactMapSubpackets (Ptr<const Packet> packet, std::vector<Ptr<Packet> >& dlSubpackets,
+                                              std::vector<Ptr<Packet> >& ulSubpackets,
+                                              std::map<uint8_t, Mac48Address> &shortIds)
 {
-  uint32_t packetSize = packet->GetSize ();
   Packet p (*packet);
 
   CouwbatMacHeader couwbatHeader;
-  if ((packetSize -= couwbatHeader.GetHeaderSize ()) < 0) return false;
+  if (p.GetSize () < couwbatHeader.GetHeaderSize ()) return false;
   p.RemoveHeader (couwbatHeader);
 
-  CouwbatMapSubpacket dummy;
-  const uint32_t subpacketSize = dummy.GetSerializedSize ();
-
-  Couwbat1ByteHeader dlHeader;
-  if ((packetSize -= dlHeader.GetHeaderSize ()) < 0) return false;
-  p.RemoveHeader (dlHeader);
+  // Short ID assignments are only taken over if the FCS matches
+  std::map<uint8_t, Mac48Address> ids = shortIds;
 
-  uint32_t total_ie_dl = dlHeader.GetVal ();
-  while (total_ie_dl != 0)
+  Couwbat1ByteHeader count;
+  CouwbatMapIdAssignment assignment;
+  if (p.GetSize () < count.GetHeaderSize ()) return false;
+  p.RemoveHeader (count);
+  for (uint32_t i = 0; i < count.GetVal (); ++i)
     {
-      // check for corrupt packet, incorrect total_ie_dl
-      if ((packetSize -= subpacketSize) < 0) return false;
-
-      dlSubpackets.push_back (p.CreateFragment (0, subpacketSize));
-      p.RemoveAtStart (subpacketSize);
-      --total_ie_dl;
+      if (p.GetSize () < assignment.GetHeaderSize ()) return false;
+      p.RemoveHeader (assignment);
+      ids[assignment.m_shortId] = assignment.m_addr;
     }
 
-  Couwbat1ByteHeader ulHeader;
-  if ((packetSize -= ulHeader.GetHeaderSize ()) < 0) return false;
-  p.RemoveHeader (ulHeader);
+  std::map<uint8_t, CouwbatMapStaMcs> staMcs;
+  CouwbatMapStaMcs mcs;
+  if (p.GetSize () < count.GetHeaderSize ()) return false;
+  p.RemoveHeader (count);
+  for (uint32_t i = 0; i < count.GetVal (); ++i)
+    {
+      if (p.GetSize () < mcs.GetHeaderSize ()) return false;
+      p.RemoveHeader (mcs);
+      staMcs[mcs.m_shortId] = mcs;
+    }
 
-  uint32_t total_ie_ul = ulHeader.GetVal ();
-  while (total_ie_ul != 0)
+  std::vector<Ptr<Packet> > *target[2] = { &dlSubpackets, &ulSubpackets };
+  CouwbatMapGrant grant;
+  for (uint32_t dir = 0; dir < 2; ++dir)
     {
-      // check for corrupt packet, incorrect total_ie_ul
-      if ((packetSize -= subpacketSize) < 0) return false;
+      if (p.GetSize () < count.GetHeaderSize ()) return false;
+      p.RemoveHeader (count);
+      for (uint32_t i = 0; i < count.GetVal (); ++i)
+        {
+          if (p.GetSize () < grant.GetHeaderSize ()) return false;
+          p.RemoveHeader (grant);
 
-      ulSubpackets.push_back (p.CreateFragment (0, subpacketSize));
-      p.RemoveAtStart (subpacketSize);
-      --total_ie_ul;
+          std::map<uint8_t, CouwbatMapStaMcs>::const_iterator m = staMcs.find (grant.m_shortId);
+          if (m == staMcs.end ()) return false; // grant without MCS vector
+
+          CouwbatMapSubpacket subp;
+          std::map<uint8_t, Mac48Address>::const_iterator id = ids.find (grant.m_shortId);
+          if (id != ids.end ())
+            {
+              subp.m_ie_id = id->second;
+            }
+          std::copy (m->second.m_amc, m->second.m_amc + sizeof (subp.m_amc), subp.m_amc);
+          subp.m_ofdm_count = grant.m_ofdm_count;
+          for (uint32_t k = 0; k < grant.m_repeat; ++k)
+            {
+              subp.m_ofdm_offset = grant.m_ofdm_offset + k * grant.m_ofdm_count;
+              Ptr<Packet> subpacket = Create<Packet> ();
+              subpacket->AddHeader (subp);
+              target[dir]->push_back (subpacket);
+            }
+        }
     }
 
-  uint32_t fcsSize = couwbatHeader.GetHeaderSize ()
-      + subpacketSize * (dlHeader.GetVal () + ulHeader.GetVal ())
-      + dlHeader.GetHeaderSize () + ulHeader.GetHeaderSize ();
+  uint32_t fcsSize = packet->GetSize () - p.GetSize ();
 
   CouwbatFcsHeader fcs;
-  if ((packetSize -= fcs.GetHeaderSize ()) < 0) return false;
+  if (p.GetSize () < fcs.GetHeaderSize ()) return false;
   p.RemoveHeader (fcs);
-  bool fcsCorrect = fcs.CheckFcs (packet, fcsSize);
-  if (!fcsCorrect) return false;
+  if (!fcs.CheckFcs (packet, fcsSize)) return false;
+
+  shortIds = ids;
+  return true;
+}
+
+bool
+CouwbatPacketHelper::GetMapSubpackets (Ptr<const Packet> packet, Scratch &scratch, std::vector<Ptr<Packet> >& dlSubpackets,
+               std::vector<Ptr<Packet> >& ulSubpackets, std::map<uint8_t, Mac48Address> *shortIds)
+{
+  const uint32_t packetSize = packet->GetSize ();
+
+  CouwbatMacHeader couwbatHeader;
+  if (packetSize < couwbatHeader.GetHeaderSize ()) return false;
+  packet->PeekHeader (couwbatHeader);
+
+  if (couwbatHeader.GetFrameType () == COUWBAT_FC_CONTROL_MAP_COMPACT)
+    {
+      std::map<uint8_t, Mac48Address> noShortIds;
+      return GetCompactMapSubpackets (packet, dlSubpackets, ulSubpackets, shortIds ? *shortIds : noShortIds);
+    }
+
+  const uint8_t *data = GetContiguousView (packet, scratch);
+
+  CouwbatMapSubpacket dummy;
+  const uint32_t subpacketSize = dummy.GetSerializedSize ();
+  Couwbat1ByteHeader countHeader;
+  const uint32_t countSize = countHeader.GetHeaderSize ();
+  CouwbatFcsHeader fcs;
+
+  // Layout: MAC header, DL count, DL subpackets, UL count, UL subpackets, FCS
+  const uint32_t dlOffset = couwbatHeader.GetHeaderSize () + countSize;
+  if (packetSize < dlOffset) return false;
+  const uint32_t dlCount = data[dlOffset - countSize];
+
+  const uint32_t ulOffset = dlOffset + dlCount * subpacketSize + countSize;
+  if (packetSize < ulOffset) return false;
+  const uint32_t ulCount = data[ulOffset - countSize];
+
+  const uint32_t fcsOffset = ulOffset + ulCount * subpacketSize;
+  if (packetSize < fcsOffset + fcs.GetHeaderSize ()) return false;
+  fcs.Deserialize (data + fcsOffset);
+  if (!fcs.CheckFcs (data, fcsOffset)) return false;
+
+  // Subpackets are fragments of the received packet, no bytes are copied
+  for (uint32_t i = 0; i < dlCount; ++i)
+    {
+      dlSubpackets.push_back (packet->CreateFragment (dlOffset + i * subpacketSize, subpacketSize));
+    }
+  for (uint32_t i = 0; i < ulCount; ++i)
+    {
+      ulSubpackets.push_back (packet->CreateFragment (ulOffset + i * subpacketSize, subpacketSize));
+    }
 
   return true;
 }
 
+const uint8_t *
+CouwbatPacketHelper::GetContiguousView (Ptr<const Packet> packet, Scratch &scratch)
+{
+  std::vector<uint8_t> &view = scratch.view;
+  view.resize (std::max<uint32_t> (packet->GetSize (), 1));
+  packet->CopyData (&view[0], packet->GetSize ());
+  return &view[0];
+}
+
 Ptr<Packet>
 CouwbatPacketHelper::CreateDlDataPacket (
     Mac48Address source, Mac48Address destination,
     uint8_t seq, CouwbatTxQueue &txQueue, uint32_t maxSizeBytes,
-    uint8_t ack, std::vector<Ptr<Packet> >& payloadHist)
+    uint8_t ack, std::vector<Ptr<Packet> >& payloadHist, Scratch &scratch)
 {
   CouwbatMacHeader header;
   header.SetFrameType (COUWBAT_FC_DATA_DL);
@@ -234,18 +422,18 @@ CouwbatPacketHelper::CreateDlDataPacket (
 
   uint32_t maxSizeBytesWithoutHeaders = maxSizeBytes - (header.GetSerializedSize () + ackHeader.GetSerializedSize () + nrMpus.GetSerializedSize () + trailer.GetSerializedSize ());
 
-  uint8_t mpuCnt = 0;
-  Ptr<Packet> burst = CouwbatPacketHelper::CreateBurst (destination, txQueue, maxSizeBytesWithoutHeaders, mpuCnt, payloadHist);
-  NS_ASSERT (burst->GetSize () <= maxSizeBytesWithoutHeaders);
-
-  nrMpus.SetVal (mpuCnt);
-  burst->AddHeader (nrMpus);
-  burst->AddHeader (ackHeader);
-  burst->AddHeader (header);
+  Buffer headers;
+  headers.AddAtStart (header.GetSerializedSize () + ackHeader.GetSerializedSize ());
+  Buffer::Iterator i = headers.Begin ();
+  header.Serialize (i);
+  i.Next (header.GetSerializedSize ());
+  ackHeader.Serialize (i);
+  uint8_t headerBytes[128];
+  NS_ASSERT (headers.GetSize () <= sizeof (headerBytes));
+  headers.CopyData (headerBytes, headers.GetSize ());
 
-  uint32_t fcsSize = header.GetHeaderSize () + ackHeader.GetHeaderSize () + nrMpus.GetHeaderSize ();
-  trailer.CalcFcs (burst, fcsSize);
-  burst->AddTrailer (trailer);
+  Ptr<Packet> burst = CouwbatPacketHelper::CreateBurst (headerBytes, headers.GetSize (), destination, txQueue,
+                                                        maxSizeBytesWithoutHeaders, payloadHist, scratch);
 
   NS_ASSERT (burst->GetSize () <= maxSizeBytes);
 
@@ -256,7 +444,8 @@ Ptr<Packet>
 CouwbatPacketHelper::CreateUlDataPacket (
     Mac48Address source, Mac48Address destination,
     uint8_t seq, CouwbatTxQueue &txQueue, uint32_t maxSizeBytes,
-    uint8_t ack, std::vector<uint8_t> cqi, std::vector<Ptr<Packet> >& payloadHist)
+    uint8_t ack, const CouwbatCqiArray &cqi, std::vector<Ptr<Packet> >& payloadHist,
+    Scratch &scratch)
 {
   CouwbatMacHeader header;
   header.SetFrameType (COUWBAT_FC_DATA_UL);
@@ -266,17 +455,7 @@ CouwbatPacketHelper::CreateUlDataPacket (
 
   CouwbatUlBurstHeader ulHeader;
   ulHeader.m_ack = ack;
-  for (uint32_t k = 0; k < Couwbat::MAX_SUBCHANS; ++k)
-    {
-      if (k < cqi.size ())
-        {
-          ulHeader.m_cqi[k] = cqi[k];
-        }
-      else
-        {
-          ulHeader.m_cqi[k] = 0;
-        }
-    }
+  std::copy (cqi.begin (), cqi.end (), ulHeader.m_cqi);
 
   Couwbat1ByteHeader nrMpus;
 
@@ -286,18 +465,18 @@ CouwbatPacketHelper::CreateUlDataPacket (
   uint32_t maxSizeBytesWithoutHeaders = maxSizeBytes - (header.GetSerializedSize () + ulHeader.GetSerializedSize ()
       + nrMpus.GetSerializedSize () + trailer.GetSerializedSize ());
 
-  uint8_t mpuCnt = 0;
-  Ptr<Packet> burst = CouwbatPacketHelper::CreateBurst (destination, txQueue, maxSizeBytesWithoutHeaders, mpuCnt, payloadHist);
-  NS_ASSERT (burst->GetSize () <= maxSizeBytesWithoutHeaders);
-
-  nrMpus.SetVal (mpuCnt);
-  burst->AddHeader (nrMpus);
-  burst->AddHeader (ulHeader);
-  burst->AddHeader (header);
+  Buffer headers;
+  headers.AddAtStart (header.GetSerializedSize () + ulHeader.GetSerializedSize ());
+  Buffer::Iterator i = headers.Begin ();
+  header.Serialize (i);
+  i.Next (header.GetSerializedSize ());
+  ulHeader.Serialize (i);
+  uint8_t headerBytes[128];
+  NS_ASSERT (headers.GetSize () <= sizeof (headerBytes));
+  headers.CopyData (headerBytes, headers.GetSize ());
 
-  uint32_t fcsSize = header.GetHeaderSize () + ulHeader.GetHeaderSize () + nrMpus.GetHeaderSize ();
-  trailer.CalcFcs (burst, fcsSize);
-  burst->AddTrailer (trailer);
+  Ptr<Packet> burst = CouwbatPacketHelper::CreateBurst (headerBytes, headers.GetSize (), destination, txQueue,
+                                                        maxSizeBytesWithoutHeaders, payloadHist, scratch);
 
   NS_ASSERT (burst->GetSize () <= maxSizeBytes);
 
@@ -305,28 +484,27 @@ CouwbatPacketHelper::CreateUlDataPacket (
 }
 
 Ptr<Packet>
-CouwbatPacketHelper::CreateBurst (Mac48Address destination, CouwbatTxQueue &txQueue, uint32_t maxSizeBytes, uint8_t &mpuCnt,
-                                  std::vector<Ptr<Packet> >& payloadHist)
+CouwbatPacketHelper::CreateBurst (const uint8_t *headers, uint32_t headersSize,
+                                  Mac48Address destination, CouwbatTxQueue &txQueue,
+                                  uint32_t maxSizeBytes, std::vector<Ptr<Packet> >& payloadHist,
+                                  Scratch &scratch)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  Ptr<Packet> ret = Create<Packet> ();
-  mpuCnt = 0;
+  static const uint32_t delimiterSize = CouwbatMpduDelimiter ().GetSerializedSize ();
+
+  std::vector<uint8_t> &burstBuffer = scratch.burst;
+  std::vector<Ptr<Packet> > &payloads = scratch.payloads;
+  payloads.clear ();
+  uint32_t mpuCnt = 0;
 
+  // Determine the layout and dequeue the payloads that fit
+  uint32_t burstSize = 0;
   Ptr<Packet> currentPayload = txQueue.Peek (destination);
   while (currentPayload && mpuCnt < 254)
     {
-      const uint32_t payloadSize = currentPayload->GetSize ();
-      CouwbatMpduDelimiter delimiter (payloadSize);
-      // std::cout << "payloadSize:" << payloadSize << "\n";
-      static const uint32_t delimiterSize = delimiter.GetSerializedSize ();
-      const uint32_t dataSize = payloadSize + delimiterSize;
-      uint32_t padding = 0;
-      if (dataSize % 4 != 0)
-        {
-          padding = 4 - (dataSize % 4);
-        }
-      const uint32_t totalSize = dataSize + padding;
+      const uint32_t dataSize = currentPayload->GetSize () + delimiterSize;
+      const uint32_t totalSize = (dataSize + 3) & ~3u;
       if (totalSize + delimiterSize > maxSizeBytes)
         {
           // doesn't fit, stop adding
@@ -335,57 +513,84 @@ CouwbatPacketHelper::CreateBurst (Mac48Address destination, CouwbatTxQueue &txQu
 
       bool retransmission = false;
       txQueue.Pop (destination, retransmission);
-      Ptr<Packet> mpdu_header = Create<Packet> ();
-      mpdu_header->AddHeader (delimiter);
-      ret->AddAtEnd (mpdu_header);
-      ret->AddAtEnd (currentPayload);
+      payloads.push_back (currentPayload);
       if (!retransmission)
         {
           payloadHist.push_back (currentPayload);
         }
-      if (padding > 0)
-        {
-          // Add real padding
-          uint8_t *buf = new uint8_t[padding];
-          Ptr<Packet> padPacket = Create<Packet> (buf, padding);
-          delete[] buf;
-          ret->AddAtEnd (padPacket);
-        }
 
+      burstSize += totalSize;
       maxSizeBytes -= totalSize;
       currentPayload = txQueue.Peek (destination);
       ++mpuCnt;
     }
-
-  CouwbatMpduDelimiter lastDelimiter (0);
-  Ptr<Packet> mpdu_header = Create<Packet> ();
-  mpdu_header->AddHeader (lastDelimiter);
-  ret->AddAtEnd (mpdu_header);
+  burstSize += delimiterSize;
   ++mpuCnt;
 
-  return ret;
+  // Frame headers and number of MPDUs, the FCS covers exactly these bytes
+  const uint32_t fcsSize = headersSize + 1;
+  const uint32_t frameSize = fcsSize + burstSize + CouwbatFcsTrailer ().GetSerializedSize ();
+  burstBuffer.assign (frameSize, 0);
+  std::copy (headers, headers + headersSize, burstBuffer.begin ());
+  burstBuffer[headersSize] = mpuCnt;
+  const uint32_t crc = CouwbatCrc32::Calculate (&burstBuffer[0], fcsSize);
+
+  // Serialize delimiters and payloads, the alignment padding stays zero
+  Buffer delimiterBuffer;
+  delimiterBuffer.AddAtStart (delimiterSize);
+  uint32_t offset = fcsSize;
+  for (std::vector<Ptr<Packet> >::const_iterator it = payloads.begin (); it != payloads.end (); ++it)
+    {
+      const uint32_t payloadSize = (*it)->GetSize ();
+      CouwbatMpduDelimiter (payloadSize).Serialize (delimiterBuffer.Begin ());
+      delimiterBuffer.CopyData (&burstBuffer[offset], delimiterSize);
+      (*it)->CopyData (&burstBuffer[offset + delimiterSize], payloadSize);
+      offset += (payloadSize + delimiterSize + 3) & ~3u;
+    }
+  CouwbatMpduDelimiter (0).Serialize (delimiterBuffer.Begin ());
+  delimiterBuffer.CopyData (&burstBuffer[offset], delimiterSize);
+  offset += delimiterSize;
+  NS_ASSERT (offset == fcsSize + burstSize);
+
+  // FCS trailer, Buffer::Iterator::WriteU32 writes little endian
+  burstBuffer[offset] = crc & 0xff;
+  burstBuffer[offset + 1] = (crc >> 8) & 0xff;
+  burstBuffer[offset + 2] = (crc >> 16) & 0xff;
+  burstBuffer[offset + 3] = crc >> 24;
+
+  payloads.clear ();
+  return Create<Packet> (&burstBuffer[0], frameSize);
+}
+
+void
+CouwbatPacketHelper::AddPadding (Ptr<Packet> packet, uint32_t size)
+{
+  if (size > 0)
+    {
+      packet->AddAtEnd (Create<Packet> (size));
+    }
 }
 
 bool
-CouwbatPacketHelper::GetPayload (Ptr<Packet> packet, std::vector<Ptr<Packet> > &payloadTarget, CouwbatUlBurstHeader *ulHeaderTarget, Couwbat1ByteHeader *dlHeaderTarget)
+CouwbatPacketHelper::GetPayload (Ptr<Packet> packet, Scratch &scratch, std::vector<Ptr<Packet> > &payloadTarget, CouwbatUlBurstHeader *ulHeaderTarget, Couwbat1ByteHeader *dlHeaderTarget)
 {
   NS_LOG_FUNCTION (packet << ulHeaderTarget << dlHeaderTarget);
 
-  uint32_t packetSize = packet->GetSize ();
-  Packet p (*packet);
-  p.RemoveAllByteTags ();
-  p.RemoveAllPacketTags ();
+  const uint32_t packetSize = packet->GetSize ();
 
   CouwbatMacHeader header;
-  if ((packetSize -= header.GetHeaderSize ()) < 0) return false;
-  p.RemoveHeader (header);
-  uint32_t fcsSize = header.GetHeaderSize ();
+  if (packetSize < header.GetHeaderSize ()) return false;
+  packet->PeekHeader (header);
+
+  // Walk the frame once on a contiguous copy of its bytes
+  const uint8_t *data = GetContiguousView (packet, scratch);
+  uint32_t offset = header.GetHeaderSize ();
+
   if (header.GetFrameType () == COUWBAT_FC_DATA_UL)
     {
       CouwbatUlBurstHeader ul_header;
-      if ((packetSize -= ul_header.GetHeaderSize ()) < 0) return false;
-      p.RemoveHeader (ul_header);
-      fcsSize += ul_header.GetHeaderSize ();
+      if (packetSize - offset < ul_header.GetHeaderSize ()) return false;
+      offset += ul_header.Deserialize (data + offset);
       if (ulHeaderTarget)
         {
           *ulHeaderTarget = ul_header;
@@ -395,9 +600,9 @@ CouwbatPacketHelper::GetPayload (Ptr<Packet> packet, std::vector<Ptr<Packet> > &
   if (header.GetFrameType () == COUWBAT_FC_DATA_DL)
     {
       Couwbat1ByteHeader dl_header;
-      if ((packetSize -= dl_header.GetHeaderSize ()) < 0) return false;
-      p.RemoveHeader (dl_header);
-      fcsSize += dl_header.GetHeaderSize ();
+      if (packetSize - offset < dl_header.GetHeaderSize ()) return false;
+      dl_header.SetVal (data[offset]);
+      offset += dl_header.GetHeaderSize ();
       if (dlHeaderTarget)
         {
           *dlHeaderTarget = dl_header;
@@ -405,47 +610,55 @@ CouwbatPacketHelper::GetPayload (Ptr<Packet> packet, std::vector<Ptr<Packet> > &
     }
 
   Couwbat1ByteHeader nrMpus;
-  if ((packetSize -= nrMpus.GetHeaderSize ()) < 0) return false;
-  p.RemoveHeader (nrMpus);
-  fcsSize += nrMpus.GetHeaderSize ();
-  uint32_t payloadCount = nrMpus.GetVal ();
-
-  NS_LOG_INFO (p.ToString ());
-
-  NS_ASSERT (packetSize == p.GetSize ());
-
-  while (payloadCount != 0 && p.GetSize () > 4)
+  if (packetSize - offset < nrMpus.GetHeaderSize ()) return false;
+  uint32_t payloadCount = data[offset];
+  offset += nrMpus.GetHeaderSize ();
+  const uint32_t fcsSize = offset;
+
+  // Collect the MPDU positions first, fragments are only created once the FCS is verified
+  std::vector<std::pair<uint32_t, uint32_t> > &mpdus = scratch.mpdus;
+  mpdus.clear ();
+
+  CouwbatMpduDelimiter mpdu_del;
+  const uint32_t delimiterSize = mpdu_del.GetHeaderSize ();
+  while (payloadCount != 0 && packetSize - offset > 4)
     {
-      CouwbatMpduDelimiter mpdu_del;
-      if ((packetSize -= mpdu_del.GetHeaderSize ()) < 0) return false;
-      p.RemoveHeader (mpdu_del);
+      if (packetSize - offset < delimiterSize) return false;
+      offset += mpdu_del.Deserialize (data + offset);
 
-      uint32_t mpdu_len = mpdu_del.GetMpduLen ();
+      const uint32_t mpdu_len = mpdu_del.GetMpduLen ();
       if (mpdu_len == 0)
         {
           break;
         }
       if (mpdu_del.IsValid ())
         {
+          if (packetSize - offset < mpdu_len) return false;
           uint32_t padding = 0;
-          if ((mpdu_len % 4) != 0 && (p.GetSize () - mpdu_len) > 4)
+          if ((mpdu_len % 4) != 0 && (packetSize - offset - mpdu_len) > 4)
             {
               padding = 4 - (mpdu_len % 4);
             }
 
-          if ((packetSize -= mpdu_len + padding) < 0) return false;
-          payloadTarget.push_back (p.CreateFragment (0, mpdu_len));
-          p.RemoveAtStart (mpdu_len + padding);
-
+          mpdus.push_back (std::make_pair (offset, mpdu_len));
+          offset += mpdu_len + padding;
           --payloadCount;
         }
     }
 
   CouwbatFcsHeader fcs;
-  if ((packetSize -= fcs.GetHeaderSize ()) < 0) return false;
-  p.RemoveHeader (fcs);
-  bool fcsCorrect = fcs.CheckFcs (packet, fcsSize);
-  if (!fcsCorrect) return false;
+  if (packetSize - offset < fcs.GetHeaderSize ()) return false;
+  fcs.Deserialize (data + offset);
+  if (!fcs.CheckFcs (data, fcsSize)) return false;
+
+  // Payloads are fragments of the received packet, no bytes are copied
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator it = mpdus.begin (); it != mpdus.end (); ++it)
+    {
+      Ptr<Packet> payload = packet->CreateFragment (it->first, it->second);
+      payload->RemoveAllByteTags ();
+      payload->RemoveAllPacketTags ();
+      payloadTarget.push_back (payload);
+    }
 
   return true;
 }
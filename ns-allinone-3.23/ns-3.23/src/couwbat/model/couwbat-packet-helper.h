@@ -6,12 +6,16 @@
 #include "couwbat-mac-header.h"
 #include "couwbat-mpdu-delimiter.h"
 #include "couwbat-map-subpacket.h"
+#include "couwbat-compact-map.h"
 #include "couwbat-meta-header.h"
 #include "couwbat-pss-header.h"
 #include "couwbat-tx-queue.h"
 #include "couwbat-ul-burst-header.h"
 #include "couwbat-1-byte-header.h"
 #include "couwbat-packet-fcs.h"
+#include "couwbat-subchannel-array.h"
+#include <map>
+#include <set>
 
 namespace ns3 {
 
@@ -32,6 +36,22 @@ std::ostream& operator << (std::ostream& out, const std::vector<double> vec);
 class CouwbatPacketHelper
 {
 public:
+  /**
+   * \brief Buffers reused between calls of the packet helper
+   *
+   * The helper functions keep no state of their own, every caller passes its
+   * Scratch (usually a member of the MAC). Different Scratch objects may be
+   * used in parallel, e.g. by simulations running in several threads. The
+   * buffers grow to the largest frame once.
+   */
+  struct Scratch
+  {
+    std::vector<uint8_t> view; //!< Contiguous copy of a received frame
+    std::vector<uint8_t> burst; //!< Frame being assembled
+    std::vector<Ptr<Packet> > payloads; //!< Payloads of the frame being assembled
+    std::vector<std::pair<uint32_t, uint32_t> > mpdus; //!< Offset and size of the MPDUs of a received frame
+  };
+
   /**
    * \brief Create a Couwbat Packet without a payload
    *
@@ -67,40 +87,84 @@ public:
 				const std::vector<Ptr<Packet> >& dlSubpackets,
 				const std::vector<Ptr<Packet> >& ulSubpackets);
 
+  /**
+   * \brief Create a compact Couwbat DL/UL Map Packet
+   *
+   * Every STA is referenced by its short ID, its MCS vector is sent once, and
+   * back-to-back subpackets with equal OFDM count are merged into one grant.
+   * All subpackets of a STA must use the same MCS vector.
+   *
+   * \param source Source address
+   * \param dlSubpackets DL Map subpackets in order of OFDM offset
+   * \param ulSubpackets UL Map subpackets in order of OFDM offset
+   * \param shortIds Short IDs of all STAs that appear in the subpackets
+   * \param announce STAs whose short ID assignment is included in the Map
+   */
+  static Ptr<Packet> CreateMap (Mac48Address source,
+                                const std::vector<CouwbatMapSubpacket>& dlSubpackets,
+                                const std::vector<CouwbatMapSubpacket>& ulSubpackets,
+                                const std::map<Mac48Address, uint8_t>& shortIds,
+                                const std::set<Mac48Address>& announce);
+
   /**
    * \brief Extract the Map subpackets from a Couwbat DL/UL Map Packet and add them to dlSubpackets and ulSubpackets
    *
+   * Compact Maps are expanded into one subpacket per burst. Short ID assignments
+   * contained in the Map are added to shortIds, grants for unknown short IDs are
+   * returned with an all-zero address.
+   *
    * \returns true if FCS matches, false if not or if packet is otherwise corrupt
    */
-  static bool GetMapSubpackets (Ptr<const Packet> packet,
+  static bool GetMapSubpackets (Ptr<const Packet> packet, Scratch &scratch,
 			       std::vector<Ptr<Packet> >& dlSubpackets,
-			       std::vector<Ptr<Packet> >& ulSubpackets);
+			       std::vector<Ptr<Packet> >& ulSubpackets,
+			       std::map<uint8_t, Mac48Address> *shortIds = 0);
 
   /**
    * \brief Create a Couwbat DL Data Packet from a vector of payload packets
    */
   static Ptr<Packet> CreateDlDataPacket (Mac48Address source, Mac48Address destination,
 					 uint8_t seq, CouwbatTxQueue &txQueue, uint32_t maxSizeBytes,
-					 uint8_t ack, std::vector<Ptr<Packet> >& payloadHist);
+					 uint8_t ack, std::vector<Ptr<Packet> >& payloadHist, Scratch &scratch);
 
   /**
    * \brief Create a Couwbat UL Data Packet from a vector of payload packets
    */
   static Ptr<Packet> CreateUlDataPacket (Mac48Address source, Mac48Address destination,
 					 uint8_t seq, CouwbatTxQueue &txQueue, uint32_t maxSizeBytes,
-					 uint8_t ack, std::vector<uint8_t> cqi, std::vector<Ptr<Packet> >& payloadHist);
+					 uint8_t ack, const CouwbatCqiArray &cqi, std::vector<Ptr<Packet> >& payloadHist,
+					 Scratch &scratch);
 
   /**
    * \brief Get the payload packets from a Couwbat UL or DL Data Packet
    *
-   * Destroys (leaves empty) the argument packet. So make sure you get the
-   * info from the headers first before calling this.
+   * The frame is parsed in a single pass over a contiguous copy of its bytes.
+   * The payloads are fragments of the argument packet and are only added to
+   * payloadTarget if the FCS is correct.
    */
-  static bool GetPayload (Ptr<Packet> packet, std::vector<Ptr<Packet> > &payloadTarget,
+  static bool GetPayload (Ptr<Packet> packet, Scratch &scratch, std::vector<Ptr<Packet> > &payloadTarget,
                           CouwbatUlBurstHeader *ulHeaderTarget = 0,
                           Couwbat1ByteHeader *dlHeaderTarget = 0);
 
+  /**
+   * \brief Append size zero bytes to packet
+   *
+   * The zeros are taken from the zero area of an empty ns3::Buffer,
+   * so no intermediate byte array is needed.
+   */
+  static void AddPadding (Ptr<Packet> packet, uint32_t size);
+
 private:
+    /**
+     * \brief Copy all bytes of packet into scratch.view
+     *
+     * ns-3 packets do not give access to their buffer, so the bytes are copied,
+     * but into a buffer that is reused between calls.
+     *
+     * \return pointer to the first byte, valid until scratch.view is used again
+     */
+    static const uint8_t *GetContiguousView (Ptr<const Packet> packet, Scratch &scratch);
+
     /**
      * \brief Concatenate packets to the first packet
      *
@@ -109,9 +173,36 @@ private:
      */
     static Ptr<Packet> ConcatenatePackets (const std::vector<Ptr<Packet> >& packets);
 
-    static Ptr<Packet> CreateBurst (Mac48Address destination, CouwbatTxQueue &txQueue,
-                                    uint32_t maxSizeBytes, uint8_t &mpuCnt,
-                                    std::vector<Ptr<Packet> >& payloadHist);
+    /**
+     * \brief Compact Map part of GetMapSubpackets
+     */
+    static bool GetCompactMapSubpackets (Ptr<const Packet> packet,
+                                         std::vector<Ptr<Packet> >& dlSubpackets,
+                                         std::vector<Ptr<Packet> >& ulSubpackets,
+                                         std::map<uint8_t, Mac48Address> &shortIds);
+
+    /**
+     * \brief Merge back-to-back subpackets of the same STA into run-length grants
+     */
+    static Ptr<Packet> CreateMapGrants (const std::vector<CouwbatMapSubpacket>& subpackets,
+                                        const std::map<Mac48Address, uint8_t>& shortIds);
+
+    /**
+     * \brief Dequeue payloads for destination and serialize a complete data frame
+     *
+     * The burst layout (delimiters, payloads and 4 byte alignment padding) is determined
+     * first, then all bytes are written into one zero-initialized buffer of the final size:
+     * the serialized frame headers, the number of MPDUs, the burst and the FCS. The FCS is
+     * calculated on the header bytes right after writing them, so the frame is not read again.
+     *
+     * \param headers serialized MAC header and DL ACK or UL burst header
+     * \param headersSize number of bytes in headers
+     * \param maxSizeBytes maximum size of the burst, i.e. without headers, number of MPDUs and FCS
+     */
+    static Ptr<Packet> CreateBurst (const uint8_t *headers, uint32_t headersSize,
+                                    Mac48Address destination, CouwbatTxQueue &txQueue,
+                                    uint32_t maxSizeBytes, std::vector<Ptr<Packet> >& payloadHist,
+                                    Scratch &scratch);
 };
 
 } // namespace ns3
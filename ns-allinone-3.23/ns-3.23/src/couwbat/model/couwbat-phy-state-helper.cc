@@ -253,7 +253,7 @@ CouwbatPhyStateHelper::SwitchToRx (Time rxDuration)
 }
 
 void
-CouwbatPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, std::vector<double> snrW, CouwbatMode mode)
+CouwbatPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, const CouwbatSnrArray &snrW, CouwbatMode mode)
 {
   NS_LOG_DEBUG (this << "SwitchFromRxEndOk, " << "snrs[]");
   m_rxOkTrace (packet);
@@ -264,19 +264,21 @@ CouwbatPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, std::vector<double
     {
       Time now = Simulator::Now ();
 
-      static const uint32_t sfDuration = Couwbat::GetSuperframeDuration ();
+      const CouwbatConfig &config = *m_phy->GetConfig ();
+      const uint32_t sfDuration = config.GetSuperframeDuration ();
+      const uint32_t symbDuration = config.GetSymbolDuration ();
 
       const int64_t currentSfStart =
           (now.GetMicroSeconds () / sfDuration) * sfDuration;
 
-      const uint32_t currentSymbol = (now.GetMicroSeconds () - currentSfStart + Couwbat::GetSymbolDuration () / 2)
-	      / Couwbat::GetSymbolDuration ();
+      const uint32_t currentSymbol = (now.GetMicroSeconds () - currentSfStart + symbDuration / 2)
+	      / symbDuration;
 
-      uint32_t ofs = (m_startRx.GetMicroSeconds () - currentSfStart + Couwbat::GetSymbolDuration () / 2)
-	      / Couwbat::GetSymbolDuration ();
+      uint32_t ofs = (m_startRx.GetMicroSeconds () - currentSfStart + symbDuration / 2)
+	      / symbDuration;
 
-      uint32_t len = ((now - m_startRx).GetMicroSeconds () + Couwbat::GetSymbolDuration () / 2)
-	      / Couwbat::GetSymbolDuration ();
+      uint32_t len = ((now - m_startRx).GetMicroSeconds () + symbDuration / 2)
+	      / symbDuration;
 
       // fill out meta header
       CouwbatMetaHeader mh;
@@ -286,7 +288,7 @@ CouwbatPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, std::vector<double
       mh.m_ofdm_sym_len = len;
       mh.m_allocatedSubChannels.reset ();
       // Default to value CQI N/A
-      memset (mh.m_CQI, 255, Couwbat::GetNumberOfSubchannels ());
+      memset (mh.m_CQI, 255, sizeof (mh.m_CQI));
       const std::vector<uint32_t> &subchannels = mode.GetSubchannels ();
       NS_LOG_DEBUG ("GetSubchannels: " << subchannels.size ());
       for (uint32_t i = 0; i < subchannels.size (); ++i)
@@ -376,7 +378,7 @@ CouwbatPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, std::vector<double
   NS_LOG_WARN ("m_rxOkCallback is null");
 }
 void
-CouwbatPhyStateHelper::SwitchFromRxEndError (Ptr<const Packet> packet, std::vector<double> snr)
+CouwbatPhyStateHelper::SwitchFromRxEndError (Ptr<const Packet> packet, const CouwbatSnrArray &snr)
 {
   // TODO Implement Metaheader here, this function is called in case of RxEndError in PHY
   m_rxErrorTrace (packet);
@@ -418,8 +420,9 @@ CouwbatPhyStateHelper::EnqueueRx (CouwbatMetaHeader mh)
   // Schedule a check and dummy forward up shortly after SwitchFromRxEndOk would be called.
   // This event is cancelled if the RX is successful
   const Time now = Simulator::Now ();
-  static const uint32_t sfDuration = Couwbat::GetSuperframeDuration ();
-  static const uint32_t symbDuration = Couwbat::GetSymbolDuration ();
+  const CouwbatConfig &config = *m_phy->GetConfig ();
+  const uint32_t sfDuration = config.GetSuperframeDuration ();
+  const uint32_t symbDuration = config.GetSymbolDuration ();
   const int64_t currentSfStart = (now.GetMicroSeconds () / sfDuration) * sfDuration;
   const int64_t currentSfCnt = m_phy->GetSfCnt ();
   const int64_t sfOffset = mh.m_ofdm_sym_sframe_count - currentSfCnt;
@@ -487,7 +490,14 @@ CouwbatPhyStateHelper::MhGetBytes (CouwbatMetaHeader mh)
     }
   NS_ASSERT (mcsVector.size () == subchCount);
 
-  uint32_t byteCount = CouwbatMac::TransmittableBytesWithSymbols(symbCount, subchCount, mcsVector);
+  // Same as CouwbatMac::TransmittableBytesWithSymbols, with the configuration of the PHY
+  const CouwbatConfig &config = *m_phy->GetConfig ();
+  double bitsPerSymb = 0;
+  for (uint32_t i = 0; i < mcsVector.size (); ++i)
+    {
+      bitsPerSymb += config.GetDataBitsPerSymbol (mcsVector[i]);
+    }
+  uint32_t byteCount = (symbCount - (double) config.GetSymbolsPreamble ()) * (bitsPerSymb / 8);
   return byteCount;
 }
 
@@ -120,14 +120,14 @@ public:
    * \param mode the transmission mode of the packet
    * \param preamble the preamble of the received packet
    */
-  void SwitchFromRxEndOk (Ptr<Packet> packet, std::vector<double> snr, CouwbatMode mode);
+  void SwitchFromRxEndOk (Ptr<Packet> packet, const CouwbatSnrArray &snr, CouwbatMode mode);
   /**
    * Switch from RX after the reception failed.
    *
    * \param packet the packet that we failed to received
    * \param snr the SNR of the received packet
    */
-  void SwitchFromRxEndError (Ptr<const Packet> packet, std::vector<double> snr);
+  void SwitchFromRxEndError (Ptr<const Packet> packet, const CouwbatSnrArray &snr);
 
   TracedCallback<Time,Time,enum CouwbatPhy::State> m_stateLogger;
 
@@ -41,6 +41,7 @@ CouwbatPhy::GetTypeId (void)
 }
 
 CouwbatPhy::CouwbatPhy ()
+  : m_config (CreateObject<CouwbatConfig> ())
 {
   NS_LOG_FUNCTION (this);
 }
@@ -50,6 +51,19 @@ CouwbatPhy::~CouwbatPhy ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+CouwbatPhy::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  m_config = config;
+}
+
+Ptr<CouwbatConfig>
+CouwbatPhy::GetConfig (void) const
+{
+  return m_config;
+}
+
 uint32_t
 CouwbatPhy::GetPlcpHeaderDurationMicroSeconds (CouwbatMode payloadMode)
 {
@@ -128,17 +142,17 @@ CouwbatPhy::BitsPerSymbol (enum CouwbatMCS mcs)
 }
 
 double
-CouwbatPhy::GetPlcpSymbols (CouwbatTxVector txvector)
+CouwbatPhy::GetPlcpSymbols (CouwbatTxVector txvector) const
 {
   CouwbatMode payloadMode = txvector.GetMode();
   double plcpMicroSeconds = GetPlcpPreambleDurationMicroSeconds (payloadMode);
 	    //+ GetPlcpHeaderDurationMicroSeconds (payloadMode);
-  double plcpSymbols = plcpMicroSeconds / Couwbat::GetSymbolDuration ();
+  double plcpSymbols = plcpMicroSeconds / m_config->GetSymbolDuration ();
   return plcpSymbols;
 }
 
 uint32_t
-CouwbatPhy::SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector)
+CouwbatPhy::SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector) const
 {
   CouwbatMode payloadMode = txvector.GetMode();
 
@@ -153,8 +167,7 @@ CouwbatPhy::SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector)
 
 	for (uint32_t i = 0; i < payloadMode.GetSubchannels().size(); ++i)
 	  {
-	    total_bits_per_symb += (CouwbatPhy::BitsPerSymbol (payloadMode.GetMCS ()[i])
-        * Couwbat::GetNumberOfDataSubcarriersPerSubchannel());
+	    total_bits_per_symb += m_config->GetDataBitsPerSymbol (payloadMode.GetMCS ()[i]);
 	  }
 
 	double total_bytes_per_symb = total_bits_per_symb / 8;
@@ -171,7 +184,7 @@ CouwbatPhy::SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector)
 }
 
 double
-CouwbatPhy::GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvector)
+CouwbatPhy::GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvector) const
 {
   CouwbatMode payloadMode=txvector.GetMode();
 
@@ -184,7 +197,7 @@ CouwbatPhy::GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvec
         double bits_per_symb = 0;
         for (uint32_t i = 0; i < payloadMode.GetSubchannels().size(); ++i)
           {
-            bits_per_symb += (CouwbatPhy::BitsPerSymbol (payloadMode.GetMCS ()[i]) * Couwbat::GetNumberOfDataSubcarriersPerSubchannel());
+            bits_per_symb += m_config->GetDataBitsPerSymbol (payloadMode.GetMCS ()[i]);
           }
 
         // size is in bytes
@@ -194,7 +207,7 @@ CouwbatPhy::GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvec
         // and total number of used subchannels
         uint32_t num_symbols = ceil(size_bits / bits_per_symb);
 
-        uint32_t payload_duration_mus = Couwbat::GetSymbolDuration() * num_symbols;
+        uint32_t payload_duration_mus = m_config->GetSymbolDuration () * num_symbols;
 
         NS_LOG_FUNCTION (payload_duration_mus);
 
@@ -207,7 +220,7 @@ CouwbatPhy::GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvec
 }
 
 Time
-CouwbatPhy::CalculateTxDuration (uint32_t size, CouwbatTxVector txvector)
+CouwbatPhy::CalculateTxDuration (uint32_t size, CouwbatTxVector txvector) const
 {
   CouwbatMode payloadMode=txvector.GetMode();
   double duration = GetPlcpPreambleDurationMicroSeconds (payloadMode)
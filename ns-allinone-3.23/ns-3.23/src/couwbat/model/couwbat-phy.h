@@ -10,6 +10,7 @@
 #include "ns3/traced-callback.h"
 #include "couwbat-tx-vector.h"
 #include "couwbat-mode.h"
+#include "couwbat-config.h"
 
 namespace ns3
 {
@@ -241,9 +242,9 @@ public:
 
   static double BitsPerSymbol (enum CouwbatMCS);
 
-  static double GetPlcpSymbols (CouwbatTxVector txvector);
+  double GetPlcpSymbols (CouwbatTxVector txvector) const;
 
-  static uint32_t SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector);
+  uint32_t SymbolsToBytes (uint32_t num_symbols, CouwbatTxVector txvector) const;
 
   /**
    * \param size the number of bytes in the packet to send
@@ -251,7 +252,7 @@ public:
    * \return the total amount of time this PHY will stay busy for
    *          the transmission of these bytes.
    */
-  static Time CalculateTxDuration (uint32_t size, CouwbatTxVector txvector);
+  Time CalculateTxDuration (uint32_t size, CouwbatTxVector txvector) const;
 
   /**
    * \param payloadMode the CouwbatMode use for the transmission of the payload
@@ -275,7 +276,7 @@ public:
    *
    * \return the duration of the payload in microseconds
    */
-  static double GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvector);
+  double GetPayloadDurationMicroSeconds (uint32_t size, CouwbatTxVector txvector) const;
 
   /**
    * The CouwbatPhy::GetNModes() and CouwbatPhy::GetMode() methods are used
@@ -381,6 +382,20 @@ public:
 
   //virtual void ConfigureStandard ();
 
+  /**
+   * Set the configuration used for durations and symbol calculations.
+   * \param config The configuration, usually set by the CouwbatNetDevice.
+   */
+  virtual void SetConfig (Ptr<CouwbatConfig> config);
+
+  /**
+   * \return the configuration of this PHY
+   */
+  Ptr<CouwbatConfig> GetConfig (void) const;
+
+protected:
+  Ptr<CouwbatConfig> m_config; //!< Configuration shared with the CouwbatNetDevice
+
 private:
   /**
    * The trace source fired when a packet begins the transmission process on
@@ -0,0 +1,115 @@
+#ifndef SRC_COUWBAT_MODEL_COUWBAT_SUBCHANNEL_ARRAY_H_
+#define SRC_COUWBAT_MODEL_COUWBAT_SUBCHANNEL_ARRAY_H_
+
+#include "ns3/assert.h"
+#include "couwbat.h"
+#include <algorithm>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup couwbat
+ *
+ * Fixed size array with one element per subchannel, e.g. the CQI, SNR or
+ * MCS of every subchannel.
+ *
+ * The size is a template parameter, by default Couwbat::MAX_SUBCHANS, which
+ * is also what Couwbat::GetNumberOfSubchannels() returns. The elements are
+ * stored inline, so an array on the stack or inside another object needs no
+ * heap allocation, and loops over all subchannels have a bound known at
+ * compile time.
+ *
+ * Interfaces that pass per-subchannel data as std::vector, e.g.
+ * Couwbat::sinrPerSubchannelCallback, stay as they are; ToVector converts
+ * when such an interface is actually used.
+ */
+template <typename T, uint32_t N = Couwbat::MAX_SUBCHANS>
+class CouwbatSubchannelArray
+{
+public:
+  typedef T value_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  static const uint32_t SIZE = N; //!< Number of elements
+
+  /**
+   * Create an array with default initialized elements, i.e. uninitialized
+   * for built-in types
+   */
+  CouwbatSubchannelArray ()
+  {
+  }
+
+  /**
+   * Create an array with all elements set to value
+   */
+  explicit CouwbatSubchannelArray (const T &value)
+  {
+    Fill (value);
+  }
+
+  /**
+   * Create an array from the first N elements of data
+   */
+  explicit CouwbatSubchannelArray (const T *data)
+  {
+    std::copy (data, data + N, m_data);
+  }
+
+  /**
+   * Set all elements to value
+   */
+  void Fill (const T &value)
+  {
+    std::fill (m_data, m_data + N, value);
+  }
+
+  T &operator[] (uint32_t i)
+  {
+    NS_ASSERT (i < N);
+    return m_data[i];
+  }
+
+  const T &operator[] (uint32_t i) const
+  {
+    NS_ASSERT (i < N);
+    return m_data[i];
+  }
+
+  uint32_t size (void) const { return N; }
+  T *data (void) { return m_data; }
+  const T *data (void) const { return m_data; }
+  iterator begin (void) { return m_data; }
+  iterator end (void) { return m_data + N; }
+  const_iterator begin (void) const { return m_data; }
+  const_iterator end (void) const { return m_data + N; }
+
+  /**
+   * \return a copy of the first n elements
+   */
+  std::vector<T> ToVector (uint32_t n = N) const
+  {
+    NS_ASSERT (n <= N);
+    return std::vector<T> (m_data, m_data + n);
+  }
+
+private:
+  T m_data[N]; //!< Elements, one per subchannel
+};
+
+/**
+ * CQI of every subchannel, 255 means no CQI available
+ */
+typedef CouwbatSubchannelArray<uint8_t> CouwbatCqiArray;
+
+/**
+ * SNR of every subchannel in linear units
+ */
+typedef CouwbatSubchannelArray<double> CouwbatSnrArray;
+
+}
+
+#endif /* SRC_COUWBAT_MODEL_COUWBAT_SUBCHANNEL_ARRAY_H_ */
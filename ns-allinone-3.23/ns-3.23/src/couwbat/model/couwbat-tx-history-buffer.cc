@@ -1,6 +1,6 @@
 #include "couwbat-tx-history-buffer.h"
+#include "couwbat.h"
 #include "ns3/log.h"
-#include <stdexcept>
 
 NS_LOG_COMPONENT_DEFINE ("CouwbatTxHistoryBuffer");
 
@@ -8,7 +8,8 @@ namespace ns3
 {
 
 CouwbatTxHistoryBuffer::CouwbatTxHistoryBuffer ()
-: m_hist ()
+: m_tick (0),
+  m_stats ()
 {
   NS_LOG_FUNCTION (this);
 }
@@ -16,76 +17,149 @@ CouwbatTxHistoryBuffer::CouwbatTxHistoryBuffer ()
 CouwbatTxHistoryBuffer::~CouwbatTxHistoryBuffer ()
 {
   NS_LOG_FUNCTION (this);
-  delete m_hist[0];
-  delete m_hist[1];
-  delete m_hist[2];
-  delete m_hist[3];
-  delete m_hist[4];
 }
 
 void
 CouwbatTxHistoryBuffer::SuperframeTick (CouwbatTxQueue& txQueue)
 {
   NS_LOG_FUNCTION (this);
-  delete m_hist[4];
-  m_hist[4] = m_hist[3];
-  m_hist[3] = m_hist[2];
-  m_hist[2] = m_hist[1];
-  m_hist[1] = m_hist[0];
-  m_hist[0] = new TxHistory ();
+  ++m_tick;
 
   EnqueueRetransmissions (txQueue);
 }
 
+CouwbatTxHistoryBuffer::SeqType
+CouwbatTxHistoryBuffer::NextSeq (SeqType seq)
+{
+  ++seq;
+  return seq == NO_ACK ? seq + 1 : seq;
+}
+
 CouwbatTxHistoryBuffer::PacketList*
 CouwbatTxHistoryBuffer::GetNewList (Mac48Address dest, SeqType seq)
 {
-  NS_LOG_FUNCTION (this << dest << seq);
-  TxHistory *hist = m_hist[0];
-  return &(*hist)[dest][seq];
+  NS_LOG_FUNCTION (this << dest << (int) seq);
+  NS_ASSERT_MSG (seq != NO_ACK, "SEQ number " << (int) NO_ACK << " is reserved for \"not an ACK\"");
+  Window &window = m_windows[dest];
+  Slot &slot = window.slots[seq];
+
+  if (slot.inUse)
+    {
+      // SEQ numbers wrapped around within the timeout, the old burst can no longer be ACKed
+      NS_LOG_DEBUG ("CouwbatTxHistoryBuffer window overrun for " << dest << ", seq " << (int) seq);
+      ++m_stats.windowOverruns;
+      // Delay the retransmission until the next tick, the TX queue is being read right now
+      PacketList &overrun = m_overruns[dest];
+      overrun.insert (overrun.end (), slot.packets.begin (), slot.packets.end ());
+    }
+
+  slot.inUse = true;
+  slot.tick = m_tick;
+  slot.packets.clear ();
+  window.order.push_back (std::make_pair (seq, m_tick));
+  return &slot.packets;
 }
 
 void
 CouwbatTxHistoryBuffer::RegisterAck (Mac48Address dest, SeqType seq)
 {
-  NS_LOG_FUNCTION (this << dest << seq);
-  TxHistory *hist = m_hist[3];
-  try
+  NS_LOG_FUNCTION (this << dest << (int) seq);
+  WindowMap::iterator it = m_windows.find (dest);
+  if (seq == NO_ACK || it == m_windows.end ())
     {
-      hist->at (dest).at (seq);
+      return;
     }
-  catch (const std::out_of_range& oor)
+
+  Slot &slot = it->second.slots[seq];
+  if (!slot.inUse || slot.tick == m_tick)
     {
+      // Unknown SEQ, duplicate ACK or burst not even sent yet
       return;
     }
-  (*hist)[dest].erase (seq);
+
+  for (uint32_t i = 0; i < slot.packets.size (); ++i)
+    {
+      m_stats.ackedBytes += slot.packets[i]->GetSize ();
+    }
+  m_stats.ackedPayloads += slot.packets.size ();
+
+  slot.inUse = false;
+  slot.packets.clear ();
+}
+
+const CouwbatTxHistoryBuffer::Stats &
+CouwbatTxHistoryBuffer::GetStats (void) const
+{
+  return m_stats;
+}
+
+std::vector<Mac48Address>
+CouwbatTxHistoryBuffer::GetDestinations (void) const
+{
+  std::vector<Mac48Address> dests;
+  for (WindowMap::const_iterator it = m_windows.begin (); it != m_windows.end (); ++it)
+    {
+      dests.push_back (it->first);
+    }
+  return dests;
 }
 
 void
-CouwbatTxHistoryBuffer::EnqueueRetransmissions (CouwbatTxQueue& txQueue)
+CouwbatTxHistoryBuffer::RemoveDestination (Mac48Address dest)
 {
-  NS_LOG_FUNCTION (this);
-  TxHistory *hist = m_hist[4];
-  if (!hist)
+  NS_LOG_FUNCTION (this << dest);
+  m_windows.erase (dest);
+  m_overruns.erase (dest);
+}
+
+void
+CouwbatTxHistoryBuffer::Retransmit (Mac48Address dest, PacketList &packets, CouwbatTxQueue &txQueue)
+{
+  // Reenqueue puts packets to the front of the queue, go backwards to keep the original order
+  for (PacketList::reverse_iterator it = packets.rbegin (); it != packets.rend (); ++it)
     {
-      return;
+      NS_LOG_DEBUG ("CouwbatTxHistoryBuffer reenqueue packet: " << (*it)->ToString ());
+      m_stats.retransmittedBytes += (*it)->GetSize ();
+      txQueue.Reenqueue (dest, *it);
     }
+  m_stats.retransmittedPayloads += packets.size ();
+  packets.clear ();
+}
 
-  for (TxHistory::const_iterator it1 = hist->begin (); it1 != hist->end (); ++it1)
+void
+CouwbatTxHistoryBuffer::EnqueueRetransmissions (CouwbatTxQueue& txQueue)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (WindowMap::iterator it = m_windows.begin (); it != m_windows.end (); ++it)
     {
-      Mac48Address dest = it1->first;
-      for (PacketListBySeq::const_iterator it2 = it1->second.begin (); it2 != it1->second.end (); ++it2)
+      Window &window = it->second;
+      while (!window.order.empty ())
         {
-          const PacketList *packList = &(it2->second);
-          for (uint32_t i = 0; i < packList->size (); ++i)
+          const SeqType seq = window.order.front ().first;
+          const uint32_t tick = window.order.front ().second;
+          if (m_tick - tick < Couwbat::ARQ_RETRANSMISSION_TIMEOUT_SF)
             {
-              NS_LOG_DEBUG ("CouwbatTxHistoryBuffer reenqueue packet: " << (*packList)[i]->ToString ());
-              txQueue.Reenqueue (dest, (*packList)[i]);
+              // Bursts are stored in order, all following ones are younger
+              break;
             }
+
+          Slot &slot = window.slots[seq];
+          if (slot.inUse && slot.tick == tick)
+            {
+              // Not ACKed in time
+              Retransmit (it->first, slot.packets, txQueue);
+              slot.inUse = false;
+            }
+          window.order.pop_front ();
         }
     }
 
-  hist->clear ();
+  for (std::map<Mac48Address, PacketList>::iterator it = m_overruns.begin (); it != m_overruns.end (); ++it)
+    {
+      Retransmit (it->first, it->second, txQueue);
+    }
+  m_overruns.clear ();
 }
 
 }
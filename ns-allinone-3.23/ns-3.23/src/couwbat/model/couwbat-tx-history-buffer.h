@@ -4,6 +4,7 @@
 #include "ns3/network-module.h"
 #include "couwbat-tx-queue.h"
 #include <map>
+#include <deque>
 #include <vector>
 
 namespace ns3
@@ -14,6 +15,11 @@ namespace ns3
  * 
  * Helper class for CR-BS and CR-STA for storing all recently sent
  * packets for potential retransmission.
+ *
+ * Implements selective-repeat ARQ: every sent burst is stored in a per destination
+ * window slot indexed by its SEQ number. An ACK releases exactly this slot, all bursts
+ * that are not ACKed within Couwbat::ARQ_RETRANSMISSION_TIMEOUT_SF superframes are
+ * put back to the front of the CouwbatTxQueue.
  */
 class CouwbatTxHistoryBuffer
 {
@@ -22,6 +28,22 @@ public:
   typedef uint8_t SeqType;
   typedef std::vector<PacketType> PacketList;
 
+  static const SeqType NO_ACK = 255; //!< Reserved SEQ number sent in the ACK field when no burst is to be ACKed, never used for a burst
+
+  static SeqType NextSeq (SeqType seq); //!< SEQ number following seq, skipping NO_ACK
+
+  /** \struct Stats
+   * Retransmission statistics, counted when a window slot is released
+   */
+  struct Stats
+  {
+    uint64_t ackedPayloads; //!< Number of payload packets in ACKed bursts
+    uint64_t ackedBytes; //!< Number of payload bytes in ACKed bursts
+    uint64_t retransmittedPayloads; //!< Number of payload packets put back into the TX queue
+    uint64_t retransmittedBytes; //!< Number of payload bytes put back into the TX queue
+    uint64_t windowOverruns; //!< Number of window slots reused by a new burst before being ACKed or timed out
+  };
+
   CouwbatTxHistoryBuffer ();
   ~CouwbatTxHistoryBuffer ();
 
@@ -29,16 +51,52 @@ public:
   
   PacketList *GetNewList (Mac48Address dest, SeqType seq); //!< Get a new list for storing sent packets, added to during packet creation
   
-  void RegisterAck (Mac48Address dest, SeqType seq); //!< Register a received ACK number as successfully received by recipient.
+  void RegisterAck (Mac48Address dest, SeqType seq); //!< Register a received ACK number as successfully received by recipient, NO_ACK is ignored.
+
+  const Stats &GetStats (void) const; //!< Retransmission statistics since creation
+
+  std::vector<Mac48Address> GetDestinations (void) const; //!< Destinations that have a sequence window
+
+  void RemoveDestination (Mac48Address dest); //!< Drop the window and pending retransmissions of a destination that left, e.g. a disassociated STA
 
 private:
 
-  typedef std::map<SeqType, PacketList> PacketListBySeq;
-  typedef std::map<Mac48Address, PacketListBySeq> TxHistory;
+  static const uint32_t WINDOW_SIZE = 256; //!< One slot for every possible SeqType value
+
+  /** \struct Slot
+   * Stored burst of a window
+   */
+  struct Slot
+  {
+    Slot () : inUse (false), tick (0) {}
+
+    bool inUse; //!< True if the burst is neither ACKed nor retransmitted yet
+    uint32_t tick; //!< Superframe tick in which the burst was stored
+    PacketList packets; //!< Payload packets of the burst
+  };
+
+  /** \struct Window
+   * Sequence window of one destination
+   */
+  struct Window
+  {
+    Slot slots[WINDOW_SIZE]; //!< Slots indexed by SEQ number
+    std::deque<std::pair<SeqType, uint32_t> > order; //!< SEQ numbers and ticks of stored bursts in order of storage, used for timeouts
+  };
+
+  typedef std::map<Mac48Address, Window> WindowMap;
 
   void EnqueueRetransmissions (CouwbatTxQueue &txQueue);
 
-  TxHistory *m_hist[5];
+  void Retransmit (Mac48Address dest, PacketList &packets, CouwbatTxQueue &txQueue);
+
+  WindowMap m_windows; //!< Sequence windows by destination address
+
+  std::map<Mac48Address, PacketList> m_overruns; //!< Packets of overwritten window slots, retransmitted on next tick
+
+  uint32_t m_tick; //!< Superframe tick counter
+
+  Stats m_stats; //!< Retransmission statistics
 
 };
 
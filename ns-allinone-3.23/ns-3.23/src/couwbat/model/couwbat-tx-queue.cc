@@ -1,183 +1,490 @@
 #include "couwbat-tx-queue.h"
 #include "couwbat.h"
-#include <stdexcept>
+#include "couwbat-config.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <cmath>
+#include <algorithm>
 
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE ("CouwbatTxQueue");
 
+static uint64_t
+MacToKey (const Mac48Address &addr)
+{
+  uint8_t buf[6];
+  addr.CopyTo (buf);
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < 6; ++i)
+    {
+      key = (key << 8) | buf[i];
+    }
+  return key;
+}
+
+static uint32_t
+HashKey (uint64_t key)
+{
+  // Fibonacci hashing, the high bits are well mixed
+  return (key * 0x9E3779B97F4A7C15ULL) >> 32;
+}
+
+CouwbatTxQueue::CouwbatTxQueue ()
+  : m_table (16),
+    m_tableUsed (0),
+    m_config (CreateObject<CouwbatConfig> ())
+{
+}
+
 void
-CouwbatTxQueue::Enqueue (const Mac48Address dest, PacketType packet)
+CouwbatTxQueue::SetConfig (Ptr<CouwbatConfig> config)
+{
+  m_config = config;
+}
+
+CouwbatTxQueue::DestQueues *
+CouwbatTxQueue::Find (const Mac48Address &dest)
+{
+  const uint64_t key = MacToKey (dest);
+  const uint32_t mask = m_table.size () - 1;
+  for (uint32_t i = HashKey (key) & mask; m_table[i].used; i = (i + 1) & mask)
+    {
+      if (m_table[i].key == key)
+        {
+          return &m_table[i];
+        }
+    }
+  return 0;
+}
+
+CouwbatTxQueue::DestQueues &
+CouwbatTxQueue::FindOrInsert (const Mac48Address &dest)
 {
-  // Initialize queue containers if not yet created
-  try
-  {
-    m_queues.at (dest);
-    m_priorityQueues.at (dest);
-  }
-  catch (const std::out_of_range& oor)
-  {
-    m_queues[dest] = PacketQueueType ();
-    m_priorityQueues[dest] = PacketQueueType ();
-  }
+  const uint64_t key = MacToKey (dest);
+  uint32_t mask = m_table.size () - 1;
+  uint32_t i = HashKey (key) & mask;
+  for (; m_table[i].used; i = (i + 1) & mask)
+    {
+      if (m_table[i].key == key)
+        {
+          return m_table[i];
+        }
+    }
+
+  // New destination, keep the load factor at or below 1/2
+  if (2 * (m_tableUsed + 1) > m_table.size ())
+    {
+      std::vector<DestQueues> old (m_table.size () * 2);
+      old.swap (m_table);
+      mask = m_table.size () - 1;
+      for (std::vector<DestQueues>::iterator it = old.begin (); it != old.end (); ++it)
+        {
+          if (it->used)
+            {
+              uint32_t j = HashKey (it->key) & mask;
+              while (m_table[j].used)
+                {
+                  j = (j + 1) & mask;
+                }
+              m_table[j].used = true;
+              m_table[j].key = it->key;
+              m_table[j].priorityRatioCounter = it->priorityRatioCounter;
+              m_table[j].drrCurrent = it->drrCurrent;
+              for (uint32_t c = 0; c < COUWBAT_TC_COUNT; ++c)
+                {
+                  ClassQueue &to = m_table[j].classes[c];
+                  ClassQueue &from = it->classes[c];
+                  to.queue.swap (from.queue);
+                  to.reenqueueCount = from.reenqueueCount;
+                  to.bytes = from.bytes;
+                  to.deficit = from.deficit;
+                  to.codel = from.codel;
+                }
+            }
+        }
+      i = HashKey (key) & mask;
+      while (m_table[i].used)
+        {
+          i = (i + 1) & mask;
+        }
+    }
+
+  ++m_tableUsed;
+  m_table[i].used = true;
+  m_table[i].key = key;
+  return m_table[i];
+}
+
+enum CouwbatTrafficClass
+CouwbatTxQueue::Classify (Ptr<const Packet> packet) const
+{
+  if (m_config->GetQueueClassifier () == COUWBAT_QUEUE_CLASSIFY_SIZE)
+    {
+      return (m_config->IsQueuePrioEnabled () && packet->GetSize () <= m_config->GetQueuePrioSizeThreshold ())
+             ? COUWBAT_TC_VOICE : COUWBAT_TC_BEST_EFFORT;
+    }
+
+  // LLC/SNAP header (8 bytes, protocol in the last 2) followed by the first 2 bytes of the IP header
+  uint8_t buf[10];
+  const uint32_t len = packet->CopyData (buf, sizeof (buf));
+  if (len < 8)
+    {
+      return COUWBAT_TC_BEST_EFFORT;
+    }
+  const uint16_t protocol = (buf[6] << 8) | buf[7];
 
-  if (Couwbat::mac_queue_prio_enabled && packet->GetSize () <= Couwbat::mac_queue_prio_size_threshold)
+  uint8_t tos;
+  if (protocol == 0x0806)
     {
-      NS_LOG_DEBUG (this << " TxQueue> enqueue prio, size="<<packet->GetSize ());
-      m_priorityQueues.at (dest).push_back (packet);
+      // ARP
+      return COUWBAT_TC_VOICE;
+    }
+  else if (protocol == 0x0800 && len == 10)
+    {
+      tos = buf[9];
+    }
+  else if (protocol == 0x86DD && len == 10)
+    {
+      tos = ((buf[8] & 0x0f) << 4) | (buf[9] >> 4);
     }
   else
     {
-      NS_LOG_DEBUG (this << " TxQueue> enqueue nonprio, size="<<packet->GetSize ());
-      m_queues.at (dest).push_back (packet);
+      return COUWBAT_TC_BEST_EFFORT;
+    }
+
+  const uint8_t dscp = tos >> 2;
+  if (dscp == 8)
+    {
+      // CS1
+      return COUWBAT_TC_BACKGROUND;
+    }
+  switch (dscp >> 3)
+    {
+    case 7:
+    case 6:
+    case 5:
+      return COUWBAT_TC_VOICE;
+    case 4:
+    case 3:
+      return COUWBAT_TC_VIDEO;
+    default:
+      return COUWBAT_TC_BEST_EFFORT;
     }
 }
 
+void
+CouwbatTxQueue::Enqueue (const Mac48Address dest, PacketType packet)
+{
+  DestQueues &entry = FindOrInsert (dest);
+  const enum CouwbatTrafficClass tc = Classify (packet);
+  NS_LOG_DEBUG (this << " TxQueue> enqueue class " << tc << ", size=" << packet->GetSize ());
+
+  ClassQueue &cq = entry.classes[tc];
+  cq.queue.push_back (CouwbatQueueItem (packet, Simulator::Now ()));
+  cq.bytes += packet->GetSize ();
+}
+
 void
 CouwbatTxQueue::Reenqueue (const Mac48Address dest, PacketType packet)
 {
-  // Initialize queue containers if not yet created
-  try
-  {
-    m_queues.at (dest);
-    m_priorityQueues.at (dest);
-  }
-  catch (const std::out_of_range& oor)
-  {
-    m_queues[dest] = PacketQueueType ();
-    m_priorityQueues[dest] = PacketQueueType ();
-  }
+  DestQueues &entry = FindOrInsert (dest);
+  const enum CouwbatTrafficClass tc = Classify (packet);
+  NS_LOG_DEBUG (this << " TxQueue> reenqueue class " << tc << ", size=" << packet->GetSize ());
+
+  ClassQueue &cq = entry.classes[tc];
+  cq.queue.push_front (CouwbatQueueItem (packet, Simulator::Now ()));
+  cq.bytes += packet->GetSize ();
+  ++cq.reenqueueCount;
+}
 
-  if (Couwbat::mac_queue_prio_enabled && packet->GetSize () <= Couwbat::mac_queue_prio_size_threshold)
+uint32_t
+CouwbatTxQueue::SelectClass (DestQueues &entry)
+{
+  uint32_t top = 0;
+  while (top < COUWBAT_TC_COUNT && entry.classes[top].queue.empty ())
     {
-      NS_LOG_DEBUG (this << " TxQueue> reenqueue prio, size="<<packet->GetSize ());
-      m_priorityQueues.at (dest).push_back (packet);
-      ++m_priorityReenqueueCount[dest];
+      ++top;
     }
-  else
+  if (top == COUWBAT_TC_COUNT)
+    {
+      return COUWBAT_TC_COUNT;
+    }
+
+  switch (m_config->GetQueueScheduler ())
     {
-      NS_LOG_DEBUG (this << " TxQueue> reenqueue nonprio, size="<<packet->GetSize ());
-      m_queues.at (dest).push_front (packet);
-      ++m_reenqueueCount[dest];
+    case COUWBAT_QUEUE_SCHED_STRICT:
+      return top;
+
+    case COUWBAT_QUEUE_SCHED_DRR:
+      while (true)
+        {
+          ClassQueue &cq = entry.classes[entry.drrCurrent];
+          if (cq.queue.empty ())
+            {
+              cq.deficit = 0;
+            }
+          else if (cq.queue.front ().packet->GetSize () <= cq.deficit)
+            {
+              return entry.drrCurrent;
+            }
+          // Turn passes to the next class, which gets its quantum for this round
+          entry.drrCurrent = (entry.drrCurrent + 1) % COUWBAT_TC_COUNT;
+          if (!entry.classes[entry.drrCurrent].queue.empty ())
+            {
+              entry.classes[entry.drrCurrent].deficit += std::max<uint32_t> (1, m_config->GetQueueDrrQuantum (entry.drrCurrent));
+            }
+        }
+
+    case COUWBAT_QUEUE_SCHED_RATIO:
+    default:
+      if (top == COUWBAT_TC_VOICE
+          && entry.priorityRatioCounter < m_config->GetQueuePrioRatioCount () * m_config->GetQueuePrioRatio ())
+        {
+          return COUWBAT_TC_VOICE;
+        }
+      for (uint32_t c = COUWBAT_TC_VOICE + 1; c < COUWBAT_TC_COUNT; ++c)
+        {
+          if (!entry.classes[c].queue.empty ())
+            {
+              return c;
+            }
+        }
+      return COUWBAT_TC_VOICE;
     }
 }
 
+bool
+CouwbatTxQueue::CodelShouldDrop (CodelState &state, Time sojourn, uint32_t queueBytes, Time now) const
+{
+  const Time target = MicroSeconds (m_config->GetCodelTarget ());
+  const Time interval = MicroSeconds (m_config->GetCodelInterval ());
+
+  // RFC 8289 ok_to_drop: sojourn time above target for at least one interval
+  bool okToDrop = false;
+  if (sojourn < target || queueBytes <= m_config->GetCodelMinBytes ())
+    {
+      state.firstAboveTime = Time (0);
+    }
+  else if (state.firstAboveTime.IsZero ())
+    {
+      state.firstAboveTime = now + interval;
+    }
+  else if (now >= state.firstAboveTime)
+    {
+      okToDrop = true;
+    }
+
+  if (state.dropping)
+    {
+      if (!okToDrop)
+        {
+          state.dropping = false;
+          return false;
+        }
+      if (now >= state.dropNext)
+        {
+          ++state.count;
+          state.dropNext = state.dropNext + Seconds (interval.GetSeconds () / std::sqrt ((double) state.count));
+          return true;
+        }
+      return false;
+    }
+
+  if (okToDrop)
+    {
+      // Resume with a higher drop rate if the dropping state was left only recently
+      const uint32_t delta = state.count - state.lastCount;
+      state.dropping = true;
+      state.count = (delta > 1 && now - state.dropNext < 16 * interval) ? delta : 1;
+      state.lastCount = state.count;
+      state.dropNext = now + Seconds (interval.GetSeconds () / std::sqrt ((double) state.count));
+      return true;
+    }
+
+  return false;
+}
+
+CouwbatQueueItem
+CouwbatTxQueue::RemoveHead (ClassQueue &cq)
+{
+  CouwbatQueueItem item = cq.queue.front ();
+  cq.queue.pop_front ();
+  cq.bytes -= item.packet->GetSize ();
+  return item;
+}
+
+uint32_t
+CouwbatTxQueue::SelectClassAqm (const Mac48Address &dest, DestQueues &entry)
+{
+  uint32_t tc = SelectClass (entry);
+  if (!m_config->IsCodelEnabled ())
+    {
+      return tc;
+    }
+
+  const Time now = Simulator::Now ();
+  while (tc < COUWBAT_TC_COUNT)
+    {
+      ClassQueue &cq = entry.classes[tc];
+      // Retransmissions at the front are never dropped
+      if (cq.reenqueueCount > 0)
+        {
+          break;
+        }
+      const Time sojourn = now - cq.queue.front ().tstamp;
+      if (!CodelShouldDrop (cq.codel, sojourn, cq.bytes, now))
+        {
+          break;
+        }
+
+      CouwbatQueueItem dropped = RemoveHead (cq);
+      NS_LOG_DEBUG (this << " TxQueue> CoDel drop, dest=" << dest << ", class=" << tc << ", size=" << dropped.packet->GetSize ()
+                    << ", sojourn=" << sojourn.GetMicroSeconds () << "us");
+      if (!m_dropCallback.IsNull ())
+        {
+          m_dropCallback (dropped.packet, dest, sojourn);
+        }
+      tc = SelectClass (entry);
+    }
+
+  return tc;
+}
+
 PacketType
 CouwbatTxQueue::Peek (const Mac48Address dest)
 {
-  try
-  {
-    if (Couwbat::mac_queue_prio_enabled
-        && (!m_priorityQueues.at (dest).empty ())
-        && (m_priorityRatioCounter < Couwbat::mac_queue_prio_ratio_count * Couwbat::mac_queue_prio_ratio))
-      {
-        m_flagLastPeekPriority = true;
-        NS_LOG_DEBUG (this << " TxQueue> peek prio standard" << ", m_priorityRatioCounter=" << m_priorityRatioCounter << ", addr=" << m_priorityQueues.at (dest).front ());
-        return m_priorityQueues.at (dest).front ();
-      }
-    else
-      {
-        if (!m_queues.at (dest).empty ())
-          {
-            m_flagLastPeekPriority = false;
-            NS_LOG_DEBUG (this << " TxQueue> peek nonprio" << ", m_priorityRatioCounter=" << m_priorityRatioCounter << ", addr=" << m_queues.at (dest).front ());
-            return m_queues.at (dest).front ();
-          }
-
-        if (!m_priorityQueues.at (dest).empty ())
-          {
-            m_flagLastPeekPriority = true;
-            NS_LOG_DEBUG (this << " TxQueue> peek prio, nonprio empty" << ", m_priorityRatioCounter=" << m_priorityRatioCounter << ", addr=" << m_priorityQueues.at (dest).front ());
-            return m_priorityQueues.at (dest).front ();
-          }
-      }
-  }
-  catch (const std::out_of_range& oor)
-  {
-  }
-  return PacketType ();
+  DestQueues *entry = Find (dest);
+  if (!entry)
+    {
+      return PacketType ();
+    }
+  const uint32_t tc = SelectClassAqm (dest, *entry);
+  if (tc == COUWBAT_TC_COUNT)
+    {
+      return PacketType ();
+    }
+  NS_LOG_DEBUG (this << " TxQueue> peek class " << tc << ", priorityRatioCounter=" << entry->priorityRatioCounter
+                << ", addr=" << entry->classes[tc].queue.front ().packet);
+  return entry->classes[tc].queue.front ().packet;
 }
 
 PacketType
 CouwbatTxQueue::Pop (const Mac48Address dest, bool &retransmission)
 {
-  try
-  {
-    PacketType ret = Peek (dest);
-    NS_LOG_DEBUG (this << " TxQueue> pop" << ", m_priorityRatioCounter=" << m_priorityRatioCounter << ", addr=" << ret
-        << ", m_priorityQueues_size=" << m_priorityQueues[dest].size () << ", m_queues_size=" << m_queues[dest].size ());
-    if (ret)
-      {
-        m_priorityRatioCounter = (m_priorityRatioCounter + 1) %  Couwbat::mac_queue_prio_ratio_count;
-        if (m_flagLastPeekPriority)
-          {
-            m_priorityQueues.at (dest).pop_front ();
-          }
-        else
-          {
-            m_queues.at (dest).pop_front ();
-          }
-      }
-
-    if (!m_flagLastPeekPriority && m_reenqueueCount[dest] > 0)
-      {
-        retransmission = true;
-        --m_reenqueueCount[dest];
-      }
-
-    if (m_flagLastPeekPriority && m_priorityReenqueueCount[dest] > 0)
-      {
-        retransmission = true;
-        --m_reenqueueCount[dest];
-      }
-
-    return ret;
-  }
-  catch (const std::out_of_range& oor)
-  {
-  }
-  return PacketType ();
+  DestQueues *entry = Find (dest);
+  if (!entry)
+    {
+      return PacketType ();
+    }
+
+  const uint32_t tc = SelectClassAqm (dest, *entry);
+  if (tc == COUWBAT_TC_COUNT)
+    {
+      return PacketType ();
+    }
+
+  ClassQueue &cq = entry->classes[tc];
+  CouwbatQueueItem item = RemoveHead (cq);
+  NS_LOG_DEBUG (this << " TxQueue> pop class " << tc << ", priorityRatioCounter=" << entry->priorityRatioCounter
+                << ", addr=" << item.packet << ", class_size=" << cq.queue.size ());
+
+  entry->priorityRatioCounter = (entry->priorityRatioCounter + 1) % m_config->GetQueuePrioRatioCount ();
+  if (m_config->GetQueueScheduler () == COUWBAT_QUEUE_SCHED_DRR)
+    {
+      cq.deficit = cq.queue.empty () ? 0 : cq.deficit - item.packet->GetSize ();
+    }
+
+  if (cq.reenqueueCount > 0)
+    {
+      retransmission = true;
+      --cq.reenqueueCount;
+    }
+  else if (!m_dequeueCallback.IsNull ())
+    {
+      m_dequeueCallback (dest, Simulator::Now () - item.tstamp);
+    }
+
+  return item.packet;
 }
 
 void
 CouwbatTxQueue::Clear (const Mac48Address dest)
 {
-  try
-  {
-    m_reenqueueCount[dest] = 0;
-    m_priorityReenqueueCount[dest] = 0;
-    m_queues.at (dest).clear ();
-    m_priorityQueues.at (dest).clear ();
-  }
-  catch (const std::out_of_range& oor)
-  {
-  }
+  DestQueues *entry = Find (dest);
+  if (entry)
+    {
+      for (uint32_t c = 0; c < COUWBAT_TC_COUNT; ++c)
+        {
+          entry->classes[c] = ClassQueue ();
+        }
+      entry->priorityRatioCounter = 0;
+      entry->drrCurrent = 0;
+    }
 }
 
 void
 CouwbatTxQueue::ClearAll ()
 {
-  m_queues.clear ();
-  m_priorityQueues.clear ();
-  m_reenqueueCount.clear ();
-  m_priorityReenqueueCount.clear ();
+  std::vector<DestQueues> (16).swap (m_table);
+  m_tableUsed = 0;
 }
 
 int
 CouwbatTxQueue::GetQueueSize (const Mac48Address dest)
 {
-  try
-  {
-    m_queues.at (dest);
-    m_priorityQueues.at (dest);
-  }
-  catch (const std::out_of_range& oor)
-  {
-    return 0;
-  }
-  return m_queues.at (dest).size () + m_priorityQueues.at (dest).size ();
+  DestQueues *entry = Find (dest);
+  if (!entry)
+    {
+      return 0;
+    }
+  int size = 0;
+  for (uint32_t c = 0; c < COUWBAT_TC_COUNT; ++c)
+    {
+      size += entry->classes[c].queue.size ();
+    }
+  return size;
+}
+
+uint32_t
+CouwbatTxQueue::GetQueueBytes (const Mac48Address dest)
+{
+  DestQueues *entry = Find (dest);
+  if (!entry)
+    {
+      return 0;
+    }
+  uint32_t bytes = 0;
+  for (uint32_t c = 0; c < COUWBAT_TC_COUNT; ++c)
+    {
+      bytes += entry->classes[c].bytes;
+    }
+  return bytes;
+}
+
+enum CouwbatTrafficClass
+CouwbatTxQueue::GetTopClass (const Mac48Address dest)
+{
+  DestQueues *entry = Find (dest);
+  uint32_t c = 0;
+  while (entry && c < COUWBAT_TC_COUNT && entry->classes[c].queue.empty ())
+    {
+      ++c;
+    }
+  return entry ? (enum CouwbatTrafficClass) c : COUWBAT_TC_COUNT;
+}
+
+void
+CouwbatTxQueue::SetDequeueCallback (Callback<void, Mac48Address, Time> cb)
+{
+  m_dequeueCallback = cb;
+}
+
+void
+CouwbatTxQueue::SetDropCallback (Callback<void, Ptr<const Packet>, Mac48Address, Time> cb)
+{
+  m_dropCallback = cb;
 }
 
 }
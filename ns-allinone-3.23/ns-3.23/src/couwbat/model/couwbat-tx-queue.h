@@ -2,32 +2,67 @@
 #define SRC_COUWBAT_MODEL_COUWBAT_TX_QUEUE_H_
 
 #include "ns3/network-module.h"
+#include "couwbat.h"
+#include "couwbat-config.h"
 #include <deque>
-#include <map>
+#include <vector>
 
 namespace ns3
 {
 
 typedef Ptr<Packet> PacketType;
-typedef std::deque<PacketType> PacketQueueType;
+
+/**
+ * A queued packet together with the time it was put into the queue
+ */
+struct CouwbatQueueItem
+{
+  CouwbatQueueItem (PacketType p, Time t) : packet (p), tstamp (t) {}
+  PacketType packet; //!< The queued packet
+  Time tstamp; //!< Enqueue time, used to calculate the sojourn time
+};
+
+typedef std::deque<CouwbatQueueItem> PacketQueueType;
 
 /**
  * \ingroup couwbat
- * 
+ *
  * \brief A simple transmission queue for CR-BS and CR-STA.
- * 
+ *
  * Contains separate queues for every destination MAC address.
- * Furthermore, it has two queues per destination MAC: normal and high priority.
- * Priorities are assigned according to packet size, whereby smaller packets are placed
- * into the high priority queue and mostly sent before larger packets. This is done
- * to prevent TCP connections from choking by prioritizing smaller service packets (e.g. SYN/ACK pairs)
- * over larger data packets.
- * 
- * The parameters and thresholds for prioritization are configured in couwbat.h/.cc
+ * Furthermore, every destination has one queue per traffic class (CouwbatTrafficClass).
+ * Packets are classified according to the QueueClassifier of CouwbatConfig, either by size,
+ * whereby smaller packets are placed into the voice class and mostly sent before larger packets
+ * to prevent TCP connections from choking by prioritizing smaller service packets (e.g. SYN/ACK pairs),
+ * or by the DSCP of IP packets and the LLC/SNAP protocol of all others.
+ * The QueueScheduler of CouwbatConfig selects the class served next; the scheduler state is kept
+ * per destination, so the destinations do not influence each other.
+ *
+ * The parameters and thresholds for prioritization are taken from the CouwbatConfig set with
+ * SetConfig, by default a snapshot of the statics in couwbat.h/.cc
+ *
+ * The queues of a destination are kept together in one entry of an open addressing
+ * hash table keyed on the 48 bit MAC address, so every operation needs a single lookup.
+ *
+ * Every packet is timestamped at Enqueue and the queue keeps track of the queued bytes
+ * per destination. If CodelEnabled is set in CouwbatConfig, each traffic class queue of a
+ * destination runs its own CoDel state machine (RFC 8289). Since the queues are already
+ * separated per destination and traffic class, this behaves like FQ-CoDel with the
+ * destination as flow key. The drop decision is taken for the head packet in Peek and Pop,
+ * i.e. when CouwbatPacketHelper::CreateBurst dequeues packets for a burst, so Pop
+ * always returns the packet returned by the preceding Peek. Retransmissions put
+ * back with Reenqueue are never dropped.
  */
 class CouwbatTxQueue
 {
 public:
+  CouwbatTxQueue ();
+
+  /**
+   * Set the configuration the classifier, scheduler and CoDel parameters are taken from
+   */
+  void SetConfig (Ptr<CouwbatConfig> config);
+
   // TODO handle broadcast addr
   void Enqueue (const Mac48Address dest, PacketType packet);
   void Reenqueue (const Mac48Address dest, PacketType packet);
@@ -36,14 +71,111 @@ public:
   void Clear (const Mac48Address dest);
   void ClearAll ();
   int GetQueueSize (const Mac48Address dest);
+  uint32_t GetQueueBytes (const Mac48Address dest);
+
+  /**
+   * \return the highest priority traffic class with packets queued for dest,
+   *         COUWBAT_TC_COUNT if nothing is queued
+   */
+  enum CouwbatTrafficClass GetTopClass (const Mac48Address dest);
+
+  /**
+   * Assign a packet to a traffic class according to the QueueClassifier of CouwbatConfig.
+   * \param packet packet starting with the LLC/SNAP header
+   */
+  enum CouwbatTrafficClass Classify (Ptr<const Packet> packet) const;
+
+  /**
+   * Set the callback invoked with the sojourn time of every packet that leaves
+   * the queue with Pop, retransmissions excluded.
+   */
+  void SetDequeueCallback (Callback<void, Mac48Address, Time> cb);
+
+  /**
+   * Set the callback invoked for every packet dropped by CoDel together with its sojourn time.
+   */
+  void SetDropCallback (Callback<void, Ptr<const Packet>, Mac48Address, Time> cb);
 
 private:
-  std::map<const Mac48Address, PacketQueueType> m_queues;
-  std::map<const Mac48Address, PacketQueueType> m_priorityQueues;
-  std::map<const Mac48Address, uint32_t> m_reenqueueCount;
-  std::map<const Mac48Address, uint32_t> m_priorityReenqueueCount;
-  int m_priorityRatioCounter;
-  bool m_flagLastPeekPriority;
+  /**
+   * CoDel state of one queue
+   */
+  struct CodelState
+  {
+    CodelState () : dropping (false), count (0), lastCount (0) {}
+    bool dropping; //!< True if in dropping state
+    uint32_t count; //!< Number of drops since entering the dropping state
+    uint32_t lastCount; //!< count when the dropping state was last left
+    Time firstAboveTime; //!< Time at which the sojourn time will have been above target for an interval, zero if below target
+    Time dropNext; //!< Time of the next drop in dropping state
+  };
+
+  /**
+   * Queue and counters of one traffic class of a destination
+   */
+  struct ClassQueue
+  {
+    ClassQueue () : reenqueueCount (0), bytes (0), deficit (0) {}
+    PacketQueueType queue; //!< Queued packets
+    uint32_t reenqueueCount; //!< Number of retransmissions at the front of queue
+    uint32_t bytes; //!< Bytes in queue
+    uint32_t deficit; //!< DRR deficit counter in bytes
+    CodelState codel; //!< CoDel state of queue
+  };
+
+  /**
+   * All queues and counters of one destination
+   */
+  struct DestQueues
+  {
+    DestQueues () : used (false), key (0), priorityRatioCounter (0), drrCurrent (0) {}
+    bool used; //!< True if this table slot holds a destination
+    uint64_t key; //!< Destination MAC address as integer
+    ClassQueue classes[COUWBAT_TC_COUNT]; //!< One queue per traffic class
+    int priorityRatioCounter; //!< State of COUWBAT_QUEUE_SCHED_RATIO
+    uint32_t drrCurrent; //!< Class holding the DRR turn
+  };
+
+  /**
+   * \return the entry of dest, 0 if there is none
+   */
+  DestQueues *Find (const Mac48Address &dest);
+
+  /**
+   * \return the entry of dest, created if there is none
+   */
+  DestQueues &FindOrInsert (const Mac48Address &dest);
+
+  /**
+   * Select the traffic class to send next from according to the QueueScheduler of CouwbatConfig.
+   * Repeated calls without Pop in between return the same class.
+   * \param entry queues of the destination
+   * \return the class, COUWBAT_TC_COUNT if all queues are empty
+   */
+  uint32_t SelectClass (DestQueues &entry);
+
+  /**
+   * Like SelectClass, but first drops head packets according to CoDel if enabled.
+   */
+  uint32_t SelectClassAqm (const Mac48Address &dest, DestQueues &entry);
+
+  /**
+   * Run the CoDel state machine for the head packet of one queue.
+   * \return true if the head packet must be dropped
+   */
+  bool CodelShouldDrop (CodelState &state, Time sojourn, uint32_t queueBytes, Time now) const;
+
+  /**
+   * Remove the head packet of one class queue and update the byte count.
+   * \return the removed item
+   */
+  static CouwbatQueueItem RemoveHead (ClassQueue &cq);
+
+  std::vector<DestQueues> m_table; //!< Open addressing hash table with linear probing, size is a power of 2
+  uint32_t m_tableUsed; //!< Number of used slots in m_table
+  Callback<void, Mac48Address, Time> m_dequeueCallback; //!< Called with the sojourn time of dequeued packets
+  Callback<void, Ptr<const Packet>, Mac48Address, Time> m_dropCallback; //!< Called for packets dropped by CoDel
+  Ptr<CouwbatConfig> m_config; //!< Queue parameters
 };
 
 }
@@ -6,6 +6,7 @@
 #include "ns3/log.h"
 #include "ns3/header.h"
 #include "couwbat-ul-burst-header.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -98,4 +99,13 @@ CouwbatUlBurstHeader::Deserialize (Buffer::Iterator start)
   return GetSerializedSize ();
 }
 
+uint32_t
+CouwbatUlBurstHeader::Deserialize (const uint8_t *start)
+{
+  m_ack = start[0];
+  std::copy (start + 1, start + 1 + Couwbat::MAX_SUBCHANS, m_cqi);
+
+  return GetSerializedSize ();
+}
+
 } // namespace ns3
@@ -59,14 +59,30 @@ Mac48Address Couwbat::m_sinrPerSubchannelCallbackMacFilterAddress = Mac48Address
 
 bool Couwbat::mac_queue_limit_enabled = false;
 int Couwbat::mac_queue_limit_size = 2000;
+bool Couwbat::mac_queue_limit_bytes_enabled = false;
+uint32_t Couwbat::mac_queue_limit_bytes = 1000000;
+
+bool Couwbat::mac_codel_enabled = false;
+uint32_t Couwbat::mac_codel_target_us = 20000;
+uint32_t Couwbat::mac_codel_interval_us = 100000;
+uint32_t Couwbat::mac_codel_min_bytes = 1500;
 
 bool Couwbat::mac_queue_prio_enabled = true;
 double Couwbat::mac_queue_prio_ratio = 0.8;
 int Couwbat::mac_queue_prio_ratio_count = 10;
 unsigned int Couwbat::mac_queue_prio_size_threshold = 100;
 
+enum CouwbatQueueClassifier Couwbat::mac_queue_classifier = COUWBAT_QUEUE_CLASSIFY_SIZE;
+enum CouwbatQueueScheduler Couwbat::mac_queue_scheduler = COUWBAT_QUEUE_SCHED_RATIO;
+uint32_t Couwbat::mac_queue_drr_quantum[COUWBAT_TC_COUNT] = { 4 * MAX_MTU, 3 * MAX_MTU, 2 * MAX_MTU, MAX_MTU };
+bool Couwbat::mac_queue_class_dl_order = false;
+
 unsigned int Couwbat::mac_dlul_slot_limit_size = 500;
 
+bool Couwbat::mac_arq_enabled = false;
+
+bool Couwbat::mac_compact_map_enabled = false;
+
 bool Couwbat::mac_avoid_low_cqi_wb_subchannels = true;
 double Couwbat::mac_against_threshold_avoid_low_cqi_wb_subchannels = 0.4;
 uint8_t Couwbat::mac_below_value_avoid_low_cqi_wb_subchannels = 3;
@@ -7,8 +7,69 @@
 #include "ns3/mac48-address.h"
 #include "couwbat-mode.h"
 
+/**
+ * \ingroup couwbat
+ *
+ * If nonzero, code that only prepares log output on hot paths (formatting CQI arrays,
+ * subchannel bitmaps, packet dumps) is compiled in and runs when the log level is enabled.
+ * Defaults to 1 if ns-3 logging is compiled in (NS3_LOG_ENABLE) and to 0 otherwise,
+ * so optimized builds contain none of it. Define as 0 to remove it from debug builds as well.
+ */
+#ifndef COUWBAT_HOT_LOG
+#ifdef NS3_LOG_ENABLE
+#define COUWBAT_HOT_LOG 1
+#else
+#define COUWBAT_HOT_LOG 0
+#endif
+#endif
+
+/**
+ * \ingroup couwbat
+ *
+ * True if COUWBAT_HOT_LOG is set and level is enabled for the log component of the
+ * current file. Guards code whose only purpose is to prepare log output.
+ */
+#define COUWBAT_LOG_ENABLED(level) (COUWBAT_HOT_LOG && g_log.IsEnabled (level))
+
 namespace ns3 {
 
+/**
+ * \ingroup couwbat
+ *
+ * Traffic classes of CouwbatTxQueue, ordered from highest to lowest priority.
+ */
+enum CouwbatTrafficClass
+{
+  COUWBAT_TC_VOICE = 0, //!< Network control and voice (DSCP CS5-CS7, EF, VOICE-ADMIT), ARP
+  COUWBAT_TC_VIDEO, //!< Video and signaling (DSCP CS3, CS4, AF3x, AF4x)
+  COUWBAT_TC_BEST_EFFORT, //!< Default class
+  COUWBAT_TC_BACKGROUND, //!< Bulk traffic (DSCP CS1)
+  COUWBAT_TC_COUNT //!< Number of traffic classes
+};
+
+/**
+ * \ingroup couwbat
+ *
+ * Packet classification methods of CouwbatTxQueue
+ */
+enum CouwbatQueueClassifier
+{
+  COUWBAT_QUEUE_CLASSIFY_SIZE, //!< Packets up to mac_queue_prio_size_threshold bytes are COUWBAT_TC_VOICE, all others COUWBAT_TC_BEST_EFFORT
+  COUWBAT_QUEUE_CLASSIFY_DSCP //!< By the DSCP of IPv4/IPv6 packets and the LLC/SNAP protocol of all others
+};
+
+/**
+ * \ingroup couwbat
+ *
+ * Schedulers selecting the traffic class served next for a destination in CouwbatTxQueue
+ */
+enum CouwbatQueueScheduler
+{
+  COUWBAT_QUEUE_SCHED_RATIO, //!< COUWBAT_TC_VOICE gets mac_queue_prio_ratio of the packets, the other classes share the rest in priority order
+  COUWBAT_QUEUE_SCHED_STRICT, //!< Always serve the highest nonempty class
+  COUWBAT_QUEUE_SCHED_DRR //!< Deficit round robin with mac_queue_drr_quantum bytes per class and round
+};
+
 /**
  * \brief Manages configuration parameters for the whole COUWBAT module.
  * \ingroup couwbat
@@ -128,8 +189,12 @@ public:
 
   static const uint32_t MAX_SUBCHANS = 64; //!< Number of subchannels used in Couwbat
 
+  static const uint16_t MAX_MTU = 2304; //!< TODO rename this and find useful values; MTU value is not used at all and packets are forwarded as given, i.e. no splitting is implemented.
+
   static const uint32_t STA_PSS_TIMEOUT_SF = 2; //!< Timeout after this many superframes without received PSS in CR-STA
 
+  static const uint32_t ARQ_RETRANSMISSION_TIMEOUT_SF = 4; //!< Retransmit a burst if it has not been ACKed after this many superframes
+
 private:
 
   ////
@@ -176,6 +241,18 @@ public:
    */
   static bool mac_queue_limit_enabled; //!< If true, enable the limit for CouwbatTxQueue size to a number of packets. Does not play well with ns3 applications. 
   static int mac_queue_limit_size; //!< Limit CouwbatTxQueue size to a number of packets. Only valid if mac_queue_limit_enabled is true.
+  static bool mac_queue_limit_bytes_enabled; //!< If true, limit the bytes queued in CouwbatTxQueue per destination
+  static uint32_t mac_queue_limit_bytes; //!< Limit of queued bytes per destination. Only valid if mac_queue_limit_bytes_enabled is true.
+
+  /**
+   * CoDel active queue management in CouwbatTxQueue, separate state per destination and priority class
+   *
+   * The target should cover the usual wait for the next MAP, i.e. at least one superframe.
+   */
+  static bool mac_codel_enabled; //!< Enable or disable CoDel
+  static uint32_t mac_codel_target_us; //!< Acceptable standing queue delay in microseconds
+  static uint32_t mac_codel_interval_us; //!< Sliding window in microseconds in which the delay has to fall below target
+  static uint32_t mac_codel_min_bytes; //!< Never drop if no more than this number of bytes is queued
 
   /**
    * CouwbatTxQueue priority for smaller packets
@@ -188,8 +265,20 @@ public:
   static int mac_queue_prio_ratio_count; //!< The number of packets to base the percentage/ratio on.
   static unsigned int mac_queue_prio_size_threshold; //!< If packet size in bytes is lesser or equal to this number, the packet is put in priority queue, else nonpriority queue
 
+  /**
+   * CouwbatTxQueue traffic classes, see CouwbatTrafficClass
+   */
+  static enum CouwbatQueueClassifier mac_queue_classifier; //!< How packets are assigned to traffic classes
+  static enum CouwbatQueueScheduler mac_queue_scheduler; //!< How the traffic classes of a destination are served
+  static uint32_t mac_queue_drr_quantum[COUWBAT_TC_COUNT]; //!< Bytes per round and traffic class for COUWBAT_QUEUE_SCHED_DRR, at least MAX_MTU
+  static bool mac_queue_class_dl_order; //!< CR-BS places DL slots of STAs with higher priority traffic queued first in the superframe (default off)
+
   static unsigned int mac_dlul_slot_limit_size; //!< Max number of DL/UL slots per superframe (set artificial limit)
 
+  static bool mac_arq_enabled; //!< Enable selective-repeat ARQ, retransmission of unACKed bursts via CouwbatTxHistoryBuffer (default off)
+
+  static bool mac_compact_map_enabled; //!< Encode MAPs with short STA IDs and run-length merged grants (COUWBAT_FC_CONTROL_MAP_COMPACT)
+
   /**
    * Avoid unoccupied but low CQI wideband subchannels according to STA feedback
    * during CR-BS wideband channel selection on a superframe basis
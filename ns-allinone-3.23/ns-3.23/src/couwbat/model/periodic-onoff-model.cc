@@ -71,10 +71,10 @@ PeriodicOnOffModel::TurnOn (void)
 
   // schedule the off
   Time relativeFinalOff = GetFinalOff () - Simulator::Now ();
-  if ( m_runIndefinitely || (GetFirstOn () < relativeFinalOff) ) 
+  if ( m_runIndefinitely || (m_pOn < relativeFinalOff) )
     { // turn off after m_pOn time
-      NS_LOG_INFO ("keeping PU on for " << GetFirstOn ());
-      Simulator::Schedule (m_pOff, &PeriodicOnOffModel::TurnOff, this);
+      NS_LOG_INFO ("keeping PU on for " << m_pOn);
+      Simulator::Schedule (m_pOn, &PeriodicOnOffModel::TurnOff, this);
     }
   else
     { // schedule the final off (by conversion to relative time)
@@ -91,10 +91,10 @@ PeriodicOnOffModel::TurnOff (void)
 
   // schedule the next on
   Time relativeFinalOff = GetFinalOff () - Simulator::Now ();
-  if ( m_runIndefinitely || (GetFinalOff () < relativeFinalOff) ) 
+  if ( m_runIndefinitely || (m_pOff < relativeFinalOff) )
     { // turn on after m_pOff time
       NS_LOG_INFO ("keeping PU off for " << m_pOff);
-      Simulator::Schedule (m_pOn, &PeriodicOnOffModel::TurnOn, this);
+      Simulator::Schedule (m_pOff, &PeriodicOnOffModel::TurnOn, this);
     }
   else
     {
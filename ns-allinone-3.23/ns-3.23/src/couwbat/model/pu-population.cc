@@ -0,0 +1,283 @@
+#include "pu-population.h"
+#include "spectrum-map.h"
+#include "spectrum-db.h"
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include <algorithm>
+#include <functional>
+
+NS_LOG_COMPONENT_DEFINE ("PuPopulation");
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED (PuPopulation);
+
+TypeId
+PuPopulation::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PuPopulation")
+    .SetParent<Object> ()
+    .AddConstructor<PuPopulation> ()
+    .SetGroupName ("Couwbat")
+    .AddAttribute ("Model",
+                   "On/off model of all primary users of the population.",
+                   EnumValue (PuPopulation::MODEL_RANDOM),
+                   MakeEnumAccessor (&PuPopulation::m_model),
+                   MakeEnumChecker (PuPopulation::MODEL_ONCE, "Once",
+                                    PuPopulation::MODEL_PERIODIC, "Periodic",
+                                    PuPopulation::MODEL_RANDOM, "Random"))
+    .AddAttribute ("FirstOn",
+                   "Time when to first turn on the primary users.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&PuPopulation::m_firstOn),
+                   MakeTimeChecker ())
+    .AddAttribute ("FinalOff",
+                   "Time when to finally turn off the primary users. If set to 0 they run indefinitely.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&PuPopulation::m_finalOff),
+                   MakeTimeChecker ())
+    .AddAttribute ("PeriodOn",
+                   "Periodic duration the primary users stay turned on (Periodic model).",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PuPopulation::m_periodOn),
+                   MakeTimeChecker ())
+    .AddAttribute ("PeriodOff",
+                   "Periodic duration the primary users stay turned off (Periodic model).",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PuPopulation::m_periodOff),
+                   MakeTimeChecker ())
+    .AddAttribute ("RandomVariable",
+                   "The random variable that returns the time (in seconds) for how long "
+                   "a primary user stays on/off in each period (Random model).",
+                   StringValue ("ns3::UniformRandomVariable"),
+                   MakePointerAccessor (&PuPopulation::m_randVar),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("BatchSize",
+                   "Number of values drawn from the random variable at once.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&PuPopulation::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("Switch",
+                     "A primary user was switched on or off",
+                     MakeTraceSourceAccessor (&PuPopulation::m_switchTrace),
+                     "ns3::PuPopulation::SwitchCallback")
+  ;
+  return tid;
+}
+
+PuPopulation::PuPopulation ()
+  : m_nextDraw (0),
+    m_nSwitches (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_map = CreateObject<SpectrumMap> ();
+  m_zero.assign (m_map->GetNWords (), 0);
+}
+
+PuPopulation::~PuPopulation ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PuPopulation::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_event);
+  m_specDb = 0;
+  m_randVar = 0;
+  m_map = 0;
+  Object::DoDispose ();
+}
+
+uint32_t
+PuPopulation::AddPrimaryUser (uint32_t start_subcarrier, uint32_t n_subcarriers)
+{
+  NS_LOG_FUNCTION (this << start_subcarrier << n_subcarriers);
+  NS_ABORT_MSG_IF (start_subcarrier > m_map->GetSize () || n_subcarriers > m_map->GetSize () - start_subcarrier,
+                   "Subcarriers " << start_subcarrier << "+" << n_subcarriers << " exceed the map size " << m_map->GetSize ());
+  m_start.push_back (start_subcarrier);
+  m_length.push_back (n_subcarriers);
+  m_on.push_back (false);
+  return m_start.size () - 1;
+}
+
+uint32_t
+PuPopulation::GetN (void) const
+{
+  return m_start.size ();
+}
+
+bool
+PuPopulation::IsOn (uint32_t pu) const
+{
+  NS_ASSERT (pu < m_on.size ());
+  return m_on[pu];
+}
+
+uint64_t
+PuPopulation::GetNSwitches (void) const
+{
+  return m_nSwitches;
+}
+
+void
+PuPopulation::SetSpectrumDb (Ptr<SpectrumDb> db)
+{
+  NS_LOG_FUNCTION (this << db);
+  m_specDb = db;
+}
+
+int64_t
+PuPopulation::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_randVar->SetStream (stream);
+  // Values drawn in advance came from the previous stream
+  m_draws.clear ();
+  m_nextDraw = 0;
+  return 1;
+}
+
+void
+PuPopulation::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_specDb)
+    {
+      NS_LOG_WARN ("PuPopulation::Start(): No spectrum database, cannot start");
+      return;
+    }
+  NS_ABORT_MSG_IF (m_model == MODEL_PERIODIC && (m_periodOn + m_periodOff) <= Time (),
+                   "PeriodOn + PeriodOff must be positive");
+  if (m_finalOff <= Seconds (0))
+    {
+      NS_LOG_INFO ("FinalOff <= 0, running indefinitely");
+    }
+
+  Simulator::Cancel (m_event);
+  m_queue.clear ();
+  // A restart begins with all primary users off, as after AddPrimaryUser
+  for (uint32_t pu = 0; pu < GetN (); ++pu)
+    {
+      if (m_on[pu])
+        {
+          m_map->SetWords (&m_zero[0]);
+          m_map->SetSpectrum (m_start[pu], m_length[pu]);
+          ++m_nSwitches;
+          m_on[pu] = false;
+          m_specDb->LeaveSpectrum (m_map);
+          m_switchTrace (pu, false);
+        }
+    }
+  m_queue.reserve (GetN ());
+  for (uint32_t pu = 0; pu < GetN (); ++pu)
+    {
+      if (m_model == MODEL_RANDOM)
+        {
+          // First on with random delay
+          Push (pu, Simulator::Now () + m_firstOn + Draw ());
+        }
+      else
+        {
+          Push (pu, Simulator::Now () + m_firstOn);
+        }
+    }
+  if (!m_queue.empty ())
+    {
+      m_event = Simulator::Schedule (TimeStep (m_queue.front ().first) - Simulator::Now (),
+                                     &PuPopulation::Switch, this);
+    }
+  NS_LOG_INFO ("Started " << GetN () << " primary users");
+}
+
+void
+PuPopulation::Switch (void)
+{
+  NS_LOG_FUNCTION (this);
+  const int64_t now = Simulator::Now ().GetTimeStep ();
+  while (!m_queue.empty () && m_queue.front ().first <= now)
+    {
+      std::pop_heap (m_queue.begin (), m_queue.end (), std::greater<std::pair<int64_t, uint32_t> > ());
+      const uint32_t pu = m_queue.back ().second;
+      m_queue.pop_back ();
+      Toggle (pu);
+    }
+  if (!m_queue.empty ())
+    {
+      m_event = Simulator::Schedule (TimeStep (m_queue.front ().first - now), &PuPopulation::Switch, this);
+    }
+}
+
+void
+PuPopulation::Toggle (uint32_t pu)
+{
+  const Time now = Simulator::Now ();
+  const bool indefinitely = m_finalOff <= Seconds (0);
+  m_map->SetWords (&m_zero[0]);
+  m_map->SetSpectrum (m_start[pu], m_length[pu]);
+  ++m_nSwitches;
+
+  if (!m_on[pu])
+    {
+      NS_LOG_LOGIC ("PU " << pu << " occupying subcarriers " << m_start[pu] << "+" << m_length[pu]);
+      m_on[pu] = true;
+      m_specDb->OccupySpectrum (m_map);
+      m_switchTrace (pu, true);
+
+      // Schedule the off, at the latest at the final off
+      if (m_model == MODEL_ONCE)
+        {
+          if (!indefinitely)
+            {
+              Push (pu, std::max (m_finalOff, now));
+            }
+          return;
+        }
+      const Time d = (m_model == MODEL_PERIODIC) ? m_periodOn : Draw ();
+      Push (pu, (indefinitely || d < m_finalOff - now) ? now + d : m_finalOff);
+    }
+  else
+    {
+      NS_LOG_LOGIC ("PU " << pu << " leaving subcarriers " << m_start[pu] << "+" << m_length[pu]);
+      m_on[pu] = false;
+      m_specDb->LeaveSpectrum (m_map);
+      m_switchTrace (pu, false);
+
+      // Schedule the next on, unless the final off is reached
+      if (m_model == MODEL_ONCE)
+        {
+          return;
+        }
+      const Time d = (m_model == MODEL_PERIODIC) ? m_periodOff : Draw ();
+      if (indefinitely || d < m_finalOff - now)
+        {
+          Push (pu, now + d);
+        }
+    }
+}
+
+void
+PuPopulation::Push (uint32_t pu, Time at)
+{
+  m_queue.push_back (std::make_pair (at.GetTimeStep (), pu));
+  std::push_heap (m_queue.begin (), m_queue.end (), std::greater<std::pair<int64_t, uint32_t> > ());
+}
+
+Time
+PuPopulation::Draw (void)
+{
+  if (m_nextDraw == m_draws.size ())
+    {
+      m_draws.resize (m_batchSize);
+      for (uint32_t i = 0; i < m_batchSize; ++i)
+        {
+          m_draws[i] = m_randVar->GetValue ();
+        }
+      m_nextDraw = 0;
+    }
+  return Seconds (m_draws[m_nextDraw++]);
+}
+
+} // namespace ns3
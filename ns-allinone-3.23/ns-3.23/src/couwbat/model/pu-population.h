@@ -0,0 +1,169 @@
+#ifndef PU_POPULATION_H
+#define PU_POPULATION_H
+
+#include "ns3/core-module.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumMap;
+class SpectrumDb;
+
+/**
+ * \brief Many primary users switched on and off by one object.
+ *
+ * \ingroup couwbat
+ *
+ * Instead of one PrimaryUserNetDevice and one OnOffModel with their own
+ * events per primary user, the population keeps the band and on/off state of
+ * all its primary users in arrays and all pending switching times in one
+ * time-ordered queue. A single simulator event is scheduled at a time, for the
+ * earliest switch; it switches all primary users due at that time and informs
+ * the SpectrumDb about every arrival and departure.
+ *
+ * All primary users of a population follow the same on/off model, selected
+ * by the Model attribute:
+ *  - Once: on at FirstOn, off at FinalOff (OnceOnOffModel)
+ *  - Periodic: on at FirstOn, then on for PeriodOn and off for PeriodOff (PeriodicOnOffModel)
+ *  - Random: on and off for durations drawn from RandomVariable, starting
+ *    after FirstOn plus one draw (RandomOnOffModel)
+ *
+ * Like the OnOffModels, no primary user is switched on after FinalOff and
+ * every primary user is switched off at FinalOff unless it is zero. The
+ * random durations of all primary users come from the one RandomVariable,
+ * drawn BatchSize values at a time. Use several populations for primary users
+ * with different models.
+ */
+class PuPopulation : public Object
+{
+public:
+  /** \enum Model
+   * On/off model of all primary users of the population
+   */
+  enum Model
+  {
+    MODEL_ONCE, //!< as OnceOnOffModel
+    MODEL_PERIODIC, //!< as PeriodicOnOffModel
+    MODEL_RANDOM //!< as RandomOnOffModel
+  };
+
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * TracedCallback signature for switching a primary user.
+   *
+   * \param [in] pu The index of the primary user, as returned by AddPrimaryUser.
+   * \param [in] on True if the primary user was switched on, false if off.
+   */
+  typedef void (* SwitchCallback)(uint32_t pu, bool on);
+
+  PuPopulation (); //!< Default constructor
+  ~PuPopulation (); //!< Destructor
+
+  /**
+   * Add a primary user occupying a band of subcarriers while on.
+   * \param start_subcarrier The first subcarrier of the band.
+   * \param n_subcarriers The number of subcarriers of the band.
+   * \return The index of the primary user.
+   */
+  uint32_t AddPrimaryUser (uint32_t start_subcarrier, uint32_t n_subcarriers);
+
+  /**
+   * \return The number of primary users.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param pu The index of a primary user.
+   * \return True if the primary user is on.
+   */
+  bool IsOn (uint32_t pu) const;
+
+  /**
+   * \return The number of primary users switched on or off so far.
+   */
+  uint64_t GetNSwitches (void) const;
+
+  /**
+   * Set the spectrum database.
+   * \param db The spectrum database.
+   */
+  void SetSpectrumDb (Ptr<SpectrumDb> db);
+
+  /**
+   * Queue the first switch of every primary user and start operation.
+   * Primary users that are still on from an earlier Start are turned off first.
+   */
+  void Start (void);
+
+  /**
+   * Assign a fixed random variable stream number to the random variable
+   * used by this population.
+   *
+   * \param stream First stream index to use
+   * \return the number of stream indices assigned by this population
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Switch all primary users that are due now and schedule the next event.
+   */
+  void Switch (void);
+
+  /**
+   * Switch one primary user and queue its next switch.
+   * \param pu The index of the primary user.
+   */
+  void Toggle (uint32_t pu);
+
+  /**
+   * Queue a switch.
+   * \param pu The index of the primary user.
+   * \param at The absolute time of the switch.
+   */
+  void Push (uint32_t pu, Time at);
+
+  /**
+   * \return The next duration drawn from m_randVar.
+   */
+  Time Draw (void);
+
+  Model m_model; //!< On/off model of all primary users
+  Time m_firstOn; //!< The time when to first turn the primary users on.
+  Time m_finalOff; //!< The time when to finally turn the primary users off, zero to run indefinitely.
+  Time m_periodOn; //!< Periodic duration the primary users stay on.
+  Time m_periodOff; //!< Periodic duration the primary users stay off.
+  Ptr<RandomVariableStream> m_randVar; //!< Random durations (in seconds) the primary users stay on/off.
+  uint32_t m_batchSize; //!< Number of values drawn from m_randVar at once
+
+  Ptr<SpectrumDb> m_specDb; //!< The spectrum database
+  std::vector<uint32_t> m_start; //!< First subcarrier of every primary user
+  std::vector<uint32_t> m_length; //!< Number of subcarriers of every primary user
+  std::vector<uint8_t> m_on; //!< On/off state of every primary user
+  std::vector<std::pair<int64_t, uint32_t> > m_queue; //!< Heap of pending switches (time step, primary user), earliest first
+  std::vector<double> m_draws; //!< Values drawn from m_randVar in advance
+  uint32_t m_nextDraw; //!< Next unused value of m_draws
+  Ptr<SpectrumMap> m_map; //!< Map of the primary user being switched, reused for all of them
+  std::vector<uint64_t> m_zero; //!< Words of an empty map
+  EventId m_event; //!< The pending switch event
+  uint64_t m_nSwitches; //!< Number of switches so far
+
+  /**
+   * The trace source fired when a primary user is switched on or off.
+   */
+  TracedCallback<uint32_t, bool> m_switchTrace;
+};
+
+} // namespace ns3
+
+#endif /* PU_POPULATION_H */
@@ -0,0 +1,322 @@
+#include "pu-trace-reader.h"
+#include "pu-trace-writer.h"
+#include "spectrum-map.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("PuTraceReader");
+
+namespace ns3
+{
+
+PuTraceReader::PuTraceReader ()
+  : m_data (0),
+    m_size (0),
+    m_file (0),
+    m_lineCount (0),
+    m_stateLine (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PuTraceReader::~PuTraceReader ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+bool
+PuTraceReader::Open (std::string fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  Close ();
+
+  std::FILE *file = std::fopen (fileName.c_str (), "rb");
+  if (!file)
+    {
+      NS_LOG_WARN ("Cannot open " << fileName);
+      return false;
+    }
+  char magic[sizeof (PuTraceWriter::MAGIC)];
+  if (std::fread (magic, sizeof (magic), 1, file) == 1
+      && std::memcmp (magic, PuTraceWriter::MAGIC, sizeof (magic)) == 0)
+    {
+      if (!OpenBinary (file))
+        {
+          NS_LOG_WARN ("Corrupt binary trace " << fileName);
+          Close ();
+          return false;
+        }
+      NS_LOG_INFO ("Opened binary trace " << fileName << " with " << GetLineCount () << " lines");
+      return true;
+    }
+  std::fclose (file);
+  return OpenCsv (fileName);
+}
+
+bool
+PuTraceReader::OpenCsv (std::string fileName)
+{
+  int fd = open (fileName.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_WARN ("Cannot open " << fileName);
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return false;
+    }
+  m_size = st.st_size;
+  if (m_size > 0)
+    {
+      void *data = mmap (0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        {
+          NS_LOG_WARN ("Cannot map " << fileName);
+          close (fd);
+          m_size = 0;
+          return false;
+        }
+      m_data = static_cast<const char *> (data);
+      madvise (data, m_size, MADV_SEQUENTIAL);
+    }
+  // The mapping stays valid after closing the file
+  close (fd);
+
+  // Index the lines, a last line without newline counts as well
+  uint64_t pos = 0;
+  while (pos < m_size)
+    {
+      m_lineStart.push_back (pos);
+      const char *nl = static_cast<const char *> (std::memchr (m_data + pos, '\n', m_size - pos));
+      pos = nl ? (nl - m_data) + 1 : m_size;
+    }
+  m_lineStart.push_back (m_size);
+
+  NS_LOG_INFO ("Indexed " << GetLineCount () << " lines of " << fileName);
+  return true;
+}
+
+bool
+PuTraceReader::OpenBinary (std::FILE *file)
+{
+  m_file = file;
+  // Frames are small, read ahead in larger blocks
+  setvbuf (m_file, 0, _IOFBF, 1 << 16);
+
+  uint32_t version, subcarriers, keyInterval;
+  int64_t interval;
+  if (std::fread (&version, sizeof (version), 1, m_file) != 1
+      || std::fread (&subcarriers, sizeof (subcarriers), 1, m_file) != 1
+      || std::fread (&interval, sizeof (interval), 1, m_file) != 1
+      || std::fread (&m_lineCount, sizeof (m_lineCount), 1, m_file) != 1
+      || std::fread (&keyInterval, sizeof (keyInterval), 1, m_file) != 1
+      || version != PuTraceWriter::VERSION)
+    {
+      return false;
+    }
+  m_samplingInterval = NanoSeconds (interval);
+  m_state.assign ((subcarriers + 63) / 64, 0);
+  m_stateLine = 0;
+
+  // Key frame index from the trailer
+  uint64_t indexOffset;
+  uint32_t indexCount;
+  char magic[sizeof (PuTraceWriter::INDEX_MAGIC)];
+  if (std::fseek (m_file, -static_cast<long> (PuTraceWriter::TRAILER_SIZE), SEEK_END) != 0
+      || std::fread (&indexOffset, sizeof (indexOffset), 1, m_file) != 1
+      || std::fread (&indexCount, sizeof (indexCount), 1, m_file) != 1
+      || std::fread (magic, sizeof (magic), 1, m_file) != 1
+      || std::memcmp (magic, PuTraceWriter::INDEX_MAGIC, sizeof (magic)) != 0
+      || std::fseek (m_file, indexOffset, SEEK_SET) != 0)
+    {
+      return false;
+    }
+  m_keyFrames.resize (indexCount);
+  for (uint32_t i = 0; i < indexCount; ++i)
+    {
+      if (std::fread (&m_keyFrames[i].first, sizeof (uint32_t), 1, m_file) != 1
+          || std::fread (&m_keyFrames[i].second, sizeof (uint64_t), 1, m_file) != 1)
+        {
+          return false;
+        }
+    }
+  if (m_lineCount > 0 && (m_keyFrames.empty () || m_keyFrames[0].first != 1))
+    {
+      return false;
+    }
+  return true;
+}
+
+void
+PuTraceReader::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data)
+    {
+      munmap (const_cast<char *> (m_data), m_size);
+    }
+  m_data = 0;
+  m_size = 0;
+  m_lineStart.clear ();
+
+  if (m_file)
+    {
+      std::fclose (m_file);
+    }
+  m_file = 0;
+  m_lineCount = 0;
+  m_samplingInterval = Time ();
+  m_state.clear ();
+  m_stateLine = 0;
+  m_keyFrames.clear ();
+  m_words.clear ();
+}
+
+uint32_t
+PuTraceReader::GetLineCount (void) const
+{
+  if (m_file)
+    {
+      return m_lineCount;
+    }
+  return m_lineStart.empty () ? 0 : m_lineStart.size () - 1;
+}
+
+Time
+PuTraceReader::GetSamplingInterval (void) const
+{
+  return m_samplingInterval;
+}
+
+bool
+PuTraceReader::ReadLine (uint32_t line, SpectrumMap &map)
+{
+  if (line < 1 || line > GetLineCount ())
+    {
+      return false;
+    }
+
+  // Reused for every line, reading allocates only when the map size grows
+  std::vector<uint64_t> &words = m_words;
+  words.assign (map.GetNWords (), 0);
+  const uint32_t columns = map.GetSize ();
+  if (!m_file)
+    {
+      ReadCsvLine (line, &words[0], columns);
+    }
+  else
+    {
+      if (!SeekBinaryLine (line))
+        {
+          NS_LOG_WARN ("Corrupt binary trace at line " << line);
+          return false;
+        }
+      std::copy (m_state.begin (), m_state.begin () + std::min (m_state.size (), words.size ()), words.begin ());
+      // Subcarriers beyond the map are ignored
+      if (columns % 64 && m_state.size () >= words.size ())
+        {
+          words.back () &= (1ULL << (columns % 64)) - 1;
+        }
+    }
+  map.SetWords (&words[0]);
+  return true;
+}
+
+void
+PuTraceReader::ReadCsvLine (uint32_t line, uint64_t *words, uint32_t columns) const
+{
+  const char *p = m_data + m_lineStart[line - 1];
+  const char *end = m_data + m_lineStart[line];
+  // Strip the line end, also the CR of files written with CRLF line ends
+  if (end > p && end[-1] == '\n')
+    {
+      --end;
+    }
+  if (end > p && end[-1] == '\r')
+    {
+      --end;
+    }
+
+  for (uint32_t column = 0; column < columns && p <= end; ++column)
+    {
+      const char *cell = p;
+      while (p < end && *p != ',')
+        {
+          ++p;
+        }
+      if (p - cell == 1 && *cell == '1')
+        {
+          words[column / 64] |= 1ULL << (column % 64);
+        }
+      // Skip the comma, past end if this was the last column
+      ++p;
+    }
+}
+
+bool
+PuTraceReader::SeekBinaryLine (uint32_t line)
+{
+  // Replay from the last key frame before the line, unless the current line is
+  // already at or after that key frame
+  std::vector<std::pair<uint32_t, uint64_t> >::const_iterator it =
+    std::upper_bound (m_keyFrames.begin (), m_keyFrames.end (), std::make_pair (line, UINT64_MAX));
+  --it;
+  if (line < m_stateLine || it->first > m_stateLine)
+    {
+      if (std::fseek (m_file, it->second, SEEK_SET) != 0)
+        {
+          return false;
+        }
+      m_stateLine = it->first - 1;
+    }
+  while (m_stateLine < line)
+    {
+      if (!ReadFrame ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+PuTraceReader::ReadFrame (void)
+{
+  uint8_t type;
+  uint32_t count;
+  if (std::fread (&type, sizeof (type), 1, m_file) != 1
+      || std::fread (&count, sizeof (count), 1, m_file) != 1
+      || count > m_state.size ())
+    {
+      return false;
+    }
+  if (type == PuTraceWriter::FRAME_KEY)
+    {
+      std::fill (m_state.begin (), m_state.end (), 0);
+    }
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      uint32_t w;
+      uint64_t diff;
+      if (std::fread (&w, sizeof (w), 1, m_file) != 1
+          || std::fread (&diff, sizeof (diff), 1, m_file) != 1
+          || w >= m_state.size ())
+        {
+          return false;
+        }
+      m_state[w] ^= diff;
+    }
+  ++m_stateLine;
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,129 @@
+#ifndef PU_TRACE_READER_H
+#define PU_TRACE_READER_H
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumMap;
+
+/**
+ * \brief Random access to the lines of a spectrum trace file.
+ * \ingroup couwbat
+ *
+ * Two formats are supported, told apart by the magic at the start of the file:
+ *
+ * CSV: every line of the trace has one comma separated column per subcarrier,
+ * a column "1" means the subcarrier is occupied, anything else that it is free.
+ * Lines may end with LF or CRLF.
+ * The file is mapped into memory once and the offset of every line is indexed
+ * when it is opened, so reading a line neither reopens the file nor scans the
+ * lines before it. The columns are packed directly into the 64 bit words of
+ * the SpectrumMap.
+ *
+ * Binary: the compact format written by PuTraceWriter. The file is streamed
+ * through a buffer and only the current line is kept in memory. Reading the
+ * line after the last one applies a single delta frame, any other line is
+ * reached by replaying from the key frame before it.
+ */
+class PuTraceReader : public SimpleRefCount<PuTraceReader>
+{
+public:
+  PuTraceReader ();
+  ~PuTraceReader ();
+
+  /**
+   * Open the file and index its lines. A previously opened file is closed.
+   * \param fileName The name (and location if not in working directory) of the CSV or binary file.
+   * \return False if the file cannot be opened or mapped, or is not a valid binary trace.
+   */
+  bool Open (std::string fileName);
+
+  /**
+   * Unmap or close the file.
+   */
+  void Close (void);
+
+  /**
+   * \return The number of lines, as counted by std::getline for CSV files.
+   */
+  uint32_t GetLineCount (void) const;
+
+  /**
+   * \return The sampling interval stored in a binary trace, zero if unknown or for CSV files.
+   */
+  Time GetSamplingInterval (void) const;
+
+  /**
+   * Set the subcarriers of map to the columns of a line.
+   * Columns beyond the number of subcarriers are ignored, missing columns are free.
+   * \param line The line number, starting at 1.
+   * \param map The map to overwrite.
+   * \return False if line is out of range or the binary file is corrupt.
+   */
+  bool ReadLine (uint32_t line, SpectrumMap &map);
+
+private:
+  PuTraceReader (const PuTraceReader &); //!< Not copyable
+  PuTraceReader &operator = (const PuTraceReader &); //!< Not copyable
+
+  /**
+   * Map a CSV file and index its lines.
+   * \param fileName The name of the file.
+   * \return False if the file cannot be opened or mapped.
+   */
+  bool OpenCsv (std::string fileName);
+
+  /**
+   * Read the header and index of a binary file.
+   * \param file The file, positioned after the magic.
+   * \return False if the file is not a valid binary trace.
+   */
+  bool OpenBinary (std::FILE *file);
+
+  /**
+   * Pack the columns of a CSV line.
+   * \param line The line number, starting at 1.
+   * \param words The words to set, map.GetNWords () long and zeroed.
+   * \param columns The number of columns to read.
+   */
+  void ReadCsvLine (uint32_t line, uint64_t *words, uint32_t columns) const;
+
+  /**
+   * Bring m_state to a line of a binary file.
+   * \param line The line number, starting at 1.
+   * \return False if the file is corrupt.
+   */
+  bool SeekBinaryLine (uint32_t line);
+
+  /**
+   * Apply the next frame of a binary file to m_state.
+   * \return False if the file is corrupt.
+   */
+  bool ReadFrame (void);
+
+  // CSV
+  const char *m_data; //!< The mapped file
+  uint64_t m_size; //!< Size of the mapped file in bytes
+  std::vector<uint64_t> m_lineStart; //!< Offset of every line, followed by the end offset of the last line
+
+  // Binary
+  std::FILE *m_file; //!< The binary file
+  uint32_t m_lineCount; //!< Number of lines of the binary file
+  Time m_samplingInterval; //!< Sampling interval of the binary file
+  std::vector<uint64_t> m_state; //!< Words of the current line of the binary file
+  uint32_t m_stateLine; //!< Line in m_state, 0 before the first frame
+  std::vector<std::pair<uint32_t, uint64_t> > m_keyFrames; //!< Line and offset of every key frame
+
+  std::vector<uint64_t> m_words; //!< Words of the line being read by ReadLine
+};
+
+} // namespace ns3
+
+#endif /* PU_TRACE_READER_H */
@@ -0,0 +1,129 @@
+#include "pu-trace-writer.h"
+#include "ns3/log.h"
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("PuTraceWriter");
+
+namespace ns3
+{
+
+const char PuTraceWriter::MAGIC[8] = { 'C', 'W', 'P', 'U', 'T', 'R', 'C', '\0' };
+const char PuTraceWriter::INDEX_MAGIC[8] = { 'C', 'W', 'P', 'U', 'I', 'D', 'X', '\0' };
+
+PuTraceWriter::PuTraceWriter ()
+  : m_file (0),
+    m_ok (false),
+    m_keyInterval (1024),
+    m_lineCount (0),
+    m_offset (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PuTraceWriter::~PuTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_file)
+    {
+      Close ();
+    }
+}
+
+bool
+PuTraceWriter::Open (std::string fileName, uint32_t subcarriers, Time samplingInterval, uint32_t keyInterval)
+{
+  NS_LOG_FUNCTION (this << fileName << subcarriers << samplingInterval << keyInterval);
+  NS_ASSERT (!m_file);
+  NS_ASSERT (keyInterval > 0);
+  m_file = std::fopen (fileName.c_str (), "wb");
+  if (!m_file)
+    {
+      NS_LOG_WARN ("Cannot create " << fileName);
+      return false;
+    }
+  m_ok = true;
+  m_keyInterval = keyInterval;
+  m_lineCount = 0;
+  m_previous.assign ((subcarriers + 63) / 64, 0);
+  m_index.clear ();
+
+  const uint32_t version = VERSION;
+  const int64_t interval = samplingInterval.GetNanoSeconds ();
+  const uint32_t lines = 0; // completed by Close
+  m_ok = std::fwrite (MAGIC, sizeof (MAGIC), 1, m_file) == 1
+    && std::fwrite (&version, sizeof (version), 1, m_file) == 1
+    && std::fwrite (&subcarriers, sizeof (subcarriers), 1, m_file) == 1
+    && std::fwrite (&interval, sizeof (interval), 1, m_file) == 1
+    && std::fwrite (&lines, sizeof (lines), 1, m_file) == 1
+    && std::fwrite (&m_keyInterval, sizeof (m_keyInterval), 1, m_file) == 1;
+  m_offset = HEADER_SIZE;
+  return m_ok;
+}
+
+bool
+PuTraceWriter::WriteLine (const uint64_t *words)
+{
+  NS_ASSERT (m_file);
+  const bool key = m_lineCount % m_keyInterval == 0;
+  if (key)
+    {
+      m_index.push_back (std::make_pair (m_lineCount + 1, m_offset));
+    }
+
+  const uint8_t type = key ? FRAME_KEY : FRAME_DELTA;
+  uint32_t count = 0;
+  for (uint32_t w = 0; w < m_previous.size (); ++w)
+    {
+      const uint64_t base = key ? 0 : m_previous[w];
+      count += (words[w] != base);
+    }
+  m_ok = m_ok && std::fwrite (&type, sizeof (type), 1, m_file) == 1
+    && std::fwrite (&count, sizeof (count), 1, m_file) == 1;
+  for (uint32_t w = 0; w < m_previous.size () && m_ok; ++w)
+    {
+      const uint64_t base = key ? 0 : m_previous[w];
+      if (words[w] != base)
+        {
+          const uint64_t diff = words[w] ^ base;
+          m_ok = std::fwrite (&w, sizeof (w), 1, m_file) == 1
+            && std::fwrite (&diff, sizeof (diff), 1, m_file) == 1;
+        }
+    }
+  m_offset += sizeof (type) + sizeof (count) + count * (sizeof (uint32_t) + sizeof (uint64_t));
+  std::copy (words, words + m_previous.size (), m_previous.begin ());
+  ++m_lineCount;
+  return m_ok;
+}
+
+bool
+PuTraceWriter::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_file);
+  const uint64_t indexOffset = m_offset;
+  for (uint32_t i = 0; i < m_index.size () && m_ok; ++i)
+    {
+      m_ok = std::fwrite (&m_index[i].first, sizeof (uint32_t), 1, m_file) == 1
+        && std::fwrite (&m_index[i].second, sizeof (uint64_t), 1, m_file) == 1;
+    }
+  const uint32_t indexCount = m_index.size ();
+  m_ok = m_ok && std::fwrite (&indexOffset, sizeof (indexOffset), 1, m_file) == 1
+    && std::fwrite (&indexCount, sizeof (indexCount), 1, m_file) == 1
+    && std::fwrite (INDEX_MAGIC, sizeof (INDEX_MAGIC), 1, m_file) == 1;
+
+  // Complete the number of lines in the header
+  m_ok = m_ok && std::fseek (m_file, sizeof (MAGIC) + 2 * sizeof (uint32_t) + sizeof (int64_t), SEEK_SET) == 0
+    && std::fwrite (&m_lineCount, sizeof (m_lineCount), 1, m_file) == 1;
+
+  m_ok = (std::fclose (m_file) == 0) && m_ok;
+  m_file = 0;
+  return m_ok;
+}
+
+uint32_t
+PuTraceWriter::GetLineCount (void) const
+{
+  return m_lineCount;
+}
+
+} // namespace ns3
@@ -0,0 +1,104 @@
+#ifndef PU_TRACE_WRITER_H
+#define PU_TRACE_WRITER_H
+
+#include "ns3/nstime.h"
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Writes spectrum traces in the compact binary PU trace format.
+ * \ingroup couwbat
+ *
+ * The format stores one frame per trace line (sample) with the subcarriers in
+ * 64 bit words, subcarrier i in bit i % 64 of word i / 64 as in SpectrumMap.
+ * All fields are little-endian.
+ *
+ * Header (32 bytes):
+ *  - magic "CWPUTRC\0" (8 bytes)
+ *  - version (uint32_t), currently 1
+ *  - number of subcarriers (uint32_t)
+ *  - sampling interval in ns (int64_t), 0 if unknown
+ *  - number of lines (uint32_t)
+ *  - key frame interval (uint32_t)
+ *
+ * Frames, one per line:
+ *  - type (uint8_t): FRAME_DELTA relative to the previous line, FRAME_KEY relative to all free
+ *  - number of changed words (uint32_t)
+ *  - for every changed word its index (uint32_t) and the XOR with the base (uint64_t)
+ *
+ * A line that does not differ from the previous one takes 5 bytes instead of
+ * two bytes per subcarrier in the CSV format. Every key frame interval lines
+ * a key frame is written, so a reader can start at any line by replaying from
+ * the key frame before it.
+ *
+ * Index, after the last frame:
+ *  - for every key frame its line (uint32_t) and file offset (uint64_t)
+ *  - offset of the index (uint64_t), number of index entries (uint32_t), magic "CWPUIDX\0"
+ *
+ * Frames are written as the lines arrive, so traces of any length can be
+ * converted without holding them in memory. Compression of the frames is left
+ * to the file system.
+ */
+class PuTraceWriter
+{
+public:
+  static const char MAGIC[8]; //!< Magic of the header
+  static const char INDEX_MAGIC[8]; //!< Magic at the end of the index
+  static const uint32_t VERSION = 1; //!< Version of the format
+  static const uint32_t HEADER_SIZE = 32; //!< Size of the header in bytes
+  static const uint32_t TRAILER_SIZE = 20; //!< Size of the index trailer in bytes
+  static const uint8_t FRAME_DELTA = 0; //!< Frame relative to the previous line
+  static const uint8_t FRAME_KEY = 1; //!< Frame relative to all subcarriers free
+
+  PuTraceWriter ();
+  ~PuTraceWriter ();
+
+  /**
+   * Create the file and write the header.
+   * \param fileName The name of the file to create.
+   * \param subcarriers The number of subcarriers per line.
+   * \param samplingInterval The sampling interval of the trace, zero if unknown.
+   * \param keyInterval A key frame is written every keyInterval lines.
+   * \return False if the file cannot be created.
+   */
+  bool Open (std::string fileName, uint32_t subcarriers, Time samplingInterval, uint32_t keyInterval = 1024);
+
+  /**
+   * Append a line.
+   * \param words (subcarriers + 63) / 64 words of the line, bits beyond the last subcarrier must be zero.
+   * \return False on write errors.
+   */
+  bool WriteLine (const uint64_t *words);
+
+  /**
+   * Write the index, complete the header and close the file.
+   * \return False on write errors.
+   */
+  bool Close (void);
+
+  /**
+   * \return The number of lines written so far.
+   */
+  uint32_t GetLineCount (void) const;
+
+private:
+  PuTraceWriter (const PuTraceWriter &); //!< Not copyable
+  PuTraceWriter &operator = (const PuTraceWriter &); //!< Not copyable
+
+  std::FILE *m_file; //!< The file
+  bool m_ok; //!< False after a write error
+  uint32_t m_keyInterval; //!< Lines between two key frames
+  uint32_t m_lineCount; //!< Lines written so far
+  uint64_t m_offset; //!< Current file offset
+  std::vector<uint64_t> m_previous; //!< The previous line
+  std::vector<std::pair<uint32_t, uint64_t> > m_index; //!< Line and offset of every key frame
+};
+
+} // namespace ns3
+
+#endif /* PU_TRACE_WRITER_H */
@@ -0,0 +1,166 @@
+#include "pu-trace.h"
+#include "pu-trace-reader.h"
+#include "spectrum-map.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+NS_LOG_COMPONENT_DEFINE ("PuTrace");
+
+namespace ns3
+{
+
+PuTrace::PuTrace ()
+  : m_nWords (0),
+    m_lineCount (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PuTrace::~PuTrace ()
+{
+  NS_LOG_FUNCTION (this);
+  Cache &cache = GetCache ();
+  Cache::iterator it = cache.find (m_key);
+  if (it != cache.end () && it->second == this)
+    {
+      cache.erase (it);
+    }
+}
+
+PuTrace::Cache &
+PuTrace::GetCache (void)
+{
+  static Cache cache;
+  return cache;
+}
+
+Ptr<const PuTrace>
+PuTrace::Get (std::string fileName)
+{
+  NS_LOG_FUNCTION (fileName);
+
+  // Different names of the same file share the trace
+  std::string key = fileName;
+  char path[PATH_MAX];
+  if (realpath (fileName.c_str (), path))
+    {
+      key = path;
+    }
+
+  Cache &cache = GetCache ();
+  Cache::iterator it = cache.find (key);
+  if (it != cache.end ())
+    {
+      NS_LOG_INFO ("Sharing decoded trace of " << fileName);
+      return Ptr<const PuTrace> (it->second);
+    }
+
+  Ptr<PuTrace> trace = Ptr<PuTrace> (new PuTrace (), false);
+  if (!trace->Decode (fileName))
+    {
+      return 0;
+    }
+  trace->m_key = key;
+  cache[key] = PeekPointer (trace);
+  return trace;
+}
+
+bool
+PuTrace::Decode (std::string fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  PuTraceReader reader;
+  if (!reader.Open (fileName) || reader.GetLineCount () < 1)
+    {
+      return false;
+    }
+
+  Ptr<SpectrumMap> map = CreateObject<SpectrumMap> ();
+  m_nWords = map->GetNWords ();
+  m_lineCount = reader.GetLineCount ();
+  m_samplingInterval = reader.GetSamplingInterval ();
+  std::vector<uint64_t> words (m_nWords);
+  for (uint32_t line = 1; line <= m_lineCount; ++line)
+    {
+      if (!reader.ReadLine (line, *map))
+        {
+          return false;
+        }
+      for (uint32_t w = 0; w < m_nWords; ++w)
+        {
+          words[w] = map->GetWord (w);
+        }
+      // A line equal to the line before shares its frame
+      if (line > 1 && std::equal (words.begin (), words.end (), m_frames.end () - m_nWords))
+        {
+          continue;
+        }
+      m_frames.insert (m_frames.end (), words.begin (), words.end ());
+      m_frameLines.push_back (line);
+    }
+
+  // Line 1 is a change unless it equals the last line, which is in the last frame
+  m_changes = m_frameLines;
+  if (std::equal (m_frames.begin (), m_frames.begin () + m_nWords, m_frames.end () - m_nWords))
+    {
+      m_changes.erase (m_changes.begin ());
+    }
+  NS_LOG_INFO ("Decoded " << m_lineCount << " lines of " << fileName << " into "
+               << m_frameLines.size () << " frames of " << m_frames.size () * sizeof (uint64_t) << " B, "
+               << m_changes.size () << " changes");
+  return true;
+}
+
+uint32_t
+PuTrace::GetLineCount (void) const
+{
+  return m_lineCount;
+}
+
+Time
+PuTrace::GetSamplingInterval (void) const
+{
+  return m_samplingInterval;
+}
+
+const uint64_t *
+PuTrace::GetLine (uint32_t line) const
+{
+  NS_ASSERT (line >= 1 && line <= m_lineCount);
+  const uint64_t frame = std::upper_bound (m_frameLines.begin (), m_frameLines.end (), line)
+    - m_frameLines.begin () - 1;
+  return &m_frames[frame * m_nWords];
+}
+
+bool
+PuTrace::ReadLine (uint32_t line, SpectrumMap &map) const
+{
+  if (line < 1 || line > m_lineCount)
+    {
+      return false;
+    }
+  NS_ASSERT (map.GetNWords () == m_nWords);
+  map.SetWords (GetLine (line));
+  return true;
+}
+
+uint32_t
+PuTrace::GetNextChange (uint32_t line) const
+{
+  NS_ASSERT (line >= 1 && line <= m_lineCount);
+  if (m_changes.empty ())
+    {
+      return 0;
+    }
+  std::vector<uint32_t>::const_iterator it = std::upper_bound (m_changes.begin (), m_changes.end (), line);
+  if (it != m_changes.end ())
+    {
+      return *it - line;
+    }
+  // Wrap around to the first change
+  return m_changes.front () + m_lineCount - line;
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+#ifndef PU_TRACE_H
+#define PU_TRACE_H
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumMap;
+
+/**
+ * \brief A spectrum trace decoded into memory, shared by all users of the file.
+ * \ingroup couwbat
+ *
+ * The lines of a CSV or binary trace (PuTraceReader) are decoded once into an
+ * immutable array of SpectrumMap words. Get returns the same instance for
+ * every request of a file while it is in use, so any number of trace based
+ * PUs replaying the same measurement, from the same or different lines, read
+ * and store the file only once.
+ *
+ * Only the lines where the trace changes are stored, as frames of
+ * GetSize () / 8 bytes of the SpectrumMap. The lines that repeat the line
+ * before share its frame, which is looked up by a binary search over the
+ * changes. The memory therefore grows with the number of changes, not with
+ * the length of the trace, and a replay can skip the repeated lines
+ * (GetNextChange).
+ */
+class PuTrace : public SimpleRefCount<PuTrace>
+{
+public:
+  ~PuTrace ();
+
+  /**
+   * Get the decoded trace of a file, decoding it if it is not in use yet.
+   * \param fileName The name (and location if not in working directory) of the CSV or binary file.
+   * \return The trace, 0 if the file cannot be read or has no lines.
+   */
+  static Ptr<const PuTrace> Get (std::string fileName);
+
+  /**
+   * \return The number of lines.
+   */
+  uint32_t GetLineCount (void) const;
+
+  /**
+   * \return The sampling interval stored in the file, zero if unknown.
+   */
+  Time GetSamplingInterval (void) const;
+
+  /**
+   * \param line The line number, starting at 1.
+   * \return The SpectrumMap words of the line (SpectrumMap::GetNWords () long).
+   */
+  const uint64_t * GetLine (uint32_t line) const;
+
+  /**
+   * Set the subcarriers of map to a line.
+   * \param line The line number, starting at 1.
+   * \param map The map to overwrite.
+   * \return False if line is out of range.
+   */
+  bool ReadLine (uint32_t line, SpectrumMap &map) const;
+
+  /**
+   * The trace is replayed in a loop, line 1 follows the last line.
+   * \param line The line number, starting at 1.
+   * \return The number of lines after line until the next line that differs
+   *   from it, 0 if all lines are the same.
+   */
+  uint32_t GetNextChange (uint32_t line) const;
+
+private:
+  PuTrace ();
+  PuTrace (const PuTrace &); //!< Not copyable
+  PuTrace &operator = (const PuTrace &); //!< Not copyable
+
+  /**
+   * Decode all lines of a file.
+   * \param fileName The name of the file.
+   * \return False if the file cannot be read.
+   */
+  bool Decode (std::string fileName);
+
+  typedef std::map<std::string, PuTrace *> Cache; //!< Traces in use by canonical file name
+
+  /**
+   * \return The traces in use. They remove themselves when destroyed, so the
+   * cache never keeps a trace alive.
+   */
+  static Cache & GetCache (void);
+
+  std::string m_key; //!< Key of this trace in the cache
+  uint32_t m_nWords; //!< Words per line
+  uint32_t m_lineCount; //!< Number of lines
+  Time m_samplingInterval; //!< Sampling interval stored in the file
+  std::vector<uint64_t> m_frames; //!< The words of every frame, frame after frame
+  std::vector<uint32_t> m_frameLines; //!< First line of every frame, starting with line 1
+  std::vector<uint32_t> m_changes; //!< Lines that differ from the line before, line 1 compared with the last line
+};
+
+} // namespace ns3
+
+#endif /* PU_TRACE_H */
@@ -115,9 +115,9 @@ SimpleCouwbatPhy::SimpleCouwbatPhy ()
   m_random = CreateObject<UniformRandomVariable> ();
   m_state = CreateObject<CouwbatPhyStateHelper> ();
   m_state->SetPhy (this);
-  for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+  for (uint32_t i = 0; i < m_interference.size (); ++i)
     {
-      m_interference.push_back (CreateObject<CouwbatInterferenceHelper> ());
+      m_interference[i] = CreateObject<CouwbatInterferenceHelper> ();
     }
   NS_ASSERT (m_interference.size () == Couwbat::GetNumberOfSubchannels ());
   m_sfCnt = 0;
@@ -459,9 +459,9 @@ SimpleCouwbatPhy::SendPacket (Ptr<Packet> packet)
   std::vector<uint32_t> subchannels;
   subchannels.push_back (0);
   std::vector<enum CouwbatMCS> mcs;
-  mcs.push_back (Couwbat::GetDefaultMcs ());
+  mcs.push_back (m_config->GetDefaultMcs ());
   CouwbatMode txMode = CouwbatMode (COUWBAT_MOD_CLASS_OFDM, true, subchannels, mcs);
-  CouwbatTxVector txVector = CouwbatTxVector (txMode, Couwbat::GetTxPowerBS());
+  CouwbatTxVector txVector = CouwbatTxVector (txMode, m_config->GetTxPowerBS ());
   SendPacketMh (packet, txMode, txVector, true);
 }
 
@@ -484,7 +484,7 @@ SimpleCouwbatPhy::SendPacketMh (Ptr<Packet> packet, CouwbatMode txMode, CouwbatT
           // convert metaheader to CouwbatMode and CouwbatTxVector format
           std::vector<uint32_t> subchannels;
           std::vector<CouwbatMCS> mcs;
-          for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+          for (uint32_t i = 0; i < m_config->GetNumberOfSubchannels (); ++i)
             {
               if (mh.m_allocatedSubChannels.test(i))
                 {
@@ -493,23 +493,24 @@ SimpleCouwbatPhy::SendPacketMh (Ptr<Packet> packet, CouwbatMode txMode, CouwbatT
                 }
             }
           CouwbatMode txMode = CouwbatMode (COUWBAT_MOD_CLASS_OFDM, true, subchannels, mcs);
-          CouwbatTxVector txVector = CouwbatTxVector (txMode, Couwbat::GetTxPowerBS());
+          CouwbatTxVector txVector = CouwbatTxVector (txMode, m_config->GetTxPowerBS ());
 
 
           // Calculate TX time and schedule
           // int times are in microseconds
-          static const uint32_t sfDuration = Couwbat::GetSuperframeDuration ();
+          const uint32_t sfDuration = m_config->GetSuperframeDuration ();
+          const uint32_t symbDuration = m_config->GetSymbolDuration ();
 
           const int64_t currentSfStart =
               (Simulator::Now ().GetMicroSeconds () / sfDuration) * sfDuration;
 
           const int64_t sendTime =
               currentSfStart + (mh.m_ofdm_sym_sframe_count - m_sfCnt) * sfDuration
-              + mh.m_ofdm_sym_offset * Couwbat::GetSymbolDuration ();
+              + mh.m_ofdm_sym_offset * symbDuration;
 
           Time txDurationTime = CalculateTxDuration (packet->GetSize (), txVector);
-          unsigned int txDurationSymbols = (txDurationTime.GetMicroSeconds () + Couwbat::GetSymbolDuration () / 2)
-          / Couwbat::GetSymbolDuration ();
+          unsigned int txDurationSymbols = (txDurationTime.GetMicroSeconds () + symbDuration / 2)
+          / symbDuration;
           NS_ASSERT (mh.m_ofdm_sym_len == txDurationSymbols);
 
           Simulator::Schedule (
@@ -691,8 +692,8 @@ SimpleCouwbatPhy::EndReceive (Ptr<Packet> packet, std::vector<Ptr<CouwbatInterfe
   double snrPersPerTotal = 0;
   double snrPersSnrTotal = 0;
   double snrPersSnrTotalMax = 0;
-  std::vector<double> allSnr = std::vector<double> (Couwbat::GetNumberOfSubchannels (), 0.0);
-  std::vector<double> allSnrMax = std::vector<double> (Couwbat::GetNumberOfSubchannels (), 0.0);
+  CouwbatSnrArray allSnr (0.0);
+  CouwbatSnrArray allSnrMax (0.0);
   NS_LOG_LOGIC ("receiving on subchannels=" << subchannels);
   for (uint32_t i = 0; i < events.size (); ++i)
     {
@@ -730,7 +731,7 @@ SimpleCouwbatPhy::EndReceive (Ptr<Packet> packet, std::vector<Ptr<CouwbatInterfe
           if (!Couwbat::m_sinrPerSubchannelCallbackEnableMacFilter
               || (Couwbat::m_sinrPerSubchannelCallbackEnableMacFilter
                   && header.GetSource () == Couwbat::m_sinrPerSubchannelCallbackMacFilterAddress))
-          Couwbat::sinrPerSubchannelCallback (allSnr, allSnrMax, snrPer.per);
+          Couwbat::sinrPerSubchannelCallback (allSnr.ToVector (), allSnrMax.ToVector (), snrPer.per);
         }
     }
 
@@ -828,7 +829,7 @@ void SimpleCouwbatPhy::SfTrigger (void)
 
   zeroSFpacket->AddHeader(mh);
   m_rxOkCallback(zeroSFpacket);
-  Simulator::Schedule (MicroSeconds(Couwbat::GetSuperframeDuration()),&SimpleCouwbatPhy::SfTrigger, this);
+  Simulator::Schedule (MicroSeconds (m_config->GetSuperframeDuration ()),&SimpleCouwbatPhy::SfTrigger, this);
 }
 
 void
@@ -14,6 +14,7 @@
 #include "couwbat-mode.h"
 //#include "wifi-phy-standard.h"
 #include "couwbat-intf-helper.h"
+#include "couwbat-subchannel-array.h"
 
 namespace ns3
 {
@@ -388,7 +389,7 @@ private:
   Ptr<UniformRandomVariable> m_random;  //!< Provides uniform random variables.
   double m_channelStartingFrequency;    //!< Standard-dependent center frequency of 0-th channel in MHz
   Ptr<CouwbatPhyStateHelper> m_state;      //!< Pointer to CouwbatPhyStateHelper
-  std::vector<Ptr<CouwbatInterferenceHelper> > m_interference;    //!< Pointer to interference helper for each subchannel
+  CouwbatSubchannelArray<Ptr<CouwbatInterferenceHelper> > m_interference;    //!< Pointer to interference helper for each subchannel
   Time m_channelSwitchDelay;            //!< Time required to switch between channel
 
 };
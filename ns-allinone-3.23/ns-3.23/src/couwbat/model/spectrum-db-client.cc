@@ -0,0 +1,328 @@
+#include "spectrum-db-client.h"
+#include "spectrum-map.h"
+#include "ns3/log.h"
+#include <poll.h>
+
+NS_LOG_COMPONENT_DEFINE ("SpectrumDbClient");
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED (SpectrumDbClient);
+
+TypeId
+SpectrumDbClient::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SpectrumDbClient")
+    .SetParent<Object> ()
+    .AddConstructor<SpectrumDbClient> ()
+    .SetGroupName ("Couwbat")
+    .AddAttribute ("SocketPath",
+                   "File system path of the Unix domain socket of the SpectrumDbServer.",
+                   StringValue ("/tmp/couwbat-spectrum-db.sock"),
+                   MakeStringAccessor (&SpectrumDbClient::m_socketPath),
+                   MakeStringChecker ())
+    .AddAttribute ("PollInterval",
+                   "Time between two polls of the socket while subscribed.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&SpectrumDbClient::m_pollInterval),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("SendTimeout",
+                   "Maximum wall clock time to wait until the server takes a request. "
+                   "The simulation is aborted if a request cannot be sent in time.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&SpectrumDbClient::m_sendTimeout),
+                   MakeTimeChecker (MilliSeconds (1)))
+    .AddTraceSource ("SubchannelsChanged",
+                     "Trace source indicating that subchannels became occupied or free "
+                     "according to the spectrum database server",
+                     MakeTraceSourceAccessor (&SpectrumDbClient::m_subchannelsChangedTrace),
+                     "ns3::SpectrumDb::SubchannelsChangedCallback")
+  ;
+  return tid;
+}
+
+SpectrumDbClient::SpectrumDbClient (void)
+  : m_subscribed (false),
+    m_hasSnapshot (false),
+    m_specVersion (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_specMap = CreateObject<SpectrumMap> ();
+}
+
+SpectrumDbClient::~SpectrumDbClient ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SpectrumDbClient::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Disconnect ();
+  m_specMap = 0;
+  Object::DoDispose ();
+}
+
+bool
+SpectrumDbClient::Connect (void)
+{
+  NS_LOG_FUNCTION (this);
+  int fd = SpectrumDbProtocol::Connect (m_socketPath);
+  if (fd < 0)
+    {
+      return false;
+    }
+  m_conn = Create<SpectrumDbProtocol::Connection> (fd);
+  NS_LOG_INFO ("Connected to the spectrum database at " << m_socketPath);
+  return true;
+}
+
+void
+SpectrumDbClient::Disconnect (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_pollEvent.Cancel ();
+  m_subscribed = false;
+  if (m_conn)
+    {
+      if (!m_conn->Flush (m_sendTimeout.GetMilliSeconds ()) && m_conn->IsOpen ())
+        {
+          NS_LOG_WARN ("Dropping " << m_conn->GetTxQueueSize () << " bytes of requests not taken by "
+                       << "the spectrum database at " << m_socketPath);
+        }
+      m_conn->Close ();
+      m_conn = 0;
+    }
+}
+
+bool
+SpectrumDbClient::IsConnected (void) const
+{
+  return m_conn && m_conn->IsOpen ();
+}
+
+void
+SpectrumDbClient::OccupySpectrum (Ptr<const SpectrumMap> map)
+{
+  NS_LOG_FUNCTION (this << map);
+  NS_ASSERT_MSG (m_conn, "SpectrumDbClient not connected");
+  std::vector<uint8_t> payload;
+  SpectrumDbProtocol::WriteMap (payload, map);
+  m_conn->Send (SpectrumDbProtocol::OCCUPY, payload);
+  Flush ();
+}
+
+void
+SpectrumDbClient::LeaveSpectrum (Ptr<const SpectrumMap> map)
+{
+  NS_LOG_FUNCTION (this << map);
+  NS_ASSERT_MSG (m_conn, "SpectrumDbClient not connected");
+  std::vector<uint8_t> payload;
+  SpectrumDbProtocol::WriteMap (payload, map);
+  m_conn->Send (SpectrumDbProtocol::LEAVE, payload);
+  Flush ();
+}
+
+void
+SpectrumDbClient::Query (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_conn, "SpectrumDbClient not connected");
+  m_conn->Send (SpectrumDbProtocol::QUERY, std::vector<uint8_t> ());
+  Flush ();
+}
+
+void
+SpectrumDbClient::Subscribe (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_conn, "SpectrumDbClient not connected");
+  if (m_subscribed)
+    {
+      return;
+    }
+  m_subscribed = true;
+  m_conn->Send (SpectrumDbProtocol::SUBSCRIBE, std::vector<uint8_t> ());
+  Flush ();
+  m_pollEvent = Simulator::ScheduleNow (&SpectrumDbClient::Poll, this);
+}
+
+bool
+SpectrumDbClient::IsSubscribed (void) const
+{
+  return m_subscribed;
+}
+
+void
+SpectrumDbClient::Flush (void)
+{
+  // A failed connection is noticed and handled by the next Receive
+  if (!m_conn->Flush (m_sendTimeout.GetMilliSeconds ()) && m_conn->IsOpen ())
+    {
+      NS_FATAL_ERROR ("The spectrum database at " << m_socketPath << " did not take a request within "
+                      << m_sendTimeout.GetSeconds () << " s");
+    }
+}
+
+void
+SpectrumDbClient::Poll (void)
+{
+  Receive (Time (0));
+  if (m_subscribed)
+    {
+      m_pollEvent = Simulator::Schedule (m_pollInterval, &SpectrumDbClient::Poll, this);
+    }
+}
+
+uint32_t
+SpectrumDbClient::Receive (Time timeout)
+{
+  if (!m_conn)
+    {
+      return 0;
+    }
+
+  if (timeout > Time (0) && m_conn->IsOpen ())
+    {
+      struct pollfd pfd;
+      pfd.fd = m_conn->GetFd ();
+      pfd.events = POLLIN;
+      poll (&pfd, 1, timeout.GetMilliSeconds ());
+    }
+
+  m_conn->Receive ();
+  uint32_t count = 0;
+  uint8_t type;
+  std::vector<uint8_t> payload;
+  while (m_conn->Next (type, payload))
+    {
+      Handle (type, payload);
+      ++count;
+    }
+
+  // Also closed by Handle on an invalid message
+  if (!m_conn->IsOpen ())
+    {
+      LoseConnection ();
+    }
+  return count;
+}
+
+void
+SpectrumDbClient::LoseConnection (void)
+{
+  NS_LOG_WARN ("Lost the connection to the spectrum database at " << m_socketPath);
+  m_pollEvent.Cancel ();
+  m_subscribed = false;
+  m_conn = 0;
+
+  // Without the database no subchannel may be considered free
+  const std::bitset<Couwbat::MAX_SUBCHANS> becameBusy = m_free;
+  m_free.reset ();
+  m_hasSnapshot = false;
+  if (becameBusy.any ())
+    {
+      m_subchannelsChangedTrace (becameBusy, std::bitset<Couwbat::MAX_SUBCHANS> ());
+    }
+}
+
+void
+SpectrumDbClient::Handle (uint8_t type, const std::vector<uint8_t> &payload)
+{
+  NS_LOG_FUNCTION (this << (uint32_t) type);
+  const std::bitset<Couwbat::MAX_SUBCHANS> before = m_free;
+  // Decode into locals, a rejected message must not change the state
+  uint32_t offset = 0;
+  uint32_t version;
+  bool ok = false;
+  switch (type)
+    {
+    case SpectrumDbProtocol::SNAPSHOT:
+      {
+        std::bitset<Couwbat::MAX_SUBCHANS> free;
+        Ptr<SpectrumMap> map;
+        ok = SpectrumDbProtocol::ReadU32 (payload, offset, version)
+          && SpectrumDbProtocol::ReadSubchannels (payload, offset, free)
+          && (map = SpectrumDbProtocol::ReadMap (payload, offset));
+        if (ok)
+          {
+            m_specVersion = version;
+            m_free = free;
+            m_specMap = map;
+            m_hasSnapshot = true;
+          }
+      }
+      break;
+
+    case SpectrumDbProtocol::DELTA:
+      {
+        std::bitset<Couwbat::MAX_SUBCHANS> becameBusy;
+        std::bitset<Couwbat::MAX_SUBCHANS> becameFree;
+        ok = SpectrumDbProtocol::ReadU32 (payload, offset, version)
+          && SpectrumDbProtocol::ReadSubchannels (payload, offset, becameBusy)
+          && SpectrumDbProtocol::ReadSubchannels (payload, offset, becameFree);
+        if (ok)
+          {
+            // Snapshots of m_specMap handed out by GetOccupiedSpectrum are never modified
+            if (m_specMap->GetReferenceCount () > 1)
+              {
+                m_specMap = CopyObject (m_specMap);
+              }
+            // Leaves m_specMap unchanged if it fails
+            ok = SpectrumDbProtocol::ReadMapDelta (payload, offset, m_specMap);
+          }
+        if (ok)
+          {
+            m_specVersion = version;
+            if (m_hasSnapshot)
+              {
+                m_free = (m_free & ~becameBusy) | becameFree;
+              }
+          }
+      }
+      break;
+
+    default:
+      break;
+    }
+
+  if (!ok)
+    {
+      NS_LOG_WARN ("Invalid message of type " << (uint32_t) type << " from the spectrum database, closing the connection");
+      m_conn->Close ();
+      return;
+    }
+
+  if (before != m_free)
+    {
+      m_subchannelsChangedTrace (before & ~m_free, m_free & ~before);
+    }
+}
+
+bool
+SpectrumDbClient::HasSnapshot (void) const
+{
+  return m_hasSnapshot;
+}
+
+Ptr<const SpectrumMap>
+SpectrumDbClient::GetOccupiedSpectrum (void) const
+{
+  return m_specMap;
+}
+
+uint32_t
+SpectrumDbClient::GetSpectrumVersion (void) const
+{
+  return m_specVersion;
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumDbClient::GetFreeSubchannels (void) const
+{
+  return m_free;
+}
+
+} // namespace ns3
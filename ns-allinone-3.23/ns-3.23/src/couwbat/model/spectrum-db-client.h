@@ -0,0 +1,167 @@
+#ifndef SPECTRUM_DB_CLIENT_H
+#define SPECTRUM_DB_CLIENT_H
+
+#include "ns3/core-module.h"
+#include "ns3/traced-callback.h"
+#include "couwbat.h"
+#include "spectrum-db-protocol.h"
+#include <bitset>
+#include <string>
+
+namespace ns3
+{
+
+class SpectrumMap;
+
+/**
+ * \brief Access to a SpectrumDb in another process through a SpectrumDbServer.
+ * \ingroup couwbat
+ *
+ * The client connects to the Unix domain socket of a SpectrumDbServer. Primary user
+ * emulators use OccupySpectrum and LeaveSpectrum. A SpectrumManager whose spectrum
+ * database is a SpectrumDbClient subscribes to the occupied spectrum: the client keeps
+ * a copy of the occupied spectrum map and of the free subchannels, applies the deltas
+ * published by the server and fires SubchannelsChanged like the SpectrumDb does.
+ *
+ * Inside a simulation the socket is polled by a simulator event every PollInterval
+ * while subscribed. Processes without a simulation call Receive instead.
+ *
+ * Until the first snapshot has been received no subchannel is considered free.
+ */
+class SpectrumDbClient : public Object
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+  SpectrumDbClient (void); //!< Default constructor
+  ~SpectrumDbClient (); //!< Destructor
+
+  /**
+   * Connect to the server at SocketPath.
+   * \return False if the connection failed.
+   */
+  bool Connect (void);
+
+  /**
+   * Close the connection after sending all queued requests, waiting at most
+   * SendTimeout for the server to take them.
+   * The server leaves the spectrum still occupied by this client.
+   */
+  void Disconnect (void);
+
+  /**
+   * \return True while connected to the server.
+   */
+  bool IsConnected (void) const;
+
+  /**
+   * Inform the database about the spectrum being used.
+   * \param map A map of the spectrum being used.
+   */
+  void OccupySpectrum (Ptr<const SpectrumMap> map);
+
+  /**
+   * Inform the database about the spectrum to free.
+   * \param map A map of the spectrum to free, as passed to OccupySpectrum before.
+   */
+  void LeaveSpectrum (Ptr<const SpectrumMap> map);
+
+  /**
+   * Request a single snapshot of the occupied spectrum, it is available after
+   * the next Receive.
+   */
+  void Query (void);
+
+  /**
+   * Request a snapshot and all later changes of the occupied spectrum. Starts
+   * polling the socket if a simulation is used.
+   */
+  void Subscribe (void);
+
+  /**
+   * \return True if Subscribe has been called.
+   */
+  bool IsSubscribed (void) const;
+
+  /**
+   * Handle the messages received from the server.
+   * \param timeout Maximum time to wait for the first message, zero to only
+   *   handle the messages already received. Waits in wall clock time.
+   * \return The number of handled messages.
+   */
+  uint32_t Receive (Time timeout);
+
+  /**
+   * \return True once the first snapshot has been received.
+   */
+  bool HasSnapshot (void) const;
+
+  /**
+   * \return The occupied spectrum as of the last received snapshot or delta.
+   */
+  Ptr<const SpectrumMap> GetOccupiedSpectrum (void) const;
+
+  /**
+   * \return The spectrum version of the database as of the last received snapshot or delta.
+   */
+  uint32_t GetSpectrumVersion (void) const;
+
+  /**
+   * \return The subchannels which are not occupied by primary users, as of the last
+   *   received snapshot or delta. None before the first snapshot.
+   */
+  std::bitset<Couwbat::MAX_SUBCHANS> GetFreeSubchannels (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Write the queued requests, waiting at most SendTimeout.
+   */
+  void Flush (void);
+
+  /**
+   * Receive without waiting and reschedule.
+   */
+  void Poll (void);
+
+  /**
+   * Forget the connection and the received state, as if the server never sent
+   * anything. Called once the connection is closed.
+   */
+  void LoseConnection (void);
+
+  /**
+   * Handle a SNAPSHOT or DELTA. An invalid message closes the connection
+   * without changing the state.
+   * \param type The MessageType.
+   * \param payload The payload.
+   */
+  void Handle (uint8_t type, const std::vector<uint8_t> &payload);
+
+  std::string m_socketPath; //!< File system path of the server socket
+  Time m_pollInterval; //!< Time between two polls of the socket while subscribed
+  Time m_sendTimeout; //!< Maximum time to wait until the server takes a request
+  Ptr<SpectrumDbProtocol::Connection> m_conn; //!< Connection to the server
+  EventId m_pollEvent; //!< The next poll
+  bool m_subscribed; //!< True if Subscribe has been called
+
+  bool m_hasSnapshot; //!< True once a SNAPSHOT has been received
+  Ptr<SpectrumMap> m_specMap; //!< Copy of the occupied spectrum
+  uint32_t m_specVersion; //!< Version of m_specMap
+  std::bitset<Couwbat::MAX_SUBCHANS> m_free; //!< Free subchannels of m_specMap
+
+  /**
+   * The trace source fired when subchannels became busy or free according to the server.
+   * Parameters are the subchannels that became busy and those that became free.
+   */
+  TracedCallback<std::bitset<Couwbat::MAX_SUBCHANS>, std::bitset<Couwbat::MAX_SUBCHANS> > m_subchannelsChangedTrace;
+};
+
+} // namespace ns3
+
+#endif /* SPECTRUM_DB_CLIENT_H */
@@ -0,0 +1,447 @@
+#include "spectrum-db-protocol.h"
+#include "spectrum-map.h"
+#include "ns3/log.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("SpectrumDbProtocol");
+
+namespace ns3
+{
+
+SpectrumDbProtocol::Connection::Connection (int fd)
+  : m_fd (fd)
+{
+  NS_LOG_FUNCTION (this << fd);
+  int flags = fcntl (m_fd, F_GETFL, 0);
+  fcntl (m_fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+SpectrumDbProtocol::Connection::~Connection ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+int
+SpectrumDbProtocol::Connection::GetFd (void) const
+{
+  return m_fd;
+}
+
+bool
+SpectrumDbProtocol::Connection::IsOpen (void) const
+{
+  return m_fd >= 0;
+}
+
+void
+SpectrumDbProtocol::Connection::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fd >= 0)
+    {
+      close (m_fd);
+      m_fd = -1;
+    }
+  m_rx.clear ();
+  m_tx.clear ();
+}
+
+bool
+SpectrumDbProtocol::Connection::Send (uint8_t type, const std::vector<uint8_t> &payload)
+{
+  NS_LOG_FUNCTION (this << (uint32_t) type << payload.size ());
+  if (!IsOpen ())
+    {
+      return false;
+    }
+  MessageHeader header;
+  header.magic = MAGIC;
+  header.type = type;
+  header.reserved = 0;
+  header.length = payload.size ();
+  const uint8_t *h = reinterpret_cast<const uint8_t *> (&header);
+  m_tx.insert (m_tx.end (), h, h + sizeof (header));
+  m_tx.insert (m_tx.end (), payload.begin (), payload.end ());
+  return Flush (0);
+}
+
+bool
+SpectrumDbProtocol::Connection::Flush (int64_t timeoutMs)
+{
+  SystemWallClockMs clock;
+  clock.Start ();
+  uint32_t written = 0;
+  bool timedOut = false;
+  while (IsOpen () && written < m_tx.size ())
+    {
+      ssize_t n = send (m_fd, &m_tx[written], m_tx.size () - written, MSG_NOSIGNAL);
+      if (n > 0)
+        {
+          written += n;
+        }
+      else if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+          const int64_t left = timeoutMs - clock.End ();
+          if (left <= 0)
+            {
+              timedOut = timeoutMs > 0;
+              break;
+            }
+          struct pollfd pfd;
+          pfd.fd = m_fd;
+          pfd.events = POLLOUT;
+          poll (&pfd, 1, left);
+        }
+      else
+        {
+          NS_LOG_WARN ("Sending on socket " << m_fd << " failed: " << std::strerror (errno));
+          Close ();
+          return false;
+        }
+    }
+  m_tx.erase (m_tx.begin (), m_tx.begin () + written);
+  if (timedOut)
+    {
+      NS_LOG_WARN ("Socket " << m_fd << " did not accept " << m_tx.size () << " queued bytes within "
+                   << timeoutMs << " ms");
+      return false;
+    }
+  return IsOpen ();
+}
+
+uint32_t
+SpectrumDbProtocol::Connection::GetTxQueueSize (void) const
+{
+  return m_tx.size ();
+}
+
+bool
+SpectrumDbProtocol::Connection::Receive (void)
+{
+  uint8_t buf[4096];
+  while (IsOpen ())
+    {
+      ssize_t n = recv (m_fd, buf, sizeof (buf), 0);
+      if (n > 0)
+        {
+          m_rx.insert (m_rx.end (), buf, buf + n);
+        }
+      else if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+          return true;
+        }
+      else
+        {
+          if (n < 0)
+            {
+              NS_LOG_WARN ("Receiving on socket " << m_fd << " failed: " << std::strerror (errno));
+            }
+          // Keep the received messages readable, but no more bytes will arrive
+          close (m_fd);
+          m_fd = -1;
+          return false;
+        }
+    }
+  return false;
+}
+
+bool
+SpectrumDbProtocol::Connection::Next (uint8_t &type, std::vector<uint8_t> &payload)
+{
+  if (m_rx.size () < sizeof (MessageHeader))
+    {
+      return false;
+    }
+  MessageHeader header;
+  std::memcpy (&header, &m_rx[0], sizeof (header));
+  if (header.magic != MAGIC || header.length > MAX_PAYLOAD)
+    {
+      NS_LOG_WARN ("Invalid message header on socket " << m_fd << ", closing the connection");
+      Close ();
+      return false;
+    }
+  if (m_rx.size () < sizeof (header) + header.length)
+    {
+      return false;
+    }
+  type = header.type;
+  payload.assign (m_rx.begin () + sizeof (header), m_rx.begin () + sizeof (header) + header.length);
+  m_rx.erase (m_rx.begin (), m_rx.begin () + sizeof (header) + header.length);
+  return true;
+}
+
+int
+SpectrumDbProtocol::Listen (const std::string &path)
+{
+  NS_LOG_FUNCTION (path);
+  struct sockaddr_un addr;
+  if (path.size () >= sizeof (addr.sun_path))
+    {
+      NS_LOG_ERROR ("Socket path " << path << " is too long");
+      return -1;
+    }
+  std::memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy (addr.sun_path, path.c_str (), sizeof (addr.sun_path) - 1);
+
+  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Cannot create socket: " << std::strerror (errno));
+      return -1;
+    }
+  if (!Unlink (path))
+    {
+      close (fd);
+      return -1;
+    }
+  if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (fd, 16) < 0)
+    {
+      NS_LOG_ERROR ("Cannot listen on " << path << ": " << std::strerror (errno));
+      close (fd);
+      return -1;
+    }
+  int flags = fcntl (fd, F_GETFL, 0);
+  fcntl (fd, F_SETFL, flags | O_NONBLOCK);
+  return fd;
+}
+
+bool
+SpectrumDbProtocol::Unlink (const std::string &path)
+{
+  NS_LOG_FUNCTION (path);
+  struct stat st;
+  if (lstat (path.c_str (), &st) < 0)
+    {
+      return errno == ENOENT;
+    }
+  if (!S_ISSOCK (st.st_mode))
+    {
+      NS_LOG_ERROR ("Cannot use " << path << " as socket path, it exists and is not a socket");
+      return false;
+    }
+  if (unlink (path.c_str ()) < 0)
+    {
+      NS_LOG_ERROR ("Cannot remove the socket " << path << ": " << std::strerror (errno));
+      return false;
+    }
+  return true;
+}
+
+int
+SpectrumDbProtocol::Connect (const std::string &path)
+{
+  NS_LOG_FUNCTION (path);
+  struct sockaddr_un addr;
+  if (path.size () >= sizeof (addr.sun_path))
+    {
+      NS_LOG_ERROR ("Socket path " << path << " is too long");
+      return -1;
+    }
+  std::memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy (addr.sun_path, path.c_str (), sizeof (addr.sun_path) - 1);
+
+  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Cannot create socket: " << std::strerror (errno));
+      return -1;
+    }
+  if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot connect to " << path << ": " << std::strerror (errno));
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+void
+SpectrumDbProtocol::WriteU32 (std::vector<uint8_t> &buf, uint32_t value)
+{
+  const uint8_t *p = reinterpret_cast<const uint8_t *> (&value);
+  buf.insert (buf.end (), p, p + sizeof (value));
+}
+
+void
+SpectrumDbProtocol::WriteU64 (std::vector<uint8_t> &buf, uint64_t value)
+{
+  const uint8_t *p = reinterpret_cast<const uint8_t *> (&value);
+  buf.insert (buf.end (), p, p + sizeof (value));
+}
+
+void
+SpectrumDbProtocol::WriteSubchannels (std::vector<uint8_t> &buf, const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels)
+{
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < Couwbat::MAX_SUBCHANS && i < 64; ++i)
+    {
+      if (subchannels.test (i))
+        {
+          word |= 1ULL << i;
+        }
+    }
+  WriteU64 (buf, word);
+}
+
+void
+SpectrumDbProtocol::WriteMap (std::vector<uint8_t> &buf, Ptr<const SpectrumMap> map)
+{
+  WriteU32 (buf, map->m_size);
+  for (uint32_t w = 0; w < map->m_words.size (); ++w)
+    {
+      WriteU64 (buf, map->m_words[w]);
+    }
+}
+
+bool
+SpectrumDbProtocol::ReadU32 (const std::vector<uint8_t> &buf, uint32_t &offset, uint32_t &value)
+{
+  if (buf.size () < offset + sizeof (value))
+    {
+      return false;
+    }
+  std::memcpy (&value, &buf[offset], sizeof (value));
+  offset += sizeof (value);
+  return true;
+}
+
+bool
+SpectrumDbProtocol::ReadU64 (const std::vector<uint8_t> &buf, uint32_t &offset, uint64_t &value)
+{
+  if (buf.size () < offset + sizeof (value))
+    {
+      return false;
+    }
+  std::memcpy (&value, &buf[offset], sizeof (value));
+  offset += sizeof (value);
+  return true;
+}
+
+bool
+SpectrumDbProtocol::ReadSubchannels (const std::vector<uint8_t> &buf, uint32_t &offset, std::bitset<Couwbat::MAX_SUBCHANS> &subchannels)
+{
+  uint64_t word;
+  if (!ReadU64 (buf, offset, word))
+    {
+      return false;
+    }
+  subchannels.reset ();
+  for (uint32_t i = 0; i < Couwbat::MAX_SUBCHANS && i < 64; ++i)
+    {
+      subchannels.set (i, (word >> i) & 1);
+    }
+  return true;
+}
+
+Ptr<SpectrumMap>
+SpectrumDbProtocol::ReadMap (const std::vector<uint8_t> &buf, uint32_t &offset)
+{
+  uint32_t size;
+  if (!ReadU32 (buf, offset, size))
+    {
+      return 0;
+    }
+  Ptr<SpectrumMap> map = CreateObject<SpectrumMap> ();
+  if (size != map->m_size)
+    {
+      NS_LOG_WARN ("Received a map with " << size << " subcarriers, expected " << map->m_size);
+      return 0;
+    }
+  for (uint32_t w = 0; w < map->m_words.size (); ++w)
+    {
+      if (!ReadU64 (buf, offset, map->m_words[w]))
+        {
+          return 0;
+        }
+    }
+  if (size % 64 && (map->m_words.back () >> (size % 64)))
+    {
+      NS_LOG_WARN ("Received a map with bits set beyond the last subcarrier");
+      return 0;
+    }
+  return map;
+}
+
+void
+SpectrumDbProtocol::WriteMapDelta (std::vector<uint8_t> &buf, Ptr<const SpectrumMap> from, Ptr<const SpectrumMap> to)
+{
+  NS_ASSERT (from->m_words.size () == to->m_words.size ());
+  const uint32_t countOffset = buf.size ();
+  uint32_t count = 0;
+  WriteU32 (buf, count);
+  for (uint32_t w = 0; w < to->m_words.size (); ++w)
+    {
+      const uint64_t diff = from->m_words[w] ^ to->m_words[w];
+      if (diff)
+        {
+          WriteU32 (buf, w);
+          WriteU64 (buf, diff);
+          ++count;
+        }
+    }
+  std::memcpy (&buf[countOffset], &count, sizeof (count));
+}
+
+bool
+SpectrumDbProtocol::ReadMapDelta (const std::vector<uint8_t> &buf, uint32_t &offset, Ptr<SpectrumMap> map)
+{
+  // Validate all words before changing any, so a rejected delta leaves map as it was
+  uint32_t end = offset;
+  uint32_t count;
+  if (!ReadU32 (buf, end, count))
+    {
+      return false;
+    }
+  const uint32_t last = map->m_words.size () - 1;
+  uint64_t lastWord = map->m_words[last];
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      uint32_t w;
+      uint64_t diff;
+      if (!ReadU32 (buf, end, w) || !ReadU64 (buf, end, diff) || w > last)
+        {
+          return false;
+        }
+      if (w == last)
+        {
+          lastWord ^= diff;
+        }
+    }
+  if (map->m_size % 64 && (lastWord >> (map->m_size % 64)))
+    {
+      NS_LOG_WARN ("Received a delta with bits set beyond the last subcarrier");
+      return false;
+    }
+
+  ReadU32 (buf, offset, count);
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      uint32_t w;
+      uint64_t diff;
+      ReadU32 (buf, offset, w);
+      ReadU64 (buf, offset, diff);
+      map->m_words[w] ^= diff;
+    }
+  return true;
+}
+
+} // namespace ns3
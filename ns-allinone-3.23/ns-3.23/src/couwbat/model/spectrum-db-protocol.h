@@ -0,0 +1,209 @@
+#ifndef SPECTRUM_DB_PROTOCOL_H
+#define SPECTRUM_DB_PROTOCOL_H
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "couwbat.h"
+#include <bitset>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumMap;
+
+/**
+ * \brief Binary protocol between SpectrumDbServer and SpectrumDbClient.
+ * \ingroup couwbat
+ *
+ * Every message is a MessageHeader followed by length bytes of payload. All
+ * fields are in host byte order, the protocol is meant for Unix domain sockets
+ * between processes on the same machine only.
+ *
+ * Client to server:
+ *  - OCCUPY, LEAVE: a spectrum map
+ *  - QUERY: no payload, answered by a SNAPSHOT
+ *  - SUBSCRIBE: no payload, answered by a SNAPSHOT, followed by a DELTA on every change
+ *
+ * Server to client:
+ *  - SNAPSHOT: version (uint32_t), free subchannels (uint64_t), spectrum map
+ *  - DELTA: version (uint32_t), subchannels that became busy (uint64_t), subchannels
+ *    that became free (uint64_t), number of changed words (uint32_t), then for
+ *    each changed word its index (uint32_t) and the XOR with the previous word (uint64_t)
+ *
+ * A spectrum map is the number of subcarriers (uint32_t) followed by the 64 bit
+ * words of the SpectrumMap. Both ends must use the same number of subcarriers.
+ */
+class SpectrumDbProtocol
+{
+public:
+  /** \enum MessageType
+   * Types of the protocol messages
+   */
+  enum MessageType
+  {
+    OCCUPY = 1, //!< occupy the spectrum of a primary user
+    LEAVE = 2, //!< leave the spectrum of a primary user
+    QUERY = 3, //!< request a single SNAPSHOT
+    SUBSCRIBE = 4, //!< request a SNAPSHOT and DELTAs on every change
+    SNAPSHOT = 5, //!< the complete occupied spectrum
+    DELTA = 6 //!< the changes of the occupied spectrum since the last SNAPSHOT or DELTA
+  };
+
+  static const uint16_t MAGIC = 0xdb5c; //!< First field of every message
+  static const uint32_t MAX_PAYLOAD = 1 << 20; //!< Messages with a longer payload are rejected
+
+  /** \struct MessageHeader
+   * Header of every message
+   */
+  struct MessageHeader
+  {
+    uint16_t magic; //!< MAGIC
+    uint8_t type; //!< MessageType
+    uint8_t reserved; //!< Zero
+    uint32_t length; //!< Payload length in bytes
+  };
+
+  /**
+   * \brief One end of a connection on a non-blocking stream socket.
+   *
+   * Outgoing messages are buffered and written as far as the socket accepts them,
+   * incoming bytes are buffered until a complete message has been received.
+   * The socket is closed on destruction.
+   */
+  class Connection : public SimpleRefCount<Connection>
+  {
+  public:
+    /**
+     * \param fd A connected stream socket, set to non-blocking by the constructor.
+     */
+    Connection (int fd);
+    ~Connection ();
+
+    /**
+     * \return The socket, -1 if closed
+     */
+    int GetFd (void) const;
+
+    /**
+     * \return True until the connection has been closed or failed.
+     */
+    bool IsOpen (void) const;
+
+    /**
+     * Close the socket.
+     */
+    void Close (void);
+
+    /**
+     * Queue a message and write as much of the queue as possible.
+     * \param type The MessageType.
+     * \param payload The payload.
+     * \return False if the connection failed.
+     */
+    bool Send (uint8_t type, const std::vector<uint8_t> &payload);
+
+    /**
+     * Write the queued messages.
+     * \param timeoutMs Maximum wall clock time in milliseconds to wait until
+     *   everything has been written, zero to only write what the socket takes
+     *   without waiting.
+     * \return False if the connection failed or the queue could not be written
+     *   within timeoutMs. The connection stays open after a timeout.
+     */
+    bool Flush (int64_t timeoutMs);
+
+    /**
+     * \return The number of queued bytes not yet written.
+     */
+    uint32_t GetTxQueueSize (void) const;
+
+    /**
+     * Read all bytes available on the socket.
+     * \return False if the peer closed the connection or the connection failed.
+     */
+    bool Receive (void);
+
+    /**
+     * Take the next complete message out of the receive buffer.
+     * Closes the connection if the received bytes are not a valid message.
+     * \param type The MessageType of the message.
+     * \param payload The payload of the message.
+     * \return True if a message has been returned.
+     */
+    bool Next (uint8_t &type, std::vector<uint8_t> &payload);
+
+  private:
+    Connection (const Connection &); //!< Not copyable
+    Connection &operator = (const Connection &); //!< Not copyable
+
+    int m_fd; //!< The socket
+    std::vector<uint8_t> m_rx; //!< Received bytes not yet taken by Next
+    std::vector<uint8_t> m_tx; //!< Queued bytes not yet written
+  };
+
+  /**
+   * Create a Unix domain stream socket listening on path. An existing socket
+   * file at path is removed first, any other file is left alone and makes
+   * Listen fail.
+   * \param path The file system path of the socket.
+   * \return The non-blocking socket, -1 on error
+   */
+  static int Listen (const std::string &path);
+
+  /**
+   * Remove the socket file at path.
+   * \param path The file system path of the socket.
+   * \return True if path is gone, false if it is not a socket or cannot be removed.
+   */
+  static bool Unlink (const std::string &path);
+
+  /**
+   * Connect to a Unix domain stream socket.
+   * \param path The file system path of the socket.
+   * \return The connected socket, -1 on error
+   */
+  static int Connect (const std::string &path);
+
+  /**
+   * \name Payload encoding
+   * The Read functions advance offset and return false if the payload is too short.
+   */
+  //\{
+  static void WriteU32 (std::vector<uint8_t> &buf, uint32_t value);
+  static void WriteU64 (std::vector<uint8_t> &buf, uint64_t value);
+  static void WriteSubchannels (std::vector<uint8_t> &buf, const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels);
+  static void WriteMap (std::vector<uint8_t> &buf, Ptr<const SpectrumMap> map);
+  static bool ReadU32 (const std::vector<uint8_t> &buf, uint32_t &offset, uint32_t &value);
+  static bool ReadU64 (const std::vector<uint8_t> &buf, uint32_t &offset, uint64_t &value);
+  static bool ReadSubchannels (const std::vector<uint8_t> &buf, uint32_t &offset, std::bitset<Couwbat::MAX_SUBCHANS> &subchannels);
+  /**
+   * \return The map, 0 if the payload is too short or the map does not have
+   *   Couwbat::GetNumberOfSubcarriers() subcarriers
+   */
+  static Ptr<SpectrumMap> ReadMap (const std::vector<uint8_t> &buf, uint32_t &offset);
+  //\}
+
+  /**
+   * Append the words in which two maps differ, as in the DELTA message.
+   * \param buf The payload to append to.
+   * \param from The previous map.
+   * \param to The current map.
+   */
+  static void WriteMapDelta (std::vector<uint8_t> &buf, Ptr<const SpectrumMap> from, Ptr<const SpectrumMap> to);
+
+  /**
+   * Apply the changed words of a DELTA message.
+   * \param buf The payload.
+   * \param offset Position of the number of changed words, advanced past the words.
+   * \param map The map to change, unchanged if the delta is rejected.
+   * \return False if the payload is too short, a word index is out of range
+   *   or a bit beyond the last subcarrier would be set.
+   */
+  static bool ReadMapDelta (const std::vector<uint8_t> &buf, uint32_t &offset, Ptr<SpectrumMap> map);
+};
+
+} // namespace ns3
+
+#endif /* SPECTRUM_DB_PROTOCOL_H */
@@ -0,0 +1,309 @@
+#include "spectrum-db-server.h"
+#include "spectrum-db.h"
+#include "spectrum-map.h"
+#include "ns3/log.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("SpectrumDbServer");
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED (SpectrumDbServer);
+
+TypeId
+SpectrumDbServer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SpectrumDbServer")
+    .SetParent<Object> ()
+    .AddConstructor<SpectrumDbServer> ()
+    .SetGroupName ("Couwbat")
+    .AddAttribute ("SocketPath",
+                   "File system path of the Unix domain socket to listen on.",
+                   StringValue ("/tmp/couwbat-spectrum-db.sock"),
+                   MakeStringAccessor (&SpectrumDbServer::m_socketPath),
+                   MakeStringChecker ())
+    .AddAttribute ("PollInterval",
+                   "Time between two polls of the sockets.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&SpectrumDbServer::m_pollInterval),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("MaxTxQueue",
+                   "Subscribers that do not read and have more unsent bytes than this are disconnected.",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&SpectrumDbServer::m_maxTxQueue),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+SpectrumDbServer::SpectrumDbServer (void)
+  : m_maxTxQueue (1 << 20),
+    m_listenFd (-1),
+    m_publishedVersion (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SpectrumDbServer::~SpectrumDbServer ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SpectrumDbServer::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+  m_specDb = 0;
+  m_published = 0;
+  Object::DoDispose ();
+}
+
+void
+SpectrumDbServer::SetSpectrumDb (Ptr<SpectrumDb> specDb)
+{
+  NS_LOG_FUNCTION (this << specDb);
+  m_specDb = specDb;
+}
+
+void
+SpectrumDbServer::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (!m_specDb, "SpectrumDbServer started without a spectrum database");
+  if (m_listenFd >= 0)
+    {
+      return;
+    }
+
+  m_listenFd = SpectrumDbProtocol::Listen (m_socketPath);
+  NS_ABORT_MSG_IF (m_listenFd < 0, "SpectrumDbServer cannot listen on " << m_socketPath);
+  NS_LOG_INFO ("Spectrum database listening on " << m_socketPath);
+
+  m_published = m_specDb->GetOccupiedSpectrum ();
+  m_publishedVersion = m_specDb->GetSpectrumVersion ();
+  m_publishedFree = m_specDb->GetFreeSubchannels ();
+  m_specDb->TraceConnectWithoutContext ("SubchannelsChanged",
+                                        MakeCallback (&SpectrumDbServer::NotifySubchannelsChanged, this));
+  m_pollEvent = Simulator::ScheduleNow (&SpectrumDbServer::Poll, this);
+}
+
+void
+SpectrumDbServer::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_listenFd < 0)
+    {
+      return;
+    }
+
+  m_pollEvent.Cancel ();
+  for (std::vector<Client>::iterator it = m_clients.begin (); it != m_clients.end (); ++it)
+    {
+      Drop (*it);
+    }
+  m_clients.clear ();
+  m_specDb->TraceDisconnectWithoutContext ("SubchannelsChanged",
+                                           MakeCallback (&SpectrumDbServer::NotifySubchannelsChanged, this));
+  close (m_listenFd);
+  m_listenFd = -1;
+  SpectrumDbProtocol::Unlink (m_socketPath);
+}
+
+uint32_t
+SpectrumDbServer::GetNClients (void) const
+{
+  return m_clients.size ();
+}
+
+void
+SpectrumDbServer::Poll (void)
+{
+  // Accept new clients
+  while (true)
+    {
+      int fd = accept (m_listenFd, 0, 0);
+      if (fd < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+              NS_LOG_WARN ("Accepting a client failed: " << std::strerror (errno));
+            }
+          break;
+        }
+      Client client;
+      client.conn = Create<SpectrumDbProtocol::Connection> (fd);
+      client.subscribed = false;
+      m_clients.push_back (client);
+      NS_LOG_INFO ("Client " << fd << " connected, " << m_clients.size () << " client(s)");
+    }
+
+  // Handle requests, a client that closed its connection may still have requests buffered
+  for (uint32_t i = 0; i < m_clients.size (); ++i)
+    {
+      Client &client = m_clients[i];
+      client.conn->Receive ();
+      uint8_t type;
+      std::vector<uint8_t> payload;
+      while (client.conn->Next (type, payload))
+        {
+          Handle (client, type, payload);
+        }
+      client.conn->Flush (0);
+    }
+
+  // Spectrum changes that did not change any subchannel do not fire NotifySubchannelsChanged
+  Publish ();
+
+  for (uint32_t i = 0; i < m_clients.size (); )
+    {
+      Client &client = m_clients[i];
+      if (client.conn->IsOpen () && client.conn->GetTxQueueSize () > m_maxTxQueue)
+        {
+          NS_LOG_WARN ("Client " << client.conn->GetFd () << " does not read, disconnecting");
+        }
+      else if (client.conn->IsOpen ())
+        {
+          ++i;
+          continue;
+        }
+      Drop (client);
+      m_clients.erase (m_clients.begin () + i);
+      NS_LOG_INFO ("Client disconnected, " << m_clients.size () << " client(s)");
+    }
+  // Leaving the spectrum of dropped clients changed the database
+  Publish ();
+
+  m_pollEvent = Simulator::Schedule (m_pollInterval, &SpectrumDbServer::Poll, this);
+}
+
+void
+SpectrumDbServer::Handle (Client &client, uint8_t type, const std::vector<uint8_t> &payload)
+{
+  NS_LOG_FUNCTION (this << client.conn->GetFd () << (uint32_t) type);
+  uint32_t offset = 0;
+  switch (type)
+    {
+    case SpectrumDbProtocol::OCCUPY:
+      {
+        Ptr<SpectrumMap> map = SpectrumDbProtocol::ReadMap (payload, offset);
+        if (!map)
+          {
+            NS_LOG_WARN ("Invalid OCCUPY from client " << client.conn->GetFd ());
+            client.conn->Close ();
+            return;
+          }
+        client.occupied.push_back (map);
+        m_specDb->OccupySpectrum (map);
+      }
+      break;
+
+    case SpectrumDbProtocol::LEAVE:
+      {
+        Ptr<SpectrumMap> map = SpectrumDbProtocol::ReadMap (payload, offset);
+        if (!map)
+          {
+            NS_LOG_WARN ("Invalid LEAVE from client " << client.conn->GetFd ());
+            client.conn->Close ();
+            return;
+          }
+        // Only spectrum occupied by the same client can be left
+        for (std::vector<Ptr<SpectrumMap> >::iterator it = client.occupied.begin (); it != client.occupied.end (); ++it)
+          {
+            if ((*it)->IsEqual (map))
+              {
+                client.occupied.erase (it);
+                m_specDb->LeaveSpectrum (map);
+                return;
+              }
+          }
+        NS_LOG_WARN ("Client " << client.conn->GetFd () << " leaves spectrum it did not occupy, ignored");
+      }
+      break;
+
+    case SpectrumDbProtocol::QUERY:
+      SendSnapshot (client);
+      break;
+
+    case SpectrumDbProtocol::SUBSCRIBE:
+      SendSnapshot (client);
+      client.subscribed = true;
+      break;
+
+    default:
+      NS_LOG_WARN ("Unknown message type " << (uint32_t) type << " from client " << client.conn->GetFd ());
+      client.conn->Close ();
+      break;
+    }
+}
+
+void
+SpectrumDbServer::SendSnapshot (Client &client)
+{
+  NS_LOG_FUNCTION (this << client.conn->GetFd ());
+  // The snapshot must be at the version of the last DELTA, which the subscriber receives next
+  Publish ();
+
+  std::vector<uint8_t> payload;
+  SpectrumDbProtocol::WriteU32 (payload, m_publishedVersion);
+  SpectrumDbProtocol::WriteSubchannels (payload, m_publishedFree);
+  SpectrumDbProtocol::WriteMap (payload, m_published);
+  client.conn->Send (SpectrumDbProtocol::SNAPSHOT, payload);
+}
+
+void
+SpectrumDbServer::Publish (void)
+{
+  if (m_specDb->GetSpectrumVersion () == m_publishedVersion)
+    {
+      return;
+    }
+
+  Ptr<const SpectrumMap> current = m_specDb->GetOccupiedSpectrum ();
+  const std::bitset<Couwbat::MAX_SUBCHANS> free = m_specDb->GetFreeSubchannels ();
+
+  std::vector<uint8_t> payload;
+  SpectrumDbProtocol::WriteU32 (payload, m_specDb->GetSpectrumVersion ());
+  SpectrumDbProtocol::WriteSubchannels (payload, m_publishedFree & ~free);
+  SpectrumDbProtocol::WriteSubchannels (payload, free & ~m_publishedFree);
+  SpectrumDbProtocol::WriteMapDelta (payload, m_published, current);
+
+  for (std::vector<Client>::iterator it = m_clients.begin (); it != m_clients.end (); ++it)
+    {
+      if (it->subscribed)
+        {
+          it->conn->Send (SpectrumDbProtocol::DELTA, payload);
+        }
+    }
+
+  m_published = current;
+  m_publishedVersion = m_specDb->GetSpectrumVersion ();
+  m_publishedFree = free;
+}
+
+void
+SpectrumDbServer::Drop (Client &client)
+{
+  NS_LOG_FUNCTION (this << client.conn->GetFd ());
+  for (std::vector<Ptr<SpectrumMap> >::iterator it = client.occupied.begin (); it != client.occupied.end (); ++it)
+    {
+      m_specDb->LeaveSpectrum (*it);
+    }
+  client.occupied.clear ();
+  client.subscribed = false;
+  client.conn->Close ();
+}
+
+void
+SpectrumDbServer::NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                            std::bitset<Couwbat::MAX_SUBCHANS> becameFree)
+{
+  NS_LOG_FUNCTION (this);
+  Publish ();
+}
+
+} // namespace ns3
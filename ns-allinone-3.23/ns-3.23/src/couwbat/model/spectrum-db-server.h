@@ -0,0 +1,133 @@
+#ifndef SPECTRUM_DB_SERVER_H
+#define SPECTRUM_DB_SERVER_H
+
+#include "ns3/core-module.h"
+#include "couwbat.h"
+#include "spectrum-db-protocol.h"
+#include <bitset>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumDb;
+class SpectrumMap;
+
+/**
+ * \brief Serves a SpectrumDb to other processes over a Unix domain socket.
+ * \ingroup couwbat
+ *
+ * Other processes (primary user emulators, the MAC of another simulation, monitoring)
+ * connect with a SpectrumDbClient and use the SpectrumDbProtocol to occupy and leave
+ * spectrum, to query the occupied spectrum and to subscribe to its changes.
+ *
+ * The socket is polled by a simulator event every PollInterval, so requests are
+ * handled in simulation time and in order with the rest of the simulation. To
+ * serve other processes in wall clock time, run the simulation with the
+ * ns3::RealtimeSimulatorImpl.
+ *
+ * Changes of the database are published to the subscribers as soon as they
+ * happen, no matter whether they were requested by a client or by a primary user
+ * inside the simulation. The spectrum occupied by a client is left when the
+ * client disconnects, so a crashed emulator does not block the spectrum forever.
+ */
+class SpectrumDbServer : public Object
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+  SpectrumDbServer (void); //!< Default constructor
+  ~SpectrumDbServer (); //!< Destructor
+
+  /**
+   * \param specDb The spectrum database to serve.
+   */
+  void SetSpectrumDb (Ptr<SpectrumDb> specDb);
+
+  /**
+   * Listen on SocketPath and start polling. Aborts if the socket cannot be created.
+   */
+  void Start (void);
+
+  /**
+   * Disconnect all clients, stop listening and remove the socket file.
+   */
+  void Stop (void);
+
+  /**
+   * \return The number of connected clients.
+   */
+  uint32_t GetNClients (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /** \struct Client
+   * State of one connected client
+   */
+  struct Client
+  {
+    Ptr<SpectrumDbProtocol::Connection> conn; //!< The connection
+    bool subscribed; //!< True if the client receives DELTAs
+    std::vector<Ptr<SpectrumMap> > occupied; //!< The maps occupied by the client and not left yet
+  };
+
+  /**
+   * Accept new clients, handle their requests and reschedule.
+   */
+  void Poll (void);
+
+  /**
+   * Handle one request of a client.
+   * \param client The client.
+   * \param type The MessageType.
+   * \param payload The payload.
+   */
+  void Handle (Client &client, uint8_t type, const std::vector<uint8_t> &payload);
+
+  /**
+   * Send the complete occupied spectrum to a client.
+   * \param client The client.
+   */
+  void SendSnapshot (Client &client);
+
+  /**
+   * Send a DELTA to all subscribers if the database changed since the last one.
+   */
+  void Publish (void);
+
+  /**
+   * Leave the spectrum still occupied by a client and close its connection.
+   * \param client The client.
+   */
+  void Drop (Client &client);
+
+  /**
+   * Called by the database when subchannels became busy or free.
+   * \param becameBusy The subchannels that became occupied.
+   * \param becameFree The subchannels that became free.
+   */
+  void NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                 std::bitset<Couwbat::MAX_SUBCHANS> becameFree);
+
+  Ptr<SpectrumDb> m_specDb; //!< The served database
+  std::string m_socketPath; //!< File system path of the listening socket
+  Time m_pollInterval; //!< Time between two polls of the sockets
+  uint32_t m_maxTxQueue; //!< Subscribers with more unsent bytes are dropped
+  int m_listenFd; //!< The listening socket, -1 if not started
+  EventId m_pollEvent; //!< The next poll
+  std::vector<Client> m_clients; //!< The connected clients
+
+  Ptr<const SpectrumMap> m_published; //!< The map of the last published SNAPSHOT or DELTA
+  uint32_t m_publishedVersion; //!< Spectrum version of m_published
+  std::bitset<Couwbat::MAX_SUBCHANS> m_publishedFree; //!< Free subchannels of m_published
+};
+
+} // namespace ns3
+
+#endif /* SPECTRUM_DB_SERVER_H */
@@ -1,6 +1,8 @@
 #include "spectrum-db.h"
 #include "spectrum-map.h"
 #include "ns3/log.h"
+#include "ns3/enum.h"
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("SpectrumDb");
 
@@ -16,16 +18,37 @@ SpectrumDb::GetTypeId (void)
     .SetParent<Object> ()
     .AddConstructor<SpectrumDb> ()
     .SetGroupName("Couwbat")
+    .AddAttribute ("CrBsPartitionPolicy",
+                   "Policy for partitioning the subchannels not occupied by primary users "
+                   "between the registered CR-BSs.",
+                   EnumValue (SpectrumDb::CRBS_PARTITION_NONE),
+                   MakeEnumAccessor (&SpectrumDb::SetCrBsPartitionPolicy,
+                                     &SpectrumDb::GetCrBsPartitionPolicy),
+                   MakeEnumChecker (SpectrumDb::CRBS_PARTITION_NONE, "None",
+                                    SpectrumDb::CRBS_PARTITION_STATIC, "Static",
+                                    SpectrumDb::CRBS_PARTITION_LOAD, "Load",
+                                    SpectrumDb::CRBS_PARTITION_COLORING, "Coloring"))
+    .AddTraceSource ("SubchannelsChanged",
+                     "Trace source indicating that subchannels became occupied or free "
+                     "by the arrival or departure of primary users",
+                     MakeTraceSourceAccessor (&SpectrumDb::m_subchannelsChangedTrace),
+                     "ns3::SpectrumDb::SubchannelsChangedCallback")
   ;
   return tid;
 }
 
 SpectrumDb::SpectrumDb (void)
+  : m_specVersion (0),
+    m_partitionVersion (0),
+    m_partitionPolicy (CRBS_PARTITION_NONE)
 {
   NS_LOG_FUNCTION (this);
   
   // create unoccupied spectrum map
   m_specMap = CreateObject<SpectrumMap> ();
+  m_changed = CreateObject<SpectrumMap> ();
+  m_added.resize (m_specMap->GetNWords ());
+  m_removed.resize (m_specMap->GetNWords ());
 }
 
 SpectrumDb::~SpectrumDb ()
@@ -37,8 +60,13 @@ void
 SpectrumDb::OccupySpectrum (Ptr<SpectrumMap> map)
 {
   NS_LOG_FUNCTION (this << map);
-  // TODO check that the spectrum to occupy is free
-  m_specMap->OR(map);
+  PrepareSpectrumChange ();
+  const uint32_t overlap = m_occupancy.Add (map, *m_specMap);
+  if (overlap > 0)
+    {
+      NS_LOG_INFO ("Primary user overlaps with others on " << overlap << " subcarriers");
+    }
+  UpdateOccupiedSubchannels (map);
   NS_LOG_INFO ("Occupied Spectrum:    " << m_specMap);
 }
 
@@ -46,15 +74,350 @@ void
 SpectrumDb::LeaveSpectrum (Ptr<SpectrumMap> map)
 {
   NS_LOG_FUNCTION (this << map);
-  m_specMap->XOR(map);
+  PrepareSpectrumChange ();
+  const uint32_t unoccupied = m_occupancy.Remove (map, *m_specMap);
+  if (unoccupied > 0)
+    {
+      NS_LOG_WARN ("Leaving " << unoccupied << " subcarriers that were not occupied");
+    }
+  UpdateOccupiedSubchannels (map);
   NS_LOG_INFO ("Occupied Spectrum:     " << m_specMap);
 }
 
-Ptr<SpectrumMap>
+void
+SpectrumDb::UpdateSpectrum (Ptr<SpectrumMap> map, const uint64_t *words)
+{
+  NS_LOG_FUNCTION (this << map);
+  bool changed = false;
+  for (uint32_t w = 0; w < m_added.size (); ++w)
+    {
+      const uint64_t old = map->GetWord (w);
+      m_added[w] = words[w] & ~old;
+      m_removed[w] = old & ~words[w];
+      changed = changed || (old != words[w]);
+    }
+  if (!changed)
+    {
+      return;
+    }
+
+  PrepareSpectrumChange ();
+  const uint32_t unoccupied = m_occupancy.Remove (&m_removed[0], *m_specMap);
+  if (unoccupied > 0)
+    {
+      NS_LOG_WARN ("Leaving " << unoccupied << " subcarriers that were not occupied");
+    }
+  const uint32_t overlap = m_occupancy.Add (&m_added[0], *m_specMap);
+  if (overlap > 0)
+    {
+      NS_LOG_INFO ("Primary user overlaps with others on " << overlap << " subcarriers");
+    }
+  for (uint32_t w = 0; w < m_added.size (); ++w)
+    {
+      m_added[w] |= m_removed[w];
+    }
+  m_changed->SetWords (&m_added[0]);
+  map->SetWords (words);
+  UpdateOccupiedSubchannels (m_changed);
+  NS_LOG_INFO ("Occupied Spectrum:    " << m_specMap);
+}
+
+void
+SpectrumDb::PrepareSpectrumChange (void)
+{
+  if (m_specMap->GetReferenceCount () > 1)
+    {
+      m_specMap = CopyObject (m_specMap);
+    }
+  ++m_specVersion;
+}
+
+void
+SpectrumDb::UpdateOccupiedSubchannels (Ptr<const SpectrumMap> changed)
+{
+  const std::bitset<Couwbat::MAX_SUBCHANS> before = m_occupiedSubchannels;
+  const uint32_t scPerSubchannel = Couwbat::GetNumberOfSubcarriersPerSubchannel ();
+  for (uint32_t ccId = 0; ccId < Couwbat::GetNumberOfSubchannels (); ++ccId)
+    {
+      const uint32_t first = ccId * scPerSubchannel;
+      if (changed->IsAnySet (first, scPerSubchannel))
+        {
+          m_occupiedSubchannels.set (ccId, m_specMap->IsAnySet (first, scPerSubchannel));
+        }
+    }
+
+  if (before != m_occupiedSubchannels)
+    {
+      ++m_partitionVersion;
+      const std::bitset<Couwbat::MAX_SUBCHANS> becameBusy = m_occupiedSubchannels & ~before;
+      const std::bitset<Couwbat::MAX_SUBCHANS> becameFree = before & ~m_occupiedSubchannels;
+      NS_LOG_INFO (becameBusy.count () << " subchannel(s) became busy, " << becameFree.count () << " became free");
+      m_subchannelsChangedTrace (becameBusy, becameFree);
+    }
+}
+
+Ptr<const SpectrumMap>
 SpectrumDb::GetOccupiedSpectrum (void) const
 {
   NS_LOG_FUNCTION (this);
-  return CopyObject (m_specMap);
+  return m_specMap;
+}
+
+uint32_t
+SpectrumDb::GetSpectrumVersion (void) const
+{
+  return m_specVersion;
+}
+
+uint32_t
+SpectrumDb::GetPartitionVersion (void) const
+{
+  return m_partitionVersion;
+}
+
+void
+SpectrumDb::SetCrBsPartitionPolicy (CrBsPartitionPolicy policy)
+{
+  NS_LOG_FUNCTION (this << policy);
+  if (policy != m_partitionPolicy)
+    {
+      m_partitionPolicy = policy;
+      ++m_partitionVersion;
+    }
+}
+
+SpectrumDb::CrBsPartitionPolicy
+SpectrumDb::GetCrBsPartitionPolicy (void) const
+{
+  return m_partitionPolicy;
+}
+
+void
+SpectrumDb::RegisterCrBs (Mac48Address bs)
+{
+  NS_LOG_FUNCTION (this << bs);
+  for (std::vector<CrBsEntry>::iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr == bs)
+        {
+          return;
+        }
+    }
+  CrBsEntry entry;
+  entry.addr = bs;
+  m_crBs.push_back (entry);
+  ++m_partitionVersion;
+  NS_LOG_INFO ("Registered CR-BS " << bs << ", " << m_crBs.size () << " CR-BS(s) in total");
+}
+
+void
+SpectrumDb::UnregisterCrBs (Mac48Address bs)
+{
+  NS_LOG_FUNCTION (this << bs);
+  for (std::vector<CrBsEntry>::iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr == bs)
+        {
+          m_crBs.erase (it);
+          ++m_partitionVersion;
+          return;
+        }
+    }
+}
+
+void
+SpectrumDb::SetCrBsInterference (Mac48Address a, Mac48Address b)
+{
+  NS_LOG_FUNCTION (this << a << b);
+  if (m_interference.insert (std::make_pair (a, b)).second)
+    {
+      ++m_partitionVersion;
+    }
+  m_interference.insert (std::make_pair (b, a));
+}
+
+void
+SpectrumDb::SetCrBsLoad (Mac48Address bs, double load)
+{
+  NS_LOG_FUNCTION (this << bs << load);
+  for (std::vector<CrBsEntry>::iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr == bs)
+        {
+          if (it->load != load)
+            {
+              it->load = load;
+              ++m_partitionVersion;
+            }
+          return;
+        }
+    }
+}
+
+void
+SpectrumDb::SetCrBsAllocation (Mac48Address bs, const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels)
+{
+  NS_LOG_FUNCTION (this << bs);
+  for (std::vector<CrBsEntry>::iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr == bs)
+        {
+          it->allocation = subchannels;
+          return;
+        }
+    }
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumDb::GetCrBsAllocation (Mac48Address bs) const
+{
+  for (std::vector<CrBsEntry>::const_iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr == bs)
+        {
+          return it->allocation;
+        }
+    }
+  return std::bitset<Couwbat::MAX_SUBCHANS> ();
+}
+
+uint32_t
+SpectrumDb::GetCrBsConflicts (Mac48Address bs) const
+{
+  std::bitset<Couwbat::MAX_SUBCHANS> own = GetCrBsAllocation (bs);
+  std::bitset<Couwbat::MAX_SUBCHANS> others;
+  for (std::vector<CrBsEntry>::const_iterator it = m_crBs.begin (); it != m_crBs.end (); ++it)
+    {
+      if (it->addr != bs && Interfere (bs, it->addr))
+        {
+          others |= it->allocation;
+        }
+    }
+  return (own & others).count ();
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumDb::GetCrBsPartition (Mac48Address bs) const
+{
+  NS_LOG_FUNCTION (this << bs);
+
+  std::bitset<Couwbat::MAX_SUBCHANS> free = GetFreeSubchannels ();
+  if (m_partitionPolicy == CRBS_PARTITION_NONE)
+    {
+      return free;
+    }
+
+  uint32_t index = 0;
+  while (index < m_crBs.size () && m_crBs[index].addr != bs)
+    {
+      ++index;
+    }
+  if (index == m_crBs.size ())
+    {
+      // Not taking part in the coordination
+      return free;
+    }
+
+  std::vector<double> weights;
+  switch (m_partitionPolicy)
+    {
+    case CRBS_PARTITION_STATIC:
+      weights.assign (m_crBs.size (), 1.0);
+      break;
+
+    case CRBS_PARTITION_LOAD:
+      for (uint32_t i = 0; i < m_crBs.size (); ++i)
+        {
+          // An idle cell still needs a control channel
+          weights.push_back (1.0 + m_crBs[i].load);
+        }
+      break;
+
+    case CRBS_PARTITION_COLORING:
+      {
+        // Greedy coloring in order of registration, non-interfering CR-BSs may share a color
+        std::vector<uint32_t> colors;
+        uint32_t colorCount = 0;
+        for (uint32_t i = 0; i < m_crBs.size (); ++i)
+          {
+            std::set<uint32_t> used;
+            for (uint32_t j = 0; j < i; ++j)
+              {
+                if (Interfere (m_crBs[i].addr, m_crBs[j].addr))
+                  {
+                    used.insert (colors[j]);
+                  }
+              }
+            uint32_t color = 0;
+            while (used.count (color))
+              {
+                ++color;
+              }
+            colors.push_back (color);
+            colorCount = std::max (colorCount, color + 1);
+          }
+        weights.assign (colorCount, 1.0);
+        index = colors[index];
+      }
+      break;
+
+    default:
+      NS_FATAL_ERROR ("Unknown CR-BS partition policy " << m_partitionPolicy);
+      break;
+    }
+
+  // Shares are slices of all subchannels rather than of the free ones, so a primary
+  // user only changes the partitions of the CR-BSs whose slice it occupies
+  return SplitSubchannels (Couwbat::GetNumberOfSubchannels (), weights, index) & free;
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumDb::GetFreeSubchannels (void) const
+{
+  return ~m_occupiedSubchannels;
+}
+
+bool
+SpectrumDb::Interfere (Mac48Address a, Mac48Address b) const
+{
+  if (m_interference.empty ())
+    {
+      return a != b;
+    }
+  return m_interference.find (std::make_pair (a, b)) != m_interference.end ();
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumDb::SplitSubchannels (uint32_t n, const std::vector<double> &weights, uint32_t index)
+{
+  NS_ASSERT (index < weights.size ());
+  NS_ASSERT (n <= Couwbat::MAX_SUBCHANS);
+
+  const uint32_t shares = weights.size ();
+
+  // One subchannel per share first, the rest proportional to the weights
+  const uint32_t base = (n >= shares) ? 1 : 0;
+  const uint32_t rest = n - base * shares;
+  double total = 0;
+  double before = 0;
+  for (uint32_t i = 0; i < shares; ++i)
+    {
+      total += weights[i];
+      if (i < index)
+        {
+          before += weights[i];
+        }
+    }
+
+  const uint32_t first = base * index + std::floor (rest * before / total);
+  const uint32_t last = base * (index + 1) + std::floor (rest * (before + weights[index]) / total);
+
+  std::bitset<Couwbat::MAX_SUBCHANS> ret;
+  for (uint32_t i = first; i < last && i < n; ++i)
+    {
+      ret.set (i);
+    }
+  return ret;
 }
 
 } // namespace ns3
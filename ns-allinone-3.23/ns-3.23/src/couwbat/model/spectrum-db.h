@@ -2,6 +2,14 @@
 #define SPECTRUM_DB_H
 
 #include "ns3/core-module.h"
+#include "ns3/mac48-address.h"
+#include "ns3/traced-callback.h"
+#include "couwbat.h"
+#include "spectrum-occupancy.h"
+#include <bitset>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace ns3
 {
@@ -14,19 +22,54 @@ class SpectrumMap;
  *
  * The spectrum database collects spectrum usage of different primary users
  * and keeps a summary spectrum map which is the sum of all spectrum usage.
+ * Primary users may overlap in spectrum: the database counts the primary users
+ * per subcarrier (SpectrumOccupancy), a subcarrier stays occupied until the
+ * last of them leaves it.
  *
- * TODO bugfix, if two PUs overlap in spectrum usage and one of them diasppers/vacates
- * the spectrum it's whole map is declared free, although the other still would occupy parts of that map.
+ * Besides the spectrum map, the database keeps the set of subchannels that contain
+ * at least one occupied subcarrier. It is updated incrementally in OccupySpectrum,
+ * LeaveSpectrum and UpdateSpectrum, so GetFreeSubchannels does not look at the spectrum map.
  *
+ * In addition, CR-BSs register themselves and their wideband allocations.
+ * The subchannels that are not occupied by primary users are partitioned
+ * between the registered CR-BSs according to the CrBsPartitionPolicy
+ * attribute, so that neighbouring cells do not use the same subchannels.
+ *
+ * Changes are published instead of having to be polled: the SubchannelsChanged
+ * trace source fires with the subchannels that became busy and free whenever a
+ * primary user arrival or departure changes the set of free subchannels, and
+ * GetPartitionVersion changes whenever the result of GetCrBsPartition may have
+ * changed, so that callers can cache it.
  */
 class SpectrumDb : public Object
 {
 public:
+  /** \enum CrBsPartitionPolicy
+   * Policies for partitioning the free subchannels between CR-BSs
+   */
+  enum CrBsPartitionPolicy
+  {
+    CRBS_PARTITION_NONE, //!< no coordination, every CR-BS may use all free subchannels
+    CRBS_PARTITION_STATIC, //!< equal share for every CR-BS
+    CRBS_PARTITION_LOAD, //!< share proportional to the load reported by the CR-BS
+    CRBS_PARTITION_COLORING //!< CR-BSs are colored by the interference graph, equal share per color
+  };
+
   /**
    *  Register this type.
    *  \return The object TypeId.
    */
   static TypeId GetTypeId (void);
+
+  /**
+   * TracedCallback signature for changes of the free subchannels.
+   *
+   * \param [in] becameBusy The subchannels that were free and are now occupied.
+   * \param [in] becameFree The subchannels that were occupied and are now free.
+   */
+  typedef void (* SubchannelsChangedCallback)(std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                              std::bitset<Couwbat::MAX_SUBCHANS> becameFree);
+
   SpectrumDb (void); //!< Default constructor
   ~SpectrumDb (); //!< Destructor
 
@@ -38,18 +81,176 @@ public:
 
   /**
    * Inform the database about the spectrum to free.
-   * \param map A map of the spectrum to free.
+   * Subcarriers that are also used by other primary users remain occupied.
+   * \param map A map of the spectrum to free, as passed to OccupySpectrum before.
    */
   void LeaveSpectrum (Ptr<SpectrumMap> map);
 
   /**
-   * Return a new spectrum map that has the occupied subcarriers set. 
-   * \return A new spectrum map that has the occupied subcarriers set.
+   * Change the spectrum of a primary user in place, as LeaveSpectrum followed
+   * by OccupySpectrum would, but only the subcarriers that differ are updated,
+   * no map is allocated and subchannels used before and after do not become
+   * free in between. Nothing happens if the spectrum does not change.
+   * \param map A map of the spectrum being used, as passed to OccupySpectrum before.
+   *   It is set to words.
+   * \param words The new spectrum in the word layout of SpectrumMap (SpectrumMap::GetNWords () long).
+   */
+  void UpdateSpectrum (Ptr<SpectrumMap> map, const uint64_t *words);
+
+  /**
+   * Return a snapshot of the spectrum map that has the occupied subcarriers set.
+   * The snapshot is shared and never modified: the next OccupySpectrum or
+   * LeaveSpectrum copies the map first if a snapshot is still referenced.
+   * \return A spectrum map that has the occupied subcarriers set.
+   */
+  Ptr<const SpectrumMap> GetOccupiedSpectrum (void) const;
+
+  /**
+   * \return A counter incremented on every change of the occupied spectrum,
+   *   to check whether a snapshot of GetOccupiedSpectrum is still current.
+   */
+  uint32_t GetSpectrumVersion (void) const;
+
+  /**
+   * \return The subchannels which are not occupied by primary users.
+   */
+  std::bitset<Couwbat::MAX_SUBCHANS> GetFreeSubchannels (void) const;
+
+  /**
+   * \return A counter incremented whenever the free subchannels, the registered
+   *   CR-BSs, their interference, their load or the partition policy change,
+   *   i.e. whenever GetCrBsPartition may return a different result.
+   */
+  uint32_t GetPartitionVersion (void) const;
+
+  /**
+   * \param policy The policy for partitioning the free subchannels between CR-BSs.
+   */
+  void SetCrBsPartitionPolicy (CrBsPartitionPolicy policy);
+
+  /**
+   * \return The policy for partitioning the free subchannels between CR-BSs.
+   */
+  CrBsPartitionPolicy GetCrBsPartitionPolicy (void) const;
+
+  /**
+   * Register a CR-BS for inter-cell spectrum coordination.
+   * Shares of the partition are handed out in order of registration.
+   * \param bs The address of the CR-BS.
+   */
+  void RegisterCrBs (Mac48Address bs);
+
+  /**
+   * Remove a CR-BS and its allocation from the database.
+   * \param bs The address of the CR-BS.
+   */
+  void UnregisterCrBs (Mac48Address bs);
+
+  /**
+   * Declare that two CR-BSs interfere with each other.
+   * As long as no interference is declared at all, all CR-BSs are
+   * assumed to interfere with each other (co-located cells).
+   * \param a The address of the first CR-BS.
+   * \param b The address of the second CR-BS.
    */
-  Ptr<SpectrumMap> GetOccupiedSpectrum (void) const;
+  void SetCrBsInterference (Mac48Address a, Mac48Address b);
+
+  /**
+   * Report the current load of a CR-BS, used by CRBS_PARTITION_LOAD.
+   * \param bs The address of the CR-BS.
+   * \param load The load, e.g. the number of associated STAs.
+   */
+  void SetCrBsLoad (Mac48Address bs, double load);
+
+  /**
+   * Report the subchannels a CR-BS currently uses.
+   * \param bs The address of the CR-BS.
+   * \param subchannels The used (control and wideband) subchannels.
+   */
+  void SetCrBsAllocation (Mac48Address bs, const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels);
+
+  /**
+   * \param bs The address of the CR-BS.
+   * \return The subchannels last reported by the CR-BS.
+   */
+  std::bitset<Couwbat::MAX_SUBCHANS> GetCrBsAllocation (Mac48Address bs) const;
+
+  /**
+   * \param bs The address of the CR-BS.
+   * \return The number of subchannels allocated by the CR-BS that are also
+   *   allocated by an interfering CR-BS.
+   */
+  uint32_t GetCrBsConflicts (Mac48Address bs) const;
+
+  /**
+   * Return the subchannels a CR-BS may use, i.e. the free subchannels of its
+   * share. Shares are fixed slices of all subchannels that only move when the
+   * registered CR-BSs, their interference or their load change, so a primary
+   * user arrival does not shift the partitions of the other CR-BSs. A CR-BS
+   * whose whole share is occupied gets no subchannels. Unregistered CR-BSs may
+   * use all free subchannels.
+   * \param bs The address of the CR-BS.
+   * \return The subchannels the CR-BS may use.
+   */
+  std::bitset<Couwbat::MAX_SUBCHANS> GetCrBsPartition (Mac48Address bs) const;
 
 private:
+  /** \struct CrBsEntry
+   * Coordination state of one registered CR-BS
+   */
+  struct CrBsEntry
+  {
+    CrBsEntry () : load (0) {}
+    Mac48Address addr; //!< Address of the CR-BS
+    double load; //!< Last reported load
+    std::bitset<Couwbat::MAX_SUBCHANS> allocation; //!< Last reported allocation
+  };
+
+  /**
+   * Copy m_specMap if a snapshot still references it, called before every change.
+   */
+  void PrepareSpectrumChange (void);
+
+  /**
+   * Recompute m_occupiedSubchannels for the subchannels touched by changed
+   * and fire m_subchannelsChangedTrace if the set of occupied subchannels changed.
+   * \param changed The map that was just added to or removed from m_specMap.
+   */
+  void UpdateOccupiedSubchannels (Ptr<const SpectrumMap> changed);
+
+  /**
+   * \return True if the two CR-BSs interfere with each other.
+   */
+  bool Interfere (Mac48Address a, Mac48Address b) const;
+
+  /**
+   * Split the subchannels 0 to n - 1 into consecutive shares proportional to the weights.
+   * Every share gets at least one subchannel if there are enough.
+   * \param n The number of subchannels to split.
+   * \param weights One weight per share.
+   * \param index The share to return.
+   * \return The subchannels of share index.
+   */
+  static std::bitset<Couwbat::MAX_SUBCHANS> SplitSubchannels (uint32_t n, const std::vector<double> &weights, uint32_t index);
+
   Ptr<SpectrumMap> m_specMap; //<! the summary of the used spectrum
+  SpectrumOccupancy m_occupancy; //!< Number of primary users per subcarrier, m_specMap has the subcarriers with a count > 0
+  std::bitset<Couwbat::MAX_SUBCHANS> m_occupiedSubchannels; //!< Subchannels with at least one subcarrier set in m_specMap
+  std::vector<uint64_t> m_added; //!< Scratch words of UpdateSpectrum, subcarriers added
+  std::vector<uint64_t> m_removed; //!< Scratch words of UpdateSpectrum, subcarriers removed
+  Ptr<SpectrumMap> m_changed; //!< Scratch map of UpdateSpectrum, subcarriers added or removed
+  uint32_t m_specVersion; //!< Incremented on every change of m_specMap
+  uint32_t m_partitionVersion; //!< Incremented on every change that may affect GetCrBsPartition
+
+  /**
+   * The trace source fired when subchannels become busy or free.
+   * Parameters are the subchannels that became busy and those that became free.
+   */
+  TracedCallback<std::bitset<Couwbat::MAX_SUBCHANS>, std::bitset<Couwbat::MAX_SUBCHANS> > m_subchannelsChangedTrace;
+
+  CrBsPartitionPolicy m_partitionPolicy; //!< Policy for partitioning the free subchannels between CR-BSs
+  std::vector<CrBsEntry> m_crBs; //!< Registered CR-BSs in order of registration
+  std::set<std::pair<Mac48Address, Mac48Address> > m_interference; //!< Declared interference between CR-BSs
 }; // class SpectrumDb
 
 } // namespace ns3
@@ -1,6 +1,6 @@
 #include "spectrum-manager.h"
 #include "spectrum-db.h"
-#include "spectrum-map.h"
+#include "spectrum-db-client.h"
 #include "couwbat.h"
 #include "ns3/log.h"
 
@@ -18,11 +18,19 @@ SpectrumManager::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName("Couwbat")
     .AddConstructor<SpectrumManager> ()
+    .AddTraceSource ("SubchannelsChanged",
+                     "Trace source indicating that subchannels became occupied or free "
+                     "according to the spectrum database",
+                     MakeTraceSourceAccessor (&SpectrumManager::m_subchannelsChangedTrace),
+                     "ns3::SpectrumDb::SubchannelsChangedCallback")
   ;
   return tid;
 }
 
 SpectrumManager::SpectrumManager ()
+  : m_registered (false),
+    m_usableValid (false),
+    m_usableVersion (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -38,11 +46,61 @@ SpectrumManager::DoInitialize (void)
   NS_LOG_FUNCTION (this);
 }
 
+void
+SpectrumManager::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_db)
+    {
+      if (m_registered)
+        {
+          m_db->UnregisterCrBs (m_crBsAddress);
+        }
+      m_db->TraceDisconnectWithoutContext ("SubchannelsChanged",
+                                           MakeCallback (&SpectrumManager::NotifySubchannelsChanged, this));
+    }
+  if (m_client)
+    {
+      m_client->TraceDisconnectWithoutContext ("SubchannelsChanged",
+                                               MakeCallback (&SpectrumManager::NotifySubchannelsChanged, this));
+    }
+  m_registered = false;
+  m_usableValid = false;
+  m_db = 0;
+  m_client = 0;
+  Object::DoDispose ();
+}
+
 void
 SpectrumManager::SetSpectrumDb (Ptr<Object> specDb)
 {
   NS_LOG_FUNCTION (this << specDb);
-  m_specDb = specDb;
+  m_db = specDb->GetObject<SpectrumDb> ();
+  m_client = specDb->GetObject<SpectrumDbClient> ();
+  m_usableValid = false;
+
+  if (m_db)
+    {
+      m_db->TraceConnectWithoutContext ("SubchannelsChanged",
+                                        MakeCallback (&SpectrumManager::NotifySubchannelsChanged, this));
+    }
+
+  // database in another process, keep a copy of the occupied spectrum up to date
+  if (m_client)
+    {
+      NS_ABORT_MSG_IF (!m_client->IsConnected (), "SpectrumDbClient must be connected before use by a SpectrumManager");
+      m_client->Subscribe ();
+      m_client->TraceConnectWithoutContext ("SubchannelsChanged",
+                                            MakeCallback (&SpectrumManager::NotifySubchannelsChanged, this));
+    }
+}
+
+void
+SpectrumManager::NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                           std::bitset<Couwbat::MAX_SUBCHANS> becameFree)
+{
+  NS_LOG_FUNCTION (this);
+  m_subchannelsChangedTrace (becameBusy, becameFree);
 }
 
 bool
@@ -50,30 +108,75 @@ SpectrumManager::IsCcFree (uint32_t ccId)
 {
   NS_LOG_FUNCTION (this << ccId);
 
-  // get the spectrum map from the database
-  Ptr<SpectrumMap> specMap;
-  Ptr<SpectrumDb> specDb = m_specDb->GetObject<SpectrumDb> ();
-  if (specDb)
+  // the partition of this CR-BS only contains subchannels without occupied subcarriers
+  // TODO do we only need to check data subcarrier or also guard subcarriers?
+  if (!GetUsableSubchannels ().test (ccId))
     {
-      specMap = specDb->GetOccupiedSpectrum ();
+      NS_LOG_INFO ("CC=" << ccId << " is occupied or outside of the partition according to the database");
+      return false;
     }
+  return true;
+}
 
-  // calculate first subcarrier of the requested CC
-  //uint32_t ccFirstScId = (Couwbat::GetNumberOfGuardSubcarriersPerSubchannel () / 2) + (ccId * Couwbat::GetNumberOfSubcarriersPerSubchannel ());
-  const uint32_t ccFirstScId = ccId * Couwbat::GetNumberOfSubcarriersPerSubchannel ();
+bool
+SpectrumManager::IsCoordinationEnabled (void) const
+{
+  return m_db && m_db->GetCrBsPartitionPolicy () != SpectrumDb::CRBS_PARTITION_NONE;
+}
 
-  NS_LOG_INFO ("checking CC=" << ccId << " SC("<<ccFirstScId<<" to "<<ccFirstScId+Couwbat::GetNumberOfSubcarriersPerSubchannel()-1<<")" << " against database map=" << specMap);
-  // for each data subcarrier check if set in spectrum map
-  // TODO do we only need to check data subcarrier or also guard subcarriers?
-  for (uint32_t i=ccFirstScId;
-      i < (ccFirstScId + Couwbat::GetNumberOfSubcarriersPerSubchannel ()); ++i)
+void
+SpectrumManager::RegisterCrBs (Mac48Address bs)
+{
+  NS_LOG_FUNCTION (this << bs);
+  if (m_db)
     {
-      if (specMap->at (i))
-        {
-          return false;
-        }
+      m_db->RegisterCrBs (bs);
+      m_crBsAddress = bs;
+      m_registered = true;
+      m_usableValid = false;
+    }
+}
+
+std::bitset<Couwbat::MAX_SUBCHANS>
+SpectrumManager::GetUsableSubchannels (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_client)
+    {
+      // inter-cell coordination is only available with direct access to the database
+      return m_client->GetFreeSubchannels ();
+    }
+
+  NS_ASSERT (m_db);
+  if (m_usableValid && m_usableVersion == m_db->GetPartitionVersion ())
+    {
+      return m_usable;
+    }
+
+  m_usable = m_registered ? m_db->GetCrBsPartition (m_crBsAddress) : m_db->GetFreeSubchannels ();
+  m_usableVersion = m_db->GetPartitionVersion ();
+  m_usableValid = true;
+  return m_usable;
+}
+
+void
+SpectrumManager::ReportLoad (double load)
+{
+  NS_LOG_FUNCTION (this << load);
+  if (m_db && m_registered)
+    {
+      m_db->SetCrBsLoad (m_crBsAddress, load);
+    }
+}
+
+void
+SpectrumManager::ReportAllocation (const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_db && m_registered)
+    {
+      m_db->SetCrBsAllocation (m_crBsAddress, subchannels);
     }
-  return true;
 }
 
 } // namespace ns3
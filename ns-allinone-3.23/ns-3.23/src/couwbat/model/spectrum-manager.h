@@ -2,10 +2,17 @@
 #define SPECTRUM_MANAGER_H
 
 #include "ns3/object.h"
+#include "ns3/mac48-address.h"
+#include "ns3/traced-callback.h"
+#include "couwbat.h"
+#include <bitset>
 
 namespace ns3
 {
 
+class SpectrumDb;
+class SpectrumDbClient;
+
 /**
  * \brief The SpectrumManager performs spectrum managements tasks inside a CouwbatNetDevice.
  * \ingroup couwbat
@@ -14,9 +21,19 @@ namespace ns3
  * The SpectrumManager has access to the mac and phy of the device and know the mapping between channel and subcarriers.
  * It uses a spectrum database to give information if a control channel is available or not.
  *
+ * The usable subchannels are cached and only fetched again from the database when its
+ * partition version changed, so that the per superframe checks of the MAC are cheap.
+ * Changes of the free subchannels are forwarded by the SubchannelsChanged trace source,
+ * so that the MAC can react to primary user arrivals without polling.
+ *
+ * The spectrum database is either a SpectrumDb, accessed directly, or a connected
+ * SpectrumDbClient for a SpectrumDbServer in another process. With a client, the
+ * manager subscribes to the occupied spectrum and answers from the copy kept by the
+ * client; inter-cell coordination (RegisterCrBs, ReportLoad, ReportAllocation) is
+ * not available then and the CR-BS may use all free subchannels.
+ *
  * TODO implement any further spectrum managements tasks here (e.g spectrum sensing,
- * spectrum decicion, spectrum sharing, spectrum mobility, communication with a client
- * spectrum database application)
+ * spectrum decicion, spectrum sharing, spectrum mobility)
  */
 class SpectrumManager : public Object
 {
@@ -38,23 +55,77 @@ public:
 
   /**
    * \param ccId The id of the control channel.
-   * \return true if the control channel is considered free, false if the control channel is occupied.
+   * \return true if the control channel is considered free, false if the control channel is occupied
+   *   or, if the CR-BS takes part in inter-cell coordination, outside of its partition.
    */
   bool IsCcFree (uint32_t ccId);
+
+  /**
+   * \return true if the spectrum database partitions the free subchannels between
+   *   CR-BSs, i.e. it is accessed directly and its CrBsPartitionPolicy is not None.
+   */
+  bool IsCoordinationEnabled (void) const;
+
+  /**
+   * Take part in inter-cell spectrum coordination of the spectrum database.
+   * \param bs The address of the CR-BS this spectrum manager belongs to.
+   */
+  void RegisterCrBs (Mac48Address bs);
+
+  /**
+   * \return The subchannels the CR-BS may use: not occupied by primary users
+   *   and, if registered, within its partition.
+   *
+   * The result is cached until the partition version of the database changes.
+   */
+  std::bitset<Couwbat::MAX_SUBCHANS> GetUsableSubchannels (void);
+
+  /**
+   * Report the load of the CR-BS to the spectrum database.
+   * \param load The load, e.g. the number of associated STAs.
+   */
+  void ReportLoad (double load);
+
+  /**
+   * Report the subchannels currently used by the CR-BS to the spectrum database.
+   * \param subchannels The used subchannels.
+   */
+  void ReportAllocation (const std::bitset<Couwbat::MAX_SUBCHANS> &subchannels);
   
 protected:
   virtual void DoInitialize (void);
+  virtual void DoDispose (void);
 
 private:
- /*
-  * The spectrum database this device is connected to.
-  * Using Object, to allow different types of implementation.
-  * If m_specDB is of type SpectrumDb, god-like access to the database is perfored through
-  * direct memory access. For later implementations of a spectrum database model as an
-  * client/server application the member methods of this class can check that case and
-  * use the apropriate interface.
-  */
-  Ptr<Object> m_specDb;
+  /**
+   * Forward a change of the free subchannels of the spectrum database.
+   * \param becameBusy The subchannels that became occupied.
+   * \param becameFree The subchannels that became free.
+   */
+  void NotifySubchannelsChanged (std::bitset<Couwbat::MAX_SUBCHANS> becameBusy,
+                                 std::bitset<Couwbat::MAX_SUBCHANS> becameFree);
+
+  /*
+   * The spectrum database this device is connected to, looked up once in SetSpectrumDb.
+   * If it is a SpectrumDb, god-like access to the database is performed through
+   * direct memory access and m_db is set. If it is a SpectrumDbClient, the database
+   * is accessed through a SpectrumDbServer in another process and m_client is set.
+   */
+  Ptr<SpectrumDb> m_db;
+  Ptr<SpectrumDbClient> m_client; //!< Client for the spectrum database, see m_db
+
+  bool m_registered; //!< True if RegisterCrBs has been called
+  Mac48Address m_crBsAddress; //!< Address of the CR-BS, valid if m_registered
+
+  bool m_usableValid; //!< True if m_usable is valid for m_usableVersion
+  uint32_t m_usableVersion; //!< Partition version of the database m_usable was fetched at
+  std::bitset<Couwbat::MAX_SUBCHANS> m_usable; //!< Cached result of GetUsableSubchannels
+
+  /**
+   * The trace source fired when subchannels became busy or free in the spectrum database.
+   * Parameters are the subchannels that became busy and those that became free.
+   */
+  TracedCallback<std::bitset<Couwbat::MAX_SUBCHANS>, std::bitset<Couwbat::MAX_SUBCHANS> > m_subchannelsChangedTrace;
 };
 
 } // namespace ns3
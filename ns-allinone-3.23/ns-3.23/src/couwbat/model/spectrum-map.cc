@@ -2,6 +2,7 @@
 #include "couwbat.h"
 #include "ns3/log.h"
 #include <sstream>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("SpectrumMap");
 
@@ -21,9 +22,10 @@ SpectrumMap::GetTypeId (void)
 }
 
 SpectrumMap::SpectrumMap (void)
+  : m_size (Couwbat::GetNumberOfSubcarriers ()),
+    m_words ((Couwbat::GetNumberOfSubcarriers () + 63) / 64, 0)
 {
   NS_LOG_FUNCTION (this);
-  m_map.resize (Couwbat::GetNumberOfSubcarriers (),false);
 }
 
 SpectrumMap::~SpectrumMap ()
@@ -31,32 +33,74 @@ SpectrumMap::~SpectrumMap ()
   NS_LOG_FUNCTION (this);
 }
 
+uint64_t
+SpectrumMap::RangeMask (uint32_t first, uint32_t count)
+{
+  const uint64_t ones = (count >= 64) ? ~0ULL : ((1ULL << count) - 1);
+  return ones << first;
+}
+
 void
 SpectrumMap::SetSpectrum (uint32_t start_subcarrier, uint32_t nr_subcarriers)
 {
   NS_LOG_FUNCTION (start_subcarrier << nr_subcarriers);
-  uint32_t i;
-  for (i=0; i < nr_subcarriers; i++)
+  NS_ABORT_MSG_IF (start_subcarrier > m_size || nr_subcarriers > m_size - start_subcarrier,
+                   "Subcarriers " << start_subcarrier << "+" << nr_subcarriers << " exceed the map size " << m_size);
+  uint32_t pos = start_subcarrier;
+  const uint32_t end = start_subcarrier + nr_subcarriers;
+  while (pos < end)
     {
-      m_map.at(start_subcarrier +i) = true;
+      const uint32_t bit = pos % 64;
+      const uint32_t n = std::min (64 - bit, end - pos);
+      m_words[pos / 64] |= RangeMask (bit, n);
+      pos += n;
     }
 }
 
 bool
-SpectrumMap::at (uint32_t pos)
+SpectrumMap::at (uint32_t pos) const
+{
+  NS_ABORT_MSG_IF (pos >= m_size, "Subcarrier " << pos << " exceeds the map size " << m_size);
+  return (m_words[pos / 64] >> (pos % 64)) & 1;
+}
+
+uint32_t
+SpectrumMap::GetSize (void) const
 {
-  return m_map.at (pos);
+  return m_size;
+}
+
+uint32_t
+SpectrumMap::GetNWords (void) const
+{
+  return m_words.size ();
+}
+
+uint64_t
+SpectrumMap::GetWord (uint32_t w) const
+{
+  NS_ASSERT (w < m_words.size ());
+  return m_words[w];
+}
+
+void
+SpectrumMap::SetWords (const uint64_t *words)
+{
+  std::copy (words, words + m_words.size (), m_words.begin ());
+  NS_ASSERT (m_size % 64 == 0 || (m_words.back () >> (m_size % 64)) == 0);
 }
 
 void
 SpectrumMap::OR (Ptr<SpectrumMap> otherMap)
 {
   NS_LOG_FUNCTION (this);
-  //m_map |= otherMap->m_map;
-  uint32_t i;
-  for (i=0; i<m_map.size (); i++)
+  NS_ASSERT (otherMap->m_size == m_size);
+  uint64_t *a = &m_words[0];
+  const uint64_t *b = &otherMap->m_words[0];
+  const uint32_t n = m_words.size ();
+  for (uint32_t i = 0; i < n; ++i)
     {
-      m_map.at(i) = m_map.at(i) || otherMap->m_map.at(i);
+      a[i] |= b[i];
     }
 }
 
@@ -64,35 +108,141 @@ void
 SpectrumMap::XOR (Ptr<SpectrumMap> otherMap)
 {
   NS_LOG_FUNCTION (this);
-  //m_map ^= otherMap->m_map;
-  uint32_t i;
-  for (i=0; i<m_map.size (); i++)
+  NS_ASSERT (otherMap->m_size == m_size);
+  uint64_t *a = &m_words[0];
+  const uint64_t *b = &otherMap->m_words[0];
+  const uint32_t n = m_words.size ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      a[i] ^= b[i];
+    }
+}
+
+void
+SpectrumMap::ANDNOT (Ptr<SpectrumMap> otherMap)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (otherMap->m_size == m_size);
+  uint64_t *a = &m_words[0];
+  const uint64_t *b = &otherMap->m_words[0];
+  const uint32_t n = m_words.size ();
+  for (uint32_t i = 0; i < n; ++i)
     {
-      m_map.at(i) = m_map.at(i) ^ otherMap->m_map.at(i);
+      a[i] &= ~b[i];
     }
 }
 
+bool
+SpectrumMap::IsEqual (Ptr<const SpectrumMap> otherMap) const
+{
+  NS_ASSERT (otherMap->m_size == m_size);
+  return m_words == otherMap->m_words;
+}
+
+uint32_t
+SpectrumMap::Count (void) const
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < m_words.size (); ++i)
+    {
+      count += __builtin_popcountll (m_words[i]);
+    }
+  return count;
+}
+
+bool
+SpectrumMap::IsAnySet (uint32_t start_subcarrier, uint32_t nr_subcarriers) const
+{
+  NS_ABORT_MSG_IF (start_subcarrier > m_size || nr_subcarriers > m_size - start_subcarrier,
+                   "Subcarriers " << start_subcarrier << "+" << nr_subcarriers << " exceed the map size " << m_size);
+  uint32_t pos = start_subcarrier;
+  const uint32_t end = start_subcarrier + nr_subcarriers;
+  while (pos < end)
+    {
+      const uint32_t bit = pos % 64;
+      const uint32_t n = std::min (64 - bit, end - pos);
+      if (m_words[pos / 64] & RangeMask (bit, n))
+        {
+          return true;
+        }
+      pos += n;
+    }
+  return false;
+}
+
+uint32_t
+SpectrumMap::FindFreeRun (uint32_t nr_subcarriers, uint32_t from) const
+{
+  NS_LOG_FUNCTION (this << nr_subcarriers << from);
+  if (nr_subcarriers == 0)
+    {
+      return std::min (from, m_size);
+    }
+
+  uint32_t runStart = from;
+  uint32_t runLength = 0;
+  uint32_t pos = from;
+  while (pos < m_size)
+    {
+      const uint32_t bit = pos % 64;
+      const uint32_t n = std::min (64 - bit, m_size - pos);
+      const uint64_t word = m_words[pos / 64] & RangeMask (bit, n);
+      if (word == 0)
+        {
+          // Whole remainder of the word is free
+          runLength += n;
+          if (runLength >= nr_subcarriers)
+            {
+              return runStart;
+            }
+          pos += n;
+        }
+      else
+        {
+          // Free bits up to the lowest occupied one extend the run, then it restarts after it
+          const uint32_t occupied = __builtin_ctzll (word);
+          runLength += occupied - bit;
+          if (runLength >= nr_subcarriers)
+            {
+              return runStart;
+            }
+          pos = pos - bit + occupied + 1;
+          runStart = pos;
+          runLength = 0;
+        }
+    }
+  return m_size;
+}
+
+void
+SpectrumMap::Print (std::ostream &os) const
+{
+  std::string s (m_size, '0');
+  for (uint32_t w = 0; w < m_words.size (); ++w)
+    {
+      uint64_t word = m_words[w];
+      while (word)
+        {
+          s[w * 64 + __builtin_ctzll (word)] = '1';
+          word &= word - 1;
+        }
+    }
+  os << s;
+}
+
 ATTRIBUTE_HELPER_CPP (SpectrumMap);
 
 std::ostream &
 operator << (std::ostream &os, const SpectrumMap &map)
 {
-  uint32_t i;
-  for (i=0; i<map.m_map.size (); i++)
-    {
-      os << map.m_map.at(i);
-    }
+  map.Print (os);
   return os;
 }
 
 std::ostream &
 operator << (std::ostream &os, const Ptr<SpectrumMap> &map)
 {
-  uint32_t i;
-  for (i=0; i<map->m_map.size (); i++)
-    {
-      os << map->m_map.at(i);
-    }
+  map->Print (os);
   return os;
 }
 
@@ -113,4 +263,3 @@ operator >> (std::istream &is, SpectrumMap &map)
 }
 
 } // namespace ns3
-
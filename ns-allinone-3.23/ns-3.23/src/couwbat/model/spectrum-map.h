@@ -12,6 +12,10 @@ namespace ns3
  * \ingroup couwbat
  *
  * The spectrum map has Couwbat::GetNumberOfSubcarriers() subcarriers.
+ *
+ * The bits are packed into 64 bit words, subcarrier i is bit i % 64 of word i / 64.
+ * Bits beyond the last subcarrier are always zero. All bulk operations work on
+ * whole words; their loops are simple enough for the compiler to vectorize them.
  */
 class SpectrumMap : public Object
 {
@@ -42,7 +46,29 @@ public :
    * \param pos The requested subcarrier.
    * \return The value of the subcarrier at the requested position.
    */
-  bool at (uint32_t pos);
+  bool at (uint32_t pos) const;
+
+  /**
+   * \return the number of subcarriers of this map
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * \return the number of 64 bit words, (GetSize () + 63) / 64
+   */
+  uint32_t GetNWords (void) const;
+
+  /**
+   * \param w The word index.
+   * \return subcarriers 64 * w to 64 * w + 63, subcarrier 64 * w in the lowest bit
+   */
+  uint64_t GetWord (uint32_t w) const;
+
+  /**
+   * Replace all subcarriers of the map.
+   * \param words GetNWords () words in the layout of GetWord, bits beyond GetSize () must be zero.
+   */
+  void SetWords (const uint64_t *words);
 
   /**
    * \param otherMap An other map to do a logical OR with.
@@ -58,7 +84,57 @@ public :
    */
   void XOR (Ptr<SpectrumMap> otherMap);
 
-  std::vector<bool> m_map; // TODO make this private
+  /**
+   * \param otherMap An other map whose subcarriers are cleared in this map.
+   * Perform a logical subcarrierwise AND NOT, i.e. this = this & ~otherMap.
+   */
+  void ANDNOT (Ptr<SpectrumMap> otherMap);
+
+  /**
+   * \param otherMap An other map of the same size.
+   * \return true if both maps have the same subcarriers occupied
+   */
+  bool IsEqual (Ptr<const SpectrumMap> otherMap) const;
+
+  /**
+   * \return the number of occupied subcarriers
+   */
+  uint32_t Count (void) const;
+
+  /**
+   * \param start_subcarrier The first subcarrier of the range.
+   * \param nr_subcarriers The number of subcarriers in the range.
+   * \return true if any subcarrier in the range is occupied
+   *
+   * Only the words overlapping the range are read, i.e. one word for a
+   * subchannel of up to 64 subcarriers that does not cross a word boundary.
+   */
+  bool IsAnySet (uint32_t start_subcarrier, uint32_t nr_subcarriers) const;
+
+  /**
+   * \param nr_subcarriers The length of the requested run.
+   * \param from The first subcarrier to consider.
+   * \return the first subcarrier of the first run of nr_subcarriers free
+   *         subcarriers starting at or after from, GetSize () if there is none
+   */
+  uint32_t FindFreeRun (uint32_t nr_subcarriers, uint32_t from = 0) const;
+
+  /**
+   * Print the map as one '0' or '1' per subcarrier.
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  friend class SpectrumOccupancy;
+  friend class SpectrumDbProtocol;
+
+  /**
+   * \return a word with the bits [first, first + count) set, count <= 64 - first
+   */
+  static uint64_t RangeMask (uint32_t first, uint32_t count);
+
+  uint32_t m_size; //!< Number of subcarriers
+  std::vector<uint64_t> m_words; //!< Subcarrier bits, (m_size + 63) / 64 words
 }; // class SpectrumMap
 
 std::ostream &operator << (std::ostream &os, const SpectrumMap &map);
@@ -0,0 +1,125 @@
+#include "spectrum-occupancy.h"
+#include "spectrum-map.h"
+#include "couwbat.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+NS_LOG_COMPONENT_DEFINE ("SpectrumOccupancy");
+
+namespace ns3
+{
+
+SpectrumOccupancy::SpectrumOccupancy ()
+{
+  NS_LOG_FUNCTION (this);
+  const uint32_t words = (Couwbat::GetNumberOfSubcarriers () + 63) / 64;
+  for (uint32_t p = 0; p < COUNTER_BITS; ++p)
+    {
+      m_planes[p].assign (words, 0);
+    }
+}
+
+uint64_t
+SpectrumOccupancy::NonZero (uint32_t w) const
+{
+  uint64_t any = 0;
+  for (uint32_t p = 0; p < COUNTER_BITS; ++p)
+    {
+      any |= m_planes[p][w];
+    }
+  return any;
+}
+
+uint32_t
+SpectrumOccupancy::Add (Ptr<const SpectrumMap> map, SpectrumMap &occupied)
+{
+  NS_LOG_FUNCTION (this << map);
+  NS_ASSERT (map->m_words.size () == m_planes[0].size ());
+  return Add (&map->m_words[0], occupied);
+}
+
+uint32_t
+SpectrumOccupancy::Add (const uint64_t *words, SpectrumMap &occupied)
+{
+  NS_ASSERT (occupied.m_words.size () == m_planes[0].size ());
+  uint32_t overlap = 0;
+  for (uint32_t w = 0; w < m_planes[0].size (); ++w)
+    {
+      const uint64_t m = words[w];
+      if (m == 0)
+        {
+          continue;
+        }
+
+      uint64_t full = m;
+      for (uint32_t p = 0; p < COUNTER_BITS; ++p)
+        {
+          full &= m_planes[p][w];
+        }
+      NS_ABORT_MSG_IF (full != 0, "More than " << (1 << COUNTER_BITS) - 1 << " primary users on one subcarrier");
+      overlap += __builtin_popcountll (m & NonZero (w));
+
+      // Ripple carry add of 1 to the counters selected by m
+      uint64_t carry = m;
+      for (uint32_t p = 0; p < COUNTER_BITS && carry; ++p)
+        {
+          const uint64_t c = m_planes[p][w] & carry;
+          m_planes[p][w] ^= carry;
+          carry = c;
+        }
+      occupied.m_words[w] = NonZero (w);
+    }
+  return overlap;
+}
+
+uint32_t
+SpectrumOccupancy::Remove (Ptr<const SpectrumMap> map, SpectrumMap &occupied)
+{
+  NS_LOG_FUNCTION (this << map);
+  NS_ASSERT (map->m_words.size () == m_planes[0].size ());
+  return Remove (&map->m_words[0], occupied);
+}
+
+uint32_t
+SpectrumOccupancy::Remove (const uint64_t *words, SpectrumMap &occupied)
+{
+  NS_ASSERT (occupied.m_words.size () == m_planes[0].size ());
+  uint32_t unoccupied = 0;
+  for (uint32_t w = 0; w < m_planes[0].size (); ++w)
+    {
+      const uint64_t m = words[w];
+      if (m == 0)
+        {
+          continue;
+        }
+
+      // Counters that are zero must not wrap around
+      const uint64_t nonZero = NonZero (w);
+      unoccupied += __builtin_popcountll (m & ~nonZero);
+
+      // Ripple borrow subtract of 1 from the counters selected by m
+      uint64_t borrow = m & nonZero;
+      for (uint32_t p = 0; p < COUNTER_BITS && borrow; ++p)
+        {
+          const uint64_t b = ~m_planes[p][w] & borrow;
+          m_planes[p][w] ^= borrow;
+          borrow = b;
+        }
+      occupied.m_words[w] = NonZero (w);
+    }
+  return unoccupied;
+}
+
+uint32_t
+SpectrumOccupancy::GetCount (uint32_t subcarrier) const
+{
+  NS_ASSERT (subcarrier / 64 < m_planes[0].size ());
+  uint32_t count = 0;
+  for (uint32_t p = 0; p < COUNTER_BITS; ++p)
+    {
+      count |= ((m_planes[p][subcarrier / 64] >> (subcarrier % 64)) & 1) << p;
+    }
+  return count;
+}
+
+} // namespace ns3
@@ -0,0 +1,90 @@
+#ifndef SPECTRUM_OCCUPANCY_H
+#define SPECTRUM_OCCUPANCY_H
+
+#include "ns3/ptr.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+class SpectrumMap;
+
+/**
+ * \brief Number of primary users occupying each subcarrier.
+ * \ingroup couwbat
+ *
+ * Used by the SpectrumDb so that primary users may overlap in spectrum: a
+ * subcarrier is occupied as long as at least one primary user occupies it,
+ * and leaving the spectrum frees only the subcarriers no other primary user
+ * still occupies.
+ *
+ * The counters are stored bit-sliced: plane p holds bit p of the counters
+ * of 64 subcarriers per word, in the same word layout as SpectrumMap. Adding
+ * or removing a map is a ripple carry add or subtract over the planes, so 64
+ * subcarriers are updated at once and only the words where the map has
+ * subcarriers set are touched.
+ */
+class SpectrumOccupancy
+{
+public:
+  static const uint32_t COUNTER_BITS = 16; //!< Bits per counter, i.e. up to 65535 overlapping primary users
+
+  /**
+   * Create counters for Couwbat::GetNumberOfSubcarriers() subcarriers, all zero.
+   */
+  SpectrumOccupancy ();
+
+  /**
+   * Increment the counters of all subcarriers set in map.
+   * \param map The spectrum of a primary user.
+   * \param occupied Map of the subcarriers with a counter > 0, updated for the changed words.
+   * \return the number of subcarriers of map that were already occupied by other primary users
+   */
+  uint32_t Add (Ptr<const SpectrumMap> map, SpectrumMap &occupied);
+
+  /**
+   * Increment the counters of all subcarriers set in words.
+   * \param words The spectrum of a primary user in the word layout of SpectrumMap.
+   * \param occupied Map of the subcarriers with a counter > 0, updated for the changed words.
+   * \return the number of subcarriers of words that were already occupied by other primary users
+   */
+  uint32_t Add (const uint64_t *words, SpectrumMap &occupied);
+
+  /**
+   * Decrement the counters of all subcarriers set in map. Counters that are
+   * already zero stay zero.
+   * \param map The spectrum of a primary user.
+   * \param occupied Map of the subcarriers with a counter > 0, updated for the changed words.
+   * \return the number of subcarriers of map whose counter was already zero,
+   *   i.e. that were left without being occupied
+   */
+  uint32_t Remove (Ptr<const SpectrumMap> map, SpectrumMap &occupied);
+
+  /**
+   * Decrement the counters of all subcarriers set in words. Counters that are
+   * already zero stay zero.
+   * \param words The spectrum of a primary user in the word layout of SpectrumMap.
+   * \param occupied Map of the subcarriers with a counter > 0, updated for the changed words.
+   * \return the number of subcarriers of words whose counter was already zero
+   */
+  uint32_t Remove (const uint64_t *words, SpectrumMap &occupied);
+
+  /**
+   * \param subcarrier The subcarrier.
+   * \return The number of primary users occupying the subcarrier.
+   */
+  uint32_t GetCount (uint32_t subcarrier) const;
+
+private:
+  /**
+   * \return The bits of word w of all counters > 0
+   */
+  uint64_t NonZero (uint32_t w) const;
+
+  std::vector<uint64_t> m_planes[COUNTER_BITS]; //!< m_planes[p][w] is bit p of the counters of subcarriers 64 * w to 64 * w + 63
+};
+
+} // namespace ns3
+
+#endif /* SPECTRUM_OCCUPANCY_H */
@@ -1,5 +1,6 @@
 #include "sta-couwbat-mac.h"
 #include "ns3/log.h"
+#include "ns3/mac48-address.h"
 #include "couwbat-packet-helper.h"
 #include "couwbat.h"
 #include <cstdlib>
@@ -23,15 +24,25 @@ StaCouwbatMac::GetTypeId (void)
     .SetParent<CouwbatMac> ()
     .SetGroupName("Couwbat")
     .AddConstructor<StaCouwbatMac> ()
+    .AddAttribute ("HomeBs",
+                   "If not the broadcast address, only associate with the CR-BS with this address. "
+                   "Used to bind STAs to their cell in multi-cell scenarios.",
+                   Mac48AddressValue (Mac48Address::GetBroadcast ()),
+                   MakeMac48AddressAccessor (&StaCouwbatMac::m_homeBs),
+                   MakeMac48AddressChecker ())
   ;
   return tid;
 }
 
 StaCouwbatMac::StaCouwbatMac ()
+  : m_homeBs (Mac48Address::GetBroadcast ())
 {
   NS_LOG_FUNCTION (this);
 
   m_rxOkCallback = MakeCallback (&StaCouwbatMac::RxOk, this);
+  m_txQueue.SetDequeueCallback (MakeCallback (&StaCouwbatMac::NotifyQueueDelay, this));
+  m_txQueue.SetDropCallback (MakeCallback (&StaCouwbatMac::NotifyQueueDrop, this));
+  m_txQueue.SetConfig (m_config);
 }
 
 StaCouwbatMac::~StaCouwbatMac ()
@@ -39,6 +50,14 @@ StaCouwbatMac::~StaCouwbatMac ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+StaCouwbatMac::SetConfig (Ptr<CouwbatConfig> config)
+{
+  NS_LOG_FUNCTION (this << config);
+  CouwbatMac::SetConfig (config);
+  m_txQueue.SetConfig (config);
+}
+
 void
 StaCouwbatMac::DoInitialize (void)
 {
@@ -69,7 +88,7 @@ StaCouwbatMac::DoInitialize (void)
       0);
   m_assocSizeBytes = assoc->GetSize ();
 
-  m_seq = std::rand ();
+  m_seq = std::rand () % CouwbatTxHistoryBuffer::NO_ACK;
 
   m_useBackupCc = false;
 
@@ -98,8 +117,9 @@ StaCouwbatMac::StartScanning ()
   m_associated = false;
   m_useBackupCc = false;
   m_scannedPss.clear ();
+  m_mapShortIds.clear ();
 
-  m_currentScanEndedSfCnt = m_sfCnt + 1 + Couwbat::GetNumberOfSubchannels ();
+  m_currentScanEndedSfCnt = m_sfCnt + 1 + m_config->GetNumberOfSubchannels ();
 
   m_currentScanCcId = 0;
   ScanRxPss (m_currentScanCcId);
@@ -113,7 +133,7 @@ StaCouwbatMac::ScanRxPss (uint32_t subch)
 
   NS_LOG_INFO ("CR-STA " << m_address << " scan for PSS on subchannel " << subch);
 
-  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
   double padding = 0;
   uint16_t len = NecessarySymbolsForBytes(m_pssSizeBytes, 1, pssMcs, padding);
   NS_ASSERT (padding == 0);
@@ -124,7 +144,7 @@ StaCouwbatMac::ScanRxPss (uint32_t subch)
   rxSchedMh.m_flags = CW_CMD_WIFI_EXTRA_ZERO_RX;
   rxSchedMh.m_allocatedSubChannels.set (subch, true);
   rxSchedMh.m_ofdm_sym_sframe_count = m_sfCnt + 1;
-  rxSchedMh.m_MCS[subch] = Couwbat::GetDefaultMcs ();
+  rxSchedMh.m_MCS[subch] = m_config->GetDefaultMcs ();
 
   Ptr<Packet> rxSched = Create<Packet> ();
   Send (rxSchedMh, rxSched);
@@ -142,12 +162,26 @@ StaCouwbatMac::SelectCrBs (void)
       return;
     }
 
+  // Take first result, from the home BS if one is set
   std::vector<ScannedPss>::iterator i = m_scannedPss.begin ();
-  ScannedPss bestPss = *(i++);
-//  Take first result
+  CouwbatMacHeader header;
+  for (; i != m_scannedPss.end (); ++i)
+    {
+      i->pss->PeekHeader (header);
+      if (m_homeBs.IsBroadcast () || header.GetSource () == m_homeBs)
+        {
+          break;
+        }
+    }
+  if (i == m_scannedPss.end ())
+    {
+      NS_LOG_INFO ("CR-STA " << m_address << " couldn't find home BS " << m_homeBs);
+      StartScanning ();
+      return;
+    }
+  ScannedPss bestPss = *i;
   m_scannedPss.clear ();
 
-  CouwbatMacHeader header;
   bestPss.pss->RemoveHeader (header);
   CouwbatPssHeader pss;
   bestPss.pss->RemoveHeader (pss);
@@ -156,7 +190,7 @@ StaCouwbatMac::SelectCrBs (void)
                << header.GetSource ());
 
   uint32_t ccId = 0;
-  for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+  for (uint32_t i = 0; i < m_config->GetNumberOfSubchannels (); ++i)
     {
       if (bestPss.mh.m_allocatedSubChannels.test (i))
   {
@@ -177,11 +211,11 @@ StaCouwbatMac::SelectCrBs (void)
   rxSchedMh.m_flags = CW_CMD_WIFI_EXTRA_ZERO_RX;
   rxSchedMh.m_ofdm_sym_sframe_count = m_sfCnt + 1;
   rxSchedMh.m_ofdm_sym_offset = 0;
-  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+  std::vector<CouwbatMCS> pssMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
   rxSchedMh.m_ofdm_sym_len = NecessarySymbolsForBytes(m_pssSizeBytes, 1, pssMcs, padding);
   NS_ASSERT (padding == 0);
   rxSchedMh.m_allocatedSubChannels.set (m_ccId, true);
-  rxSchedMh.m_MCS[m_ccId] = Couwbat::GetDefaultMcs ();
+  rxSchedMh.m_MCS[m_ccId] = m_config->GetDefaultMcs ();
   Ptr<Packet> rxSched = Create<Packet> ();
   Send (rxSchedMh, rxSched);
   m_xstate_pss_rx_scheduled[0] = true;
@@ -192,16 +226,19 @@ StaCouwbatMac::SendAssoc ()
 {
   NS_LOG_FUNCTION (this);
 
+  // Short IDs are announced again by the BS after association
+  m_mapShortIds.clear ();
+
   double padding;
-  uint32_t guard = Couwbat::GetAlohaNrGuardSymbols ();
-  std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+  uint32_t guard = m_config->GetAlohaNrGuardSymbols ();
+  std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
   uint32_t pssTxDurationSymb = NecessarySymbolsForBytes (m_pssSizeBytes, 1, nbMcs, padding);
   NS_ASSERT (padding == 0);
   uint32_t assocTxDurationSymb = NecessarySymbolsForBytes(m_assocSizeBytes, 1, nbMcs, padding);
   NS_ASSERT (padding == 0);
 
   // Random contention slot
-  uint32_t offset = std::rand () % Couwbat::GetContentionSlotCount ();
+  uint32_t offset = std::rand () % m_config->GetContentionSlotCount ();
   uint32_t txOffsetSymb = pssTxDurationSymb + guard + offset * (assocTxDurationSymb + guard);
 
   NS_LOG_DEBUG ("CR-STA " << m_address << " sending association request"
@@ -214,7 +251,7 @@ StaCouwbatMac::SendAssoc ()
   assocMh.m_ofdm_sym_len = NecessarySymbolsForBytes(m_assocSizeBytes, 1, nbMcs, padding);
   NS_ASSERT (padding == 0);
   assocMh.m_allocatedSubChannels.set (m_ccId, true);
-  assocMh.m_MCS[m_ccId] = Couwbat::GetDefaultMcs ();
+  assocMh.m_MCS[m_ccId] = m_config->GetDefaultMcs ();
   Ptr<Packet> assoc = CouwbatPacketHelper::CreateEmpty(COUWBAT_FC_CONTROL_STA_ASSOC, m_address, m_currentBsAddr, 0);
   Send (assocMh, assoc);
 }
@@ -249,6 +286,7 @@ StaCouwbatMac::FilterPacket (Ptr<Packet> packet)
 
   // Check for valid FCS
   if (header.GetFrameType () != COUWBAT_FC_CONTROL_MAP
+      && header.GetFrameType () != COUWBAT_FC_CONTROL_MAP_COMPACT
       && header.GetFrameType () != COUWBAT_FC_DATA_DL)
     {
       CouwbatFcsTrailer trailer;
@@ -294,10 +332,13 @@ StaCouwbatMac::RxOk (Ptr<Packet> packet)
 
     case CW_CMD_WIFI_EXTRA_RX:
       {
-        std::string ps = packet->ToString ();
-        if (ps != "")
+        if (COUWBAT_LOG_ENABLED (LOG_INFO))
           {
-            NS_LOG_INFO ("CR-STA " << m_address << " RX: {" << ps << "}");
+            std::string ps = packet->ToString ();
+            if (ps != "")
+              {
+                NS_LOG_INFO ("CR-STA " << m_address << " RX: {" << ps << "}");
+              }
           }
         RxOkHandleExtraRx (mh, packet);
       }
@@ -337,7 +378,7 @@ StaCouwbatMac::RxOkHandleZeroSfStart (CouwbatMetaHeader mh, Ptr<Packet> packet)
       else
         {
           // Scan in progress
-          if (m_currentScanCcId < Couwbat::GetNumberOfSubchannels ())
+          if (m_currentScanCcId < m_config->GetNumberOfSubchannels ())
             {
               ScanRxPss (m_currentScanCcId);
               ++m_currentScanCcId;
@@ -389,11 +430,11 @@ StaCouwbatMac::RxOkHandleZeroSfStart (CouwbatMetaHeader mh, Ptr<Packet> packet)
         rxPssSched.m_flags = CW_CMD_WIFI_EXTRA_ZERO_RX;
         rxPssSched.m_ofdm_sym_sframe_count = m_sfCnt + 1;
         rxPssSched.m_ofdm_sym_offset = 0;
-        std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, Couwbat::GetDefaultMcs ());
+        std::vector<CouwbatMCS> nbMcs = std::vector<CouwbatMCS> (1, m_config->GetDefaultMcs ());
         rxPssSched.m_ofdm_sym_len = NecessarySymbolsForBytes(m_pssSizeBytes, 1, nbMcs, padding);
         NS_ASSERT (padding == 0);
         rxPssSched.m_allocatedSubChannels.set (m_ccId, true);
-        rxPssSched.m_MCS[m_ccId] = Couwbat::GetDefaultMcs ();
+        rxPssSched.m_MCS[m_ccId] = m_config->GetDefaultMcs ();
         Ptr<Packet> rxSched = Create<Packet> ();
         Send (rxPssSched, rxSched);
         m_xstate_pss_rx_scheduled[0] = true;
@@ -477,6 +518,7 @@ StaCouwbatMac::RxOkHandleExtraRx (CouwbatMetaHeader mh, Ptr<Packet> packet)
               }
             break;
           case COUWBAT_FC_CONTROL_MAP:
+          case COUWBAT_FC_CONTROL_MAP_COMPACT:
             RxProcessMap (mh, packet);
             NS_ASSERT (m_xstate_map_rx_scheduled[1] == true);
             // Received MAP => will not need to schedule anything else in this SF, send SF_START
@@ -504,6 +546,7 @@ StaCouwbatMac::RxOkHandleExtraRx (CouwbatMetaHeader mh, Ptr<Packet> packet)
               }
             break;
           case COUWBAT_FC_CONTROL_MAP:
+          case COUWBAT_FC_CONTROL_MAP_COMPACT:
             RxProcessMap (mh, packet);
             NS_ASSERT (m_xstate_map_rx_scheduled[1] == true);
             // Received MAP => will not need to schedule anything else in this SF, send SF_START
@@ -563,7 +606,7 @@ StaCouwbatMac::RxProcessPss (CouwbatMetaHeader mh, Ptr<Packet> packet)
   CouwbatPssHeader pss;
   packet->RemoveHeader (pss);
   uint32_t wbChCnt = 0;
-  for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+  for (uint32_t i = 0; i < m_config->GetNumberOfSubchannels (); ++i)
     {
       if (pss.m_allocation.test (i))
         {
@@ -583,11 +626,11 @@ StaCouwbatMac::RxProcessPss (CouwbatMetaHeader mh, Ptr<Packet> packet)
   NS_LOG_LOGIC ("wbChCnt: " << wbChCnt );
   rxMapSched.m_ofdm_sym_len = pss.m_pssMaintain.fields.mapLength;
   rxMapSched.m_allocatedSubChannels = pss.m_allocation;
-  for (uint32_t i = 0; i < Couwbat::GetNumberOfSubchannels (); ++i)
+  for (uint32_t i = 0; i < m_config->GetNumberOfSubchannels (); ++i)
     {
       if (pss.m_allocation.test (i))
         {
-          rxMapSched.m_MCS[i] = Couwbat::GetDefaultMcs ();
+          rxMapSched.m_MCS[i] = m_config->GetDefaultMcs ();
         }
     }
   Ptr<Packet> rxSched = Create<Packet> ();
@@ -618,7 +661,7 @@ StaCouwbatMac::RxProcessMap (CouwbatMetaHeader mh, Ptr<Packet> packet)
   // Extract DL and UL subpackets
   std::vector<Ptr<Packet> > mapDl;
   std::vector<Ptr<Packet> > mapUl;
-  bool mapOkay = CouwbatPacketHelper::GetMapSubpackets (packet, mapDl, mapUl); // TODO Handle map errors
+  bool mapOkay = CouwbatPacketHelper::GetMapSubpackets (packet, m_packetScratch, mapDl, mapUl, &m_mapShortIds); // TODO Handle map errors
 
   if (!mapOkay)
     {
@@ -685,9 +728,9 @@ StaCouwbatMac::RxProcessMap (CouwbatMetaHeader mh, Ptr<Packet> packet)
         {
           ack = m_lastSeq[ulIndex];
         }
-      else // Slot count has increased
+      else // Slot count has increased, no DL burst left to ACK
         {
-          ack = 0; // TODO What value to put here? Maybe needs a reserved SEQ number for "not an ACK"
+          ack = CouwbatTxHistoryBuffer::NO_ACK;
         }
 
       uint32_t subchCount = 0;
@@ -712,17 +755,16 @@ StaCouwbatMac::RxProcessMap (CouwbatMetaHeader mh, Ptr<Packet> packet)
       uint32_t maxSizeBytes = TransmittableBytesWithSymbols (ulMapSubp.m_ofdm_count, subchCount, ulMcsVector);
       NS_ASSERT (maxSizeBytes == floor (maxSizeBytes));
 
-      std::vector<uint8_t> noCqi = std::vector<uint8_t> (Couwbat::GetNumberOfSubchannels (), 255); // max CQI value used as CQI N/A
-      std::vector<uint8_t> &cqi = (ulIndex < m_lastCqi.size ()) ? m_lastCqi[ulIndex] : noCqi;
+      const CouwbatCqiArray noCqi (255); // max CQI value used as CQI N/A
+      const CouwbatCqiArray &cqi = (ulIndex < m_lastCqi.size ()) ? m_lastCqi[ulIndex] : noCqi;
 
       std::vector<Ptr<Packet> > dummyHistory;
+      std::vector<Ptr<Packet> > &payloadHist = m_config->IsArqEnabled () ? *m_txHistory.GetNewList (m_currentBsAddr, m_seq) : dummyHistory;
       Ptr<Packet> ulPack = CouwbatPacketHelper::CreateUlDataPacket(
           m_address, m_currentBsAddr, m_seq, m_txQueue, maxSizeBytes,
-          ack, cqi, dummyHistory
-          // txHistory retransmission disabled
-          //*m_txHistory.GetNewList (m_currentBsAddr, m_seq)
+          ack, cqi, payloadHist, m_packetScratch
           );
-      ++m_seq;
+      m_seq = CouwbatTxHistoryBuffer::NextSeq (m_seq);
       ++ulIndex;
 
       if (!ulPack)
@@ -732,13 +774,9 @@ StaCouwbatMac::RxProcessMap (CouwbatMetaHeader mh, Ptr<Packet> packet)
         }
 
       NS_LOG_DEBUG ("UL padding=" << maxSizeBytes - ulPack->GetSize ());
-      int paddingSize = maxSizeBytes - ulPack->GetSize ();
 
       // Add real padding
-      uint8_t *buf = new uint8_t[paddingSize];
-      Ptr<Packet> padPacket = Create<Packet> (buf, paddingSize);
-      delete[] buf;
-      ulPack->AddAtEnd (padPacket);
+      CouwbatPacketHelper::AddPadding (ulPack, maxSizeBytes - ulPack->GetSize ());
 
       double padding;
       CouwbatMetaHeader ulMetaheader;
@@ -783,23 +821,25 @@ StaCouwbatMac::RxProcessData (CouwbatMetaHeader mh, Ptr<Packet> packet)
   NS_LOG_INFO ("CR-STA " << m_address
      << " has received a data packet (" << packet->GetSize () << " B)");
 
-  std::vector<uint8_t> cqi;
-  cqi.assign (mh.m_CQI, mh.m_CQI + Couwbat::MAX_SUBCHANS);
-  m_lastCqi.push_back (cqi);
+  m_lastCqi.push_back (CouwbatCqiArray (mh.m_CQI));
 
   CouwbatMacHeader couwbatHeader;
   packet->PeekHeader (couwbatHeader);
-  m_lastSeq.push_back (couwbatHeader.GetSequence ());
 
   Couwbat1ByteHeader ack;
   std::vector<Ptr<Packet> > data;
-  bool fcsCorrect = CouwbatPacketHelper::GetPayload (packet, data, 0, &ack);
+  bool fcsCorrect = CouwbatPacketHelper::GetPayload (packet, m_packetScratch, data, 0, &ack);
 //  NS_LOG_DEBUG ("StaCouwbatMac::RxProcessData() packet ref count: " << packet->GetReferenceCount ());
   if (!fcsCorrect) return;
 
+  // Only ACK DL bursts that have been decoded
+  m_lastSeq.push_back (couwbatHeader.GetSequence ());
+
   // Register ACKed entry
-  // txHistory retransmission disabled
-//  m_txHistory.RegisterAck (couwbatHeader.GetSource (), ack.GetVal ());
+  if (m_config->IsArqEnabled ())
+    {
+      m_txHistory.RegisterAck (couwbatHeader.GetSource (), ack.GetVal ());
+    }
 
   for (std::vector<Ptr<Packet> >::iterator i = data.begin ();
         i != data.end (); ++i)
@@ -833,12 +873,24 @@ StaCouwbatMac::Enqueue (Ptr<Packet> packet, Mac48Address to)
   m_txQueue.Enqueue (to, packet);
 }
 
+const CouwbatTxHistoryBuffer::Stats &
+StaCouwbatMac::GetArqStats (void) const
+{
+  return m_txHistory.GetStats ();
+}
+
 int
 StaCouwbatMac::GetTxQueueSize (const Mac48Address dest)
 {
   return m_txQueue.GetQueueSize (dest);
 }
 
+uint32_t
+StaCouwbatMac::GetTxQueueBytes (const Mac48Address dest)
+{
+  return m_txQueue.GetQueueBytes (dest);
+}
+
 Callback<void,Ptr<Packet> >
 StaCouwbatMac::GetRxOkCallback ()
 {
@@ -2,11 +2,14 @@
 #define STA_COUWBAT_MAC_H
 
 #include <string>
+#include <map>
 #include "couwbat-mac.h"
 #include "couwbat-tx-queue.h"
+#include "couwbat-packet-helper.h"
 #include "couwbat-meta-header.h"
 #include "couwbat-tx-history-buffer.h"
 #include "couwbat-pss-header.h"
+#include "couwbat-subchannel-array.h"
 
 namespace ns3
 {
@@ -52,6 +55,11 @@ public:
   StaCouwbatMac (); //!< Default constructor
   virtual ~StaCouwbatMac (); //!< Destructor
 
+  /**
+   * Set the configuration of this mac and its TxQueue
+   */
+  virtual void SetConfig (Ptr<CouwbatConfig> config);
+
   /**
    * Takes packets for transmission from upper layers and adds them to TxQueue.
    * \param packet packet to enqueue
@@ -65,6 +73,17 @@ public:
    */
   int GetTxQueueSize (const Mac48Address dest);
 
+  /**
+   * Return the current number of bytes in the TxQueue for a certain destination MAC address.
+   * \param dest destination address
+   */
+  uint32_t GetTxQueueBytes (const Mac48Address dest);
+
+  /**
+   * Return the ARQ retransmission statistics of all UL bursts sent so far.
+   */
+  const CouwbatTxHistoryBuffer::Stats &GetArqStats (void) const;
+
   /**
    * Getter for m_rxOkCallback. Used in m_netlinkMode to forward up packets from lower layers to MAC.
    */
@@ -187,7 +206,7 @@ private:
    */
   uint32_t m_sfCnt;
   std::vector<uint8_t> m_lastSeq; //!< SEQ of last successfully received DL frame(s)
-  std::vector<std::vector<uint8_t> > m_lastCqi; //!< CQI of last received DL frame(s)
+  std::vector<CouwbatCqiArray> m_lastCqi; //!< CQI of last received DL frame(s)
 
   /**
    * The address of the BS with which STA is currently associated
@@ -195,6 +214,16 @@ private:
    */
   Mac48Address m_currentBsAddr;
 
+  /**
+   * The only CR-BS to associate with, any CR-BS if broadcast address
+   */
+  Mac48Address m_homeBs;
+
+  /**
+   * Short STA IDs learned from compact MAPs of the current BS
+   */
+  std::map<uint8_t, Mac48Address> m_mapShortIds;
+
   int32_t m_pssTimeout; //!< State variable used to timeout in case of multiple unreceived PSS
 
   /**
@@ -202,6 +231,8 @@ private:
    */
   CouwbatTxQueue m_txQueue;
 
+  CouwbatPacketHelper::Scratch m_packetScratch; //!< Buffers reused by the packet helper for all frames of this MAC
+
   /**
    * Fixed packet size in bytes for PSS, set during initialization
    */
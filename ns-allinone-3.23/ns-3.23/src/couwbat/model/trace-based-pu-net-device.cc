@@ -1,17 +1,12 @@
 #include "trace-based-pu-net-device.h"
 #include "spectrum-map.h"
 #include "spectrum-db.h"
+#include "pu-trace.h"
 #include "couwbat.h"
 #include "ns3/network-module.h"
 #include "ns3/log.h"
-#include <sys/stat.h>
-#include <fstream>
-#include <limits>
+#include <algorithm>
 #include <cstdlib>
-#include <iterator>
-#include <iostream>
-#include <sstream>
-#include <vector>
 #include <string>
 
 NS_LOG_COMPONENT_DEFINE ("TraceBasedPuNetDevice");
@@ -19,75 +14,6 @@ NS_LOG_COMPONENT_DEFINE ("TraceBasedPuNetDevice");
 namespace ns3
 {
 
-/**
- * File utils
- */
-bool FileExists (std::string fileName)
-{
-  struct stat buffer;
-  return stat (fileName.c_str(), &buffer) == 0;
-}
-
-unsigned int FileNumberOfLines (std::string fileName)
-{
-  int number_of_lines = 0;
-  std::string line;
-  std::ifstream myfile (fileName.c_str ());
-
-  while (std::getline (myfile, line))
-    {
-      ++number_of_lines;
-    }
-  return number_of_lines;
-}
-
-std::fstream& FileGotoLine(std::fstream& file, unsigned int num)
-{
-    file.seekg (std::ios::beg);
-    for (unsigned int i = 0; i < num - 1; ++i){
-        file.ignore (std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    return file;
-}
-
-/*
- * CSV utils
- */
-class CsvRow
-{
-  public:
-    std::string const& operator[] (std::size_t index) const
-    {
-        return m_data[index];
-    }
-    std::size_t size () const
-    {
-        return m_data.size();
-    }
-    void readNextRow (std::istream& str)
-    {
-        std::string line;
-        std::getline (str, line);
-
-        std::stringstream lineStream (line);
-        std::string cell;
-
-        m_data.clear ();
-        while (std::getline (lineStream, cell, ','))
-        {
-            m_data.push_back (cell);
-        }
-    }
-  private:
-    std::vector<std::string> m_data;
-};
-
-std::istream& operator>> (std::istream& str, CsvRow& data)
-{
-    data.readNextRow(str);
-    return str;
-}
-
 /**
  * TraceBasedPuNetDevice
  */
@@ -113,6 +39,7 @@ TraceBasedPuNetDevice::TraceBasedPuNetDevice (void)
     m_fileName (""),
     m_samplingInterval (0),
     m_currentLine (0),
+    m_nextLine (0),
     m_lineCount (0)
 {
   NS_LOG_FUNCTION (this);
@@ -124,6 +51,7 @@ TraceBasedPuNetDevice::~TraceBasedPuNetDevice ()
   m_onOffModel = 0;
   m_specMap = 0;
   m_node = 0;
+  m_trace = 0;
   NS_LOG_FUNCTION (this);
 }
 
@@ -135,9 +63,8 @@ TraceBasedPuNetDevice::SetSpectrumTraceFile (std::string fileName,
   NS_LOG_INFO ("TBPU using file " << fileName << " with sampling interval of "
                << samplingInterval);
 
-  m_lineCount = FileNumberOfLines (fileName);
-
-  if (!FileExists (fileName) || m_lineCount < 1)
+  Ptr<const PuTrace> trace = PuTrace::Get (fileName);
+  if (!trace)
     {
       NS_LOG_WARN ("TraceBasedPuNetDevice::SetSpectrumTraceFile(): Invalid arguments or file.");
       return;
@@ -147,7 +74,14 @@ TraceBasedPuNetDevice::SetSpectrumTraceFile (std::string fileName,
     {
       NS_LOG_INFO ("TBPU running in manual update mode.");
     }
+  else if (trace->GetSamplingInterval () > Time () && trace->GetSamplingInterval () != samplingInterval)
+    {
+      NS_LOG_WARN ("TBPU sampling interval " << samplingInterval << " differs from "
+                   << trace->GetSamplingInterval () << " recorded in " << fileName);
+    }
 
+  m_trace = trace;
+  m_lineCount = trace->GetLineCount ();
   m_fileName = fileName;
   m_samplingInterval = samplingInterval;
 }
@@ -197,13 +131,14 @@ TraceBasedPuNetDevice::Start (int startingLine)
     }
   m_specMap = CreateObject<SpectrumMap> ();
 
+  m_currentLine = 0;
   if (startingLine <= 0)
     {
-      m_currentLine = std::rand () % m_lineCount;
+      m_nextLine = std::rand () % m_lineCount;
     }
   else
     {
-      m_currentLine = startingLine;
+      m_nextLine = startingLine;
     }
   NS_LOG_INFO ("TBPU starting from line " << startingLine);
 
@@ -224,6 +159,7 @@ TraceBasedPuNetDevice::TurnOff (void)
   NS_LOG_FUNCTION (this);
 
   NS_LOG_INFO ("TBPU turning off");
+  CatchUp ();
   if (m_specMap)
     {
       m_specDb->LeaveSpectrum (m_specMap);
@@ -241,6 +177,14 @@ TraceBasedPuNetDevice::TurnOn (void)
   NS_LOG_FUNCTION (this);
   NS_LOG_INFO ("TBPU turning on");
 
+  // Resume with the line after the one applied last, as a replay of every line
+  // would, not with the next change which may lie several lines ahead
+  CatchUp ();
+  if (m_currentLine > 0)
+    {
+      m_nextLine = m_currentLine < m_lineCount ? m_currentLine + 1 : 1;
+    }
+
   if (m_samplingInterval > Time ())
     {
       Simulator::Cancel (m_nextUpdate);
@@ -256,59 +200,77 @@ void
 TraceBasedPuNetDevice::Update (bool first)
 {
   NS_LOG_FUNCTION (this);
-  if (!m_specDb || !m_specMap || m_fileName == "" || !FileExists (m_fileName)
-     || m_currentLine <= 0)
+  if (!m_specDb || !m_specMap || !m_trace || m_nextLine <= 0)
     {
       NS_LOG_ERROR ("TraceBasedPuNetDevice::Update(): Invalid member variables, cannot update");
       return;
     }
 
-  std::fstream file (m_fileName.c_str ());
-  if (file.fail ())
-    {
-      NS_LOG_DEBUG ("TraceBasedPuNetDevice::Update(): Failed to open file");
-    }
-
-  if (m_currentLine > m_lineCount)
+  if (m_nextLine > m_lineCount)
     {
       NS_LOG_LOGIC ("TraceBasedPuNetDevice::Update(): wrapping back to line 1 of trace file");
-      m_currentLine = 1;
+      m_nextLine = 1;
     }
-  FileGotoLine (file, m_currentLine);
+  m_currentLine = m_nextLine;
+  m_appliedAt = Simulator::Now ();
 
   NS_LOG_LOGIC ("TraceBasedPuNetDevice::Update(): reading line " << m_currentLine);
 
-  CsvRow row;
-  if (file >> row)
+  const uint64_t *words = m_trace->GetLine (m_currentLine);
+  if (first)
     {
-      if (!first)
-        {
-          m_specDb->LeaveSpectrum (m_specMap);
-          m_specMap = CreateObject<SpectrumMap> ();
-        }
-
-      for (uint32_t i = 0; i < Couwbat::GetNumberOfSubcarriers (); ++i)
-        {
-          if (row[i] == "1")
-            {
-              m_specMap->SetSpectrum (i, 1);
-            }
-        }
-
+      m_specMap->SetWords (words);
       m_specDb->OccupySpectrum (m_specMap);
     }
   else
     {
-      NS_LOG_ERROR ("TraceBasedPuNetDevice::Update(): Error reading from file, cannot update occupied spectrum");
+      // Only the subcarriers that differ from the previous line change
+      m_specDb->UpdateSpectrum (m_specMap, words);
     }
-
-  ++m_currentLine;
-
   NS_LOG_INFO ("TBPU occupied spectrum:\n" << m_specMap);
+
+  uint32_t step = 1;
   if (m_samplingInterval > Time ())
     {
-      m_nextUpdate = Simulator::Schedule (m_samplingInterval, &TraceBasedPuNetDevice::Update, this, false);
+      // Skip the lines that repeat this one, the next update is at the next change
+      step = m_trace->GetNextChange (m_currentLine);
+      if (step == 0)
+        {
+          NS_LOG_LOGIC ("TraceBasedPuNetDevice::Update(): trace never changes, no further updates");
+          return;
+        }
+      m_nextUpdate = Simulator::Schedule (m_samplingInterval * static_cast<int64_t> (step),
+                                          &TraceBasedPuNetDevice::Update, this, false);
+    }
+
+  m_nextLine = m_currentLine + step;
+  if (m_nextLine > m_lineCount)
+    {
+      m_nextLine -= m_lineCount;
+    }
+}
+
+void
+TraceBasedPuNetDevice::CatchUp (void)
+{
+  if (!m_nextUpdate.IsRunning () || m_samplingInterval <= Time () || m_currentLine == 0)
+    {
+      return;
+    }
+  // The lines before the pending change repeat the applied one, a replay of
+  // every line would have reached one of them by now
+  uint32_t pending = (m_nextLine + m_lineCount - m_currentLine) % m_lineCount;
+  if (pending == 0)
+    {
+      pending = m_lineCount;
+    }
+  const int64_t elapsed = (Simulator::Now () - m_appliedAt).GetTimeStep () / m_samplingInterval.GetTimeStep ();
+  m_currentLine += std::min<int64_t> (elapsed, pending - 1);
+  if (m_currentLine > m_lineCount)
+    {
+      m_currentLine -= m_lineCount;
     }
+  m_appliedAt = Simulator::Now ();
 }
 
 } // namespace ns3
@@ -11,6 +11,7 @@ namespace ns3
 class SpectrumMap;
 class SpectrumDb;
 class Node;
+class PuTrace;
 
 /**
  * \brief Model for a Primary User that occupies a spectrum
@@ -34,11 +35,14 @@ public:
   /**
    * Set the spectrum to occupy while turned on.
    * \param fileName The name (and location if not in working directory)
-   * of the CSV file to use for the spectrum usage.
+   * of the CSV or binary trace file (PuTraceWriter) to use for the spectrum usage.
    * \param samplingInterval Sampling interval of the input file.
    * The spectrum usage will be updated this often. If it is zero,
    * the TBPU operates in manual update mode.
    *
+   * The file is decoded into memory once (PuTrace) and shared with all other
+   * TBPUs replaying it, updates do not access the file system.
+   *
    * TODO: document CSV format
    */
   void SetSpectrumTraceFile (std::string fileName, Time samplingInterval);
@@ -75,7 +79,8 @@ public:
   void Start (int startingLine);
 
   /**
-   * Resumes PU operation if currently stopped.
+   * Resumes PU operation if currently stopped, with the line after the one
+   * applied last.
    */
   void TurnOn (void);
 
@@ -85,9 +90,14 @@ public:
   void TurnOff (void);
 
   /**
-   * Reads the current line from the file, updates spectrum usage and
+   * Reads the current line from the trace, updates spectrum usage and
    * schedules next update.
    *
+   * Only the subcarriers that differ from the previous line are changed in the
+   * spectrum database (SpectrumDb::UpdateSpectrum). With a sampling interval,
+   * the next update is scheduled at the next line that differs from the
+   * current one (PuTrace::GetNextChange) instead of at every line.
+   *
    * NOTE: Only call from outside the class in manual update mode, otherwise the scheduler and OnOffModel handle this
    *
    * \param first If true, do not leave current spectrum.
@@ -95,13 +105,23 @@ public:
   void Update (bool first = false);
 
 private:
+  /**
+   * Advance m_currentLine to the line a replay of every line would have
+   * applied by now. These lines repeat the applied one, so the spectrum
+   * does not change.
+   */
+  void CatchUp (void);
+
   Ptr<SpectrumDb> m_specDb; //!< The spectrum database.
   Ptr<OnOffModel> m_onOffModel; //!< The on-off model.
   Ptr<SpectrumMap> m_specMap; //!< The currently occupied spectrum
   Ptr<Node> m_node; //!< The node that this PU is associated to.
-  std::string m_fileName; //!< Filename of CSV
-  Time m_samplingInterval; //!< Sampling interval of CSV
-  unsigned int m_currentLine; //!< Keep track of file line
+  std::string m_fileName; //!< Filename of the trace
+  Ptr<const PuTrace> m_trace; //!< The decoded trace, shared with other TBPUs
+  Time m_samplingInterval; //!< Sampling interval of the trace
+  unsigned int m_currentLine; //!< Line applied last, 0 if none since Start
+  unsigned int m_nextLine; //!< Line applied by the next Update
+  Time m_appliedAt; //!< Time when m_currentLine was applied
   EventId m_nextUpdate; //!< Store next update event (in case of need to e.g. cancel)
   unsigned int m_lineCount; //!< Number of lines in current CSV file
 }; // class PrimaryUserNetDevice